@@ -0,0 +1,31 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+typedef void (*BenchmarkFunction)(const std::vector<std::string>& arguments);
+
+struct BenchmarkRegistration {
+    BenchmarkRegistration(const char* name, BenchmarkFunction function);
+};
+
+// defines a benchmark which can be run with "benchmark <name> [arguments]"
+#define BENCHMARK(name)                                                                                                \
+    static void name##Benchmark(const std::vector<std::string>& arguments);                                            \
+    static BenchmarkRegistration name##Registration(#name, name##Benchmark);                                          \
+    static void name##Benchmark(const std::vector<std::string>& arguments)
+
+template <typename Function>
+double measureMilliseconds(Function function) {
+    auto start = std::chrono::steady_clock::now();
+    function();
+    std::chrono::duration<double, std::milli> duration = std::chrono::steady_clock::now() - start;
+    return duration.count();
+}
+
+// keeps the optimizer from removing work whose result is otherwise unused
+void doNotOptimize(const void* value);
+
+#endif // !BENCHMARK_H
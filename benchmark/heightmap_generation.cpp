@@ -0,0 +1,111 @@
+// generating the full resolution terrain mesh of synthetic heightmaps, chunk by chunk like the terrain streams it
+//
+// usage: benchmark heightmapGeneration [size]...
+
+#include "benchmark.h"
+
+#include "mesh_optimizer.h"
+#include "terrain.h"
+#include "terrain_mesh.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <string>
+#include <vector>
+
+#include <fmt/format.h>
+using namespace fmt;
+
+// rolling hills, the sum of a row and a column wave keeps building the map cheap even at 16k x 16k
+static HeightMap syntheticHeightMap(int size) {
+    std::vector<float> wave(size);
+    for (int i = 0; i < size; i++) {
+        wave[i] = 8000.0f * std::sin(i * 0.013f) + 4000.0f * std::sin(i * 0.071f);
+    }
+    std::vector<uint16_t> samples(size_t(size) * size);
+    for (int z = 0; z < size; z++) {
+        uint16_t* row = &samples[size_t(z) * size];
+        for (int x = 0; x < size; x++) {
+            row[x] = uint16_t(32768.0f + wave[x] + wave[z]);
+        }
+    }
+    return HeightMap::fromSamples(size, size, std::move(samples));
+}
+
+// generates the vertices of every full resolution chunk, returns the bytes produced
+static size_t generateChunks(const HeightMap& heightMap, ThreadPool* threadPool) {
+    int chunksX = (heightMap.width() - 1 + TERRAIN_CHUNK_SIZE - 1) / TERRAIN_CHUNK_SIZE;
+    int chunksZ = (heightMap.height() - 1 + TERRAIN_CHUNK_SIZE - 1) / TERRAIN_CHUNK_SIZE;
+    std::atomic<size_t> bytes(0);
+    auto band = [&](size_t begin, size_t end) {
+        TerrainMesh mesh;
+        size_t bandBytes = 0;
+        for (size_t chunkZ = begin; chunkZ < end; chunkZ++) {
+            for (int chunkX = 0; chunkX < chunksX; chunkX++) {
+                int x0 = chunkX * TERRAIN_CHUNK_SIZE;
+                int z0 = int(chunkZ) * TERRAIN_CHUNK_SIZE;
+                int columns = std::min(TERRAIN_CHUNK_SIZE, heightMap.width() - 1 - x0) + 1;
+                int rows = std::min(TERRAIN_CHUNK_SIZE, heightMap.height() - 1 - z0) + 1;
+                generateTerrainMesh(heightMap, x0, z0, 1, columns, rows, mesh);
+                bandBytes += mesh.vertices.size() * sizeof(TerrainVertex);
+                doNotOptimize(mesh.vertices.data());
+            }
+        }
+        bytes += bandBytes;
+    };
+    if (threadPool) {
+        threadPool->parallelFor(size_t(chunksZ), band);
+    } else {
+        band(0, size_t(chunksZ));
+    }
+    return bytes;
+}
+
+BENCHMARK(heightmapGeneration) {
+    std::vector<int> sizes;
+    for (const auto& argument : arguments) {
+        sizes.push_back(std::stoi(argument));
+    }
+    if (sizes.empty()) {
+        sizes = {1024, 4096, 16384};
+    }
+
+    ThreadPool threadPool;
+    print("{} worker threads and the calling thread\n", threadPool.threadCount());
+    for (int size : sizes) {
+        HeightMap heightMap = syntheticHeightMap(size);
+        // smaller maps are repeated so every measurement takes a while
+        int iterations = std::max(1, 4096 * 4096 / (size * size));
+
+        size_t bytes = 0;
+        double singleBest = 1e30;
+        double parallelBest = 1e30;
+        for (int i = 0; i < iterations; i++) {
+            singleBest = std::min(singleBest, measureMilliseconds([&] { bytes = generateChunks(heightMap, nullptr); }));
+            parallelBest =
+                std::min(parallelBest, measureMilliseconds([&] { bytes = generateChunks(heightMap, &threadPool); }));
+        }
+
+        // indices of a full chunk, one copy per chunk as triangle lists compared to one shared copy as strips
+        const int chunkVertices = TERRAIN_CHUNK_SIZE + 1;
+        std::vector<unsigned int> triangles;
+        std::vector<uint16_t> strips;
+        generateTerrainTriangles(chunkVertices, chunkVertices, triangles);
+        generateTerrainStrips(chunkVertices, chunkVertices, strips);
+        size_t chunks = size_t((size - 1 + TERRAIN_CHUNK_SIZE - 1) / TERRAIN_CHUNK_SIZE) *
+                        ((size - 1 + TERRAIN_CHUNK_SIZE - 1) / TERRAIN_CHUNK_SIZE);
+        VertexCacheStatistics cache =
+            analyzeVertexCache(triangles.data(), triangles.size(), size_t(chunkVertices) * chunkVertices);
+
+        double megabytes = bytes / (1024.0 * 1024.0);
+        print("{0}x{0}: {1:.0f} MB of vertices, chunk ACMR {2:.3f}, ATVR {3:.3f}\n", size, megabytes, cache.acmr,
+              cache.atvr);
+        print("  indices: {:.1f} MB of 32 bit triangles per chunk, {:.1f} KB of shared 16 bit strips\n",
+              chunks * triangles.size() * sizeof(unsigned int) / (1024.0 * 1024.0),
+              strips.size() * sizeof(uint16_t) / 1024.0);
+        print("  single thread: {:9.2f} ms, {:8.1f} MB/s\n", singleBest, megabytes / singleBest * 1000.0);
+        print("  parallel:      {:9.2f} ms, {:8.1f} MB/s\n", parallelBest, megabytes / parallelBest * 1000.0);
+    }
+}
@@ -0,0 +1,57 @@
+#include "benchmark.h"
+
+#include <exception>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <fmt/format.h>
+using namespace fmt;
+
+static std::map<std::string, BenchmarkFunction>& benchmarks() {
+    static std::map<std::string, BenchmarkFunction> registered;
+    return registered;
+}
+
+BenchmarkRegistration::BenchmarkRegistration(const char* name, BenchmarkFunction function) {
+    benchmarks()[name] = function;
+}
+
+static const void* volatile benchmarkSink = nullptr;
+
+void doNotOptimize(const void* value) {
+    benchmarkSink = value;
+}
+
+int main(int argc, char** argv) {
+    std::vector<std::string> arguments(argv + 1, argv + argc);
+    std::string filter;
+    if (!arguments.empty()) {
+        filter = arguments.front();
+        arguments.erase(arguments.begin());
+    }
+
+    bool found = false;
+    for (const auto& benchmark : benchmarks()) {
+        if (!filter.empty() && benchmark.first != filter) {
+            continue;
+        }
+        found = true;
+        print("== {}\n", benchmark.first);
+        try {
+            benchmark.second(arguments);
+        } catch (const std::exception& error) {
+            print(stderr, "{} failed: {}\n", benchmark.first, error.what());
+            return 1;
+        }
+    }
+
+    if (!found) {
+        print(stderr, "Unknown benchmark {}, available:\n", filter);
+        for (const auto& benchmark : benchmarks()) {
+            print(stderr, "  {}\n", benchmark.first);
+        }
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,65 @@
+// compares importing the spaceship with Assimp against mapping its cooked mesh cache
+//
+// usage: benchmark modelLoading [model] [iterations]
+
+#include "benchmark.h"
+
+#include "mesh_cache.h"
+#include "mesh_import.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+#include <fmt/format.h>
+using namespace fmt;
+
+static unsigned int touchPages(const void* data, size_t size) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    unsigned int sum = 0;
+    for (size_t i = 0; i < size; i += 64) {
+        sum += bytes[i];
+    }
+    return sum;
+}
+
+BENCHMARK(modelLoading) {
+    std::string path = arguments.size() > 0 ? arguments[0] : "assets/spaceship/Corvette-F3.obj";
+    int iterations = arguments.size() > 1 ? std::stoi(arguments[1]) : 10;
+
+    std::string cachePath = MeshCache::pathFor(path);
+    MeshCache::write(cachePath, path, importMesh(path));
+
+    double objBest = 1e30;
+    double objTotal = 0.0;
+    for (int i = 0; i < iterations; i++) {
+        double duration = measureMilliseconds([&] {
+            MeshData mesh = importMesh(path);
+            doNotOptimize(mesh.vertices.data());
+        });
+        objBest = std::min(objBest, duration);
+        objTotal += duration;
+    }
+
+    double cacheBest = 1e30;
+    double cacheTotal = 0.0;
+    for (int i = 0; i < iterations; i++) {
+        double duration = measureMilliseconds([&] {
+            std::unique_ptr<MeshCache> cache = MeshCache::open(cachePath, path);
+            if (!cache) {
+                throw std::runtime_error(format("Mesh cache {} is not valid", cachePath));
+            }
+            // read every page like glBufferData does, otherwise only the header would be paged in
+            unsigned int sum = touchPages(cache->vertices(), cache->vertexCount() * sizeof(Vertex));
+            sum += touchPages(cache->indices(), cache->indexCount() * sizeof(uint32_t));
+            doNotOptimize(&sum);
+        });
+        cacheBest = std::min(cacheBest, duration);
+        cacheTotal += duration;
+    }
+
+    print("{} iterations of {}\n", iterations, path);
+    print("  obj (assimp):  best {:8.2f} ms, average {:8.2f} ms\n", objBest, objTotal / iterations);
+    print("  cached (mmap): best {:8.2f} ms, average {:8.2f} ms\n", cacheBest, cacheTotal / iterations);
+    print("  speedup:       {:.1f}x\n", objBest / cacheBest);
+}
@@ -0,0 +1,80 @@
+// submitting and sorting draw packets, and the radix sort compared to std::sort on the same keys
+//
+// usage: benchmark renderQueue [packets] [iterations]
+
+#include "benchmark.h"
+
+#include "radix_sort.h"
+#include "render_queue.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <fmt/format.h>
+using namespace fmt;
+
+struct SortItem {
+    uint64_t key;
+    uint32_t index;
+};
+
+BENCHMARK(renderQueue) {
+    size_t packets = arguments.size() > 0 ? std::stoul(arguments[0]) : 100000;
+    int iterations = arguments.size() > 1 ? std::stoi(arguments[1]) : 20;
+
+    // a scene of a few programs and textures spread over a few kilometers
+    std::mt19937 random(42);
+    std::uniform_real_distribution<float> coordinate(-2000.0f, 2000.0f);
+    std::uniform_int_distribution<unsigned int> program(1, 8);
+    std::uniform_int_distribution<unsigned int> texture(1, 64);
+    std::vector<DrawPacket> drawPackets(packets);
+    std::vector<glm::vec3> positions(packets);
+    std::vector<SortItem> items(packets);
+    for (size_t i = 0; i < packets; i++) {
+        drawPackets[i].texture = texture(random);
+        drawPackets[i].indexCount = 36;
+        positions[i] = glm::vec3(coordinate(random), coordinate(random), coordinate(random));
+        float distance = std::sqrt(positions[i].x * positions[i].x + positions[i].y * positions[i].y +
+                                   positions[i].z * positions[i].z);
+        items[i] = SortItem{renderKey(0, distance, program(random), drawPackets[i].texture), uint32_t(i)};
+    }
+
+    RenderQueue queue;
+    double submitBest = 1e30;
+    double sortBest = 1e30;
+    for (int i = 0; i < iterations; i++) {
+        submitBest = std::min(submitBest, measureMilliseconds([&] {
+            queue.begin(glm::vec3());
+            for (size_t j = 0; j < packets; j++) {
+                queue.submit(drawPackets[j], positions[j]);
+            }
+        }));
+        sortBest = std::min(sortBest, measureMilliseconds([&] { queue.sort(); }));
+    }
+
+    std::vector<SortItem> keys;
+    std::vector<SortItem> scratch(packets);
+    double radixBest = 1e30;
+    double stdBest = 1e30;
+    for (int i = 0; i < iterations; i++) {
+        keys = items;
+        radixBest = std::min(radixBest, measureMilliseconds([&] {
+            doNotOptimize(radixSort(keys.data(), scratch.data(), keys.size()));
+        }));
+        keys = items;
+        stdBest = std::min(stdBest, measureMilliseconds([&] {
+            std::sort(keys.begin(), keys.end(), [](const SortItem& a, const SortItem& b) { return a.key < b.key; });
+            doNotOptimize(keys.data());
+        }));
+    }
+
+    print("{} packets, best of {} iterations\n", packets, iterations);
+    print("  queue submit:  {:8.3f} ms ({:.1f} ns/packet)\n", submitBest, submitBest * 1e6 / packets);
+    print("  queue sort:    {:8.3f} ms ({:.1f} ns/packet)\n", sortBest, sortBest * 1e6 / packets);
+    print("  radix sort:    {:8.3f} ms\n", radixBest);
+    print("  std::sort:     {:8.3f} ms\n", stdBest);
+    print("  speedup:       {:.1f}x\n", stdBest / radixBest);
+}
@@ -0,0 +1,107 @@
+// streaming per frame data to the GPU in a headless context: the stream buffer persistently mapped and orphaned, and
+// a buffer re-specified with glBufferData per block as the GUI renderer used to do. The GPU reads every byte once by
+// copying it into another buffer.
+//
+// usage: benchmark streamBuffer [MB per frame] [frames]
+
+#include "benchmark.h"
+
+#include "headless_context.h"
+#include "stream_buffer.h"
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <GL/glew.h>
+
+#include <fmt/format.h>
+using namespace fmt;
+
+// written in blocks like the vertices of many draw lists or the transforms of many instanced batches
+const size_t STREAM_BLOCK_SIZE = 64 * 1024;
+
+BENCHMARK(streamBuffer) {
+    double megabytes = arguments.size() > 0 ? std::stod(arguments[0]) : 16.0;
+    int frames = arguments.size() > 1 ? std::stoi(arguments[1]) : 120;
+    size_t frameBytes = size_t(megabytes * 1024 * 1024);
+
+    std::unique_ptr<HeadlessContext> context = HeadlessContext::create(64, 64);
+    context->initGlew();
+    print("{}, {:.1f} MB/frame in blocks of {} KB, {} frames\n", context->renderer(), megabytes,
+          STREAM_BLOCK_SIZE / 1024, frames);
+
+    std::vector<unsigned char> source(STREAM_BLOCK_SIZE);
+    for (size_t i = 0; i < source.size(); i++) {
+        source[i] = static_cast<unsigned char>(i * 7);
+    }
+    GLuint sink;
+    glGenBuffers(1, &sink);
+    glBindBuffer(GL_ARRAY_BUFFER, sink);
+    glBufferData(GL_ARRAY_BUFFER, frameBytes, nullptr, GL_STATIC_COPY);
+    GLuint respecified;
+    glGenBuffers(1, &respecified);
+
+    auto report = [&](const char* name, double milliseconds, size_t stalls) {
+        double seconds = milliseconds / 1000.0 / frames;
+        double bytesPerSecond = double(frameBytes) / seconds;
+        print("  {:<20} {:8.3f} ms/frame {:7.2f} GB/s {:8.1f} MB/frame at 60 Hz, {} stalls\n", name,
+              seconds * 1000.0, bytesPerSecond / 1e9, bytesPerSecond / 60.0 / (1024 * 1024), stalls);
+    };
+
+    for (bool persistent : {true, false}) {
+        StreamBuffer stream(frameBytes, persistent);
+        if (persistent && !stream.isPersistent()) {
+            print("  persistent mapping   not supported by the driver\n");
+            continue;
+        }
+        std::vector<StreamAllocation> allocations;
+        auto frame = [&] {
+            stream.beginFrame();
+            allocations.clear();
+            for (size_t written = 0; written < frameBytes; written += STREAM_BLOCK_SIZE) {
+                size_t size = std::min(STREAM_BLOCK_SIZE, frameBytes - written);
+                allocations.push_back(stream.allocate(size, 256));
+                std::copy(source.begin(), source.begin() + std::ptrdiff_t(size), allocations.back().data);
+            }
+            stream.flush();
+            for (size_t i = 0; i < allocations.size(); i++) {
+                size_t offset = i * STREAM_BLOCK_SIZE;
+                glBindBuffer(GL_COPY_READ_BUFFER, allocations[i].buffer);
+                glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_ARRAY_BUFFER, allocations[i].offset, offset,
+                                    std::min(STREAM_BLOCK_SIZE, frameBytes - offset));
+            }
+            stream.endFrame();
+        };
+        // the first frames in flight fill the regions, waits only start after them
+        for (size_t i = 0; i < FRAMES_IN_FLIGHT; i++) {
+            frame();
+        }
+        glFinish();
+        size_t stalls = stream.stallCount();
+        double milliseconds = measureMilliseconds([&] {
+            for (int i = 0; i < frames; i++) {
+                frame();
+            }
+            glFinish();
+        });
+        report(persistent ? "persistent mapping" : "orphaning", milliseconds, stream.stallCount() - stalls);
+    }
+
+    double milliseconds = measureMilliseconds([&] {
+        for (int i = 0; i < frames; i++) {
+            for (size_t offset = 0; offset < frameBytes; offset += STREAM_BLOCK_SIZE) {
+                size_t size = std::min(STREAM_BLOCK_SIZE, frameBytes - offset);
+                glBindBuffer(GL_COPY_READ_BUFFER, respecified);
+                glBufferData(GL_COPY_READ_BUFFER, size, source.data(), GL_STREAM_DRAW);
+                glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_ARRAY_BUFFER, 0, offset, size);
+            }
+        }
+        glFinish();
+    });
+    report("glBufferData", milliseconds, 0);
+
+    glDeleteBuffers(1, &respecified);
+    glDeleteBuffers(1, &sink);
+}
@@ -0,0 +1,112 @@
+// scaling of the work stealing thread pool from one core to all of them. The calling thread counts as one core of the
+// parallel for, it only waits for the tasks so these run on as many workers as cores.
+//
+// usage: benchmark taskScheduler [cores]
+
+#include "benchmark.h"
+
+#include "mesh_optimizer.h"
+#include "terrain_mesh.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fmt/format.h>
+using namespace fmt;
+
+// every unit of work reorders the triangles of one full resolution terrain chunk for the vertex cache
+const int GRID_VERTICES = 33;
+// units of work of the parallel for
+const size_t PARALLEL_FOR_COUNT = 512;
+// tiles of the wavefront graph along each side, a tile depends on its left and upper neighbour
+const int WAVEFRONT_TILES = 24;
+// empty tasks submitted to measure the overhead per task
+const size_t TINY_TASK_COUNT = 200000;
+
+static void optimizeGrid(const std::vector<unsigned int>& grid, std::vector<unsigned int>& indices) {
+    indices = grid;
+    optimizeVertexCache(indices.data(), indices.size(), size_t(GRID_VERTICES) * GRID_VERTICES);
+    doNotOptimize(indices.data());
+}
+
+static double measureParallelFor(ThreadPool& threadPool, const std::vector<unsigned int>& grid) {
+    return measureMilliseconds([&] {
+        threadPool.parallelFor(PARALLEL_FOR_COUNT, [&](size_t begin, size_t end) {
+            std::vector<unsigned int> indices;
+            for (size_t i = begin; i < end; i++) {
+                optimizeGrid(grid, indices);
+            }
+        });
+    });
+}
+
+static double measureWavefront(ThreadPool& threadPool, const std::vector<unsigned int>& grid) {
+    return measureMilliseconds([&] {
+        std::vector<TaskHandle> tiles(WAVEFRONT_TILES * WAVEFRONT_TILES);
+        for (int y = 0; y < WAVEFRONT_TILES; y++) {
+            for (int x = 0; x < WAVEFRONT_TILES; x++) {
+                std::vector<TaskHandle> dependencies;
+                if (x > 0) {
+                    dependencies.push_back(tiles[y * WAVEFRONT_TILES + x - 1]);
+                }
+                if (y > 0) {
+                    dependencies.push_back(tiles[(y - 1) * WAVEFRONT_TILES + x]);
+                }
+                tiles[y * WAVEFRONT_TILES + x] = threadPool.submit([&grid] {
+                    std::vector<unsigned int> indices;
+                    optimizeGrid(grid, indices);
+                }, dependencies);
+            }
+        }
+        threadPool.wait(tiles.back());
+    });
+}
+
+static double measureTinyTasks(ThreadPool& threadPool) {
+    return measureMilliseconds([&] {
+        std::atomic<size_t> counter(0);
+        std::vector<TaskHandle> tasks;
+        tasks.reserve(TINY_TASK_COUNT);
+        for (size_t i = 0; i < TINY_TASK_COUNT; i++) {
+            tasks.push_back(threadPool.submit([&counter] { counter++; }));
+        }
+        threadPool.wait(threadPool.fence(tasks));
+    });
+}
+
+BENCHMARK(taskScheduler) {
+    int maxCores = arguments.empty() ? int(std::max(1u, std::thread::hardware_concurrency())) : std::stoi(arguments[0]);
+
+    std::vector<unsigned int> grid;
+    generateTerrainTriangles(GRID_VERTICES, GRID_VERTICES, grid);
+
+    print("{} hardware threads, parallel for of {} and wavefront of {}x{} vertex cache optimizations, {} empty tasks\n",
+          std::thread::hardware_concurrency(), PARALLEL_FOR_COUNT, WAVEFRONT_TILES, WAVEFRONT_TILES, TINY_TASK_COUNT);
+    print("cores  parallel for            wavefront               empty tasks\n");
+    double parallelForBase = 0.0;
+    double wavefrontBase = 0.0;
+    for (int cores = 1; cores <= maxCores; cores++) {
+        ThreadPool threadPool(cores - 1);
+        ThreadPool taskPool(cores);
+        double parallelFor = 1e30;
+        double wavefront = 1e30;
+        double tinyTasks = 1e30;
+        for (int i = 0; i < 3; i++) {
+            parallelFor = std::min(parallelFor, measureParallelFor(threadPool, grid));
+            wavefront = std::min(wavefront, measureWavefront(taskPool, grid));
+            tinyTasks = std::min(tinyTasks, measureTinyTasks(taskPool));
+        }
+        if (cores == 1) {
+            parallelForBase = parallelFor;
+            wavefrontBase = wavefront;
+        }
+        print("{:5}  {:8.2f} ms {:5.2f}x {:4.0f}%  {:8.2f} ms {:5.2f}x {:4.0f}%  {:6.2f} M/s\n", cores, parallelFor,
+              parallelForBase / parallelFor, 100.0 * parallelForBase / parallelFor / cores, wavefront,
+              wavefrontBase / wavefront, 100.0 * wavefrontBase / wavefront / cores,
+              TINY_TASK_COUNT / tinyTasks / 1000.0);
+    }
+}
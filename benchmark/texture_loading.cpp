@@ -0,0 +1,76 @@
+// compares decoding a texture with stb_image against mapping its cooked KTX file, and the GPU memory of both
+//
+// usage: benchmark textureLoading [image] [iterations]
+
+#include "benchmark.h"
+
+#include "texture_cache.h"
+#include "texture_format.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+#include <stb_image.h>
+
+#include <fmt/format.h>
+using namespace fmt;
+
+BENCHMARK(textureLoading) {
+    std::string path = arguments.size() > 0 ? arguments[0] : "assets/spaceship/SF_Corvette-F3_diffuse.jpg";
+    int iterations = arguments.size() > 1 ? std::stoi(arguments[1]) : 5;
+
+    std::string cachePath = TextureCache::pathFor(path);
+    std::unique_ptr<TextureCache> cache = TextureCache::open(cachePath, path);
+    if (!cache) {
+        throw std::runtime_error(format("{} is missing or outdated, run cook {} first", cachePath, path));
+    }
+
+    double decodeBest = 1e30;
+    double decodeTotal = 0.0;
+    int width = 0;
+    int height = 0;
+    for (int i = 0; i < iterations; i++) {
+        double duration = measureMilliseconds([&] {
+            int channels;
+            unsigned char* data = stbi_load(path.c_str(), &width, &height, &channels, 0);
+            if (!data) {
+                throw std::runtime_error(format("Failed to load texture {}", path));
+            }
+            doNotOptimize(data);
+            stbi_image_free(data);
+        });
+        decodeBest = std::min(decodeBest, duration);
+        decodeTotal += duration;
+    }
+
+    double cacheBest = 1e30;
+    double cacheTotal = 0.0;
+    for (int i = 0; i < iterations; i++) {
+        double duration = measureMilliseconds([&] {
+            std::unique_ptr<TextureCache> mapped = TextureCache::open(cachePath, path);
+            // read every page like the upload does, otherwise only the header would be paged in
+            unsigned int sum = 0;
+            for (size_t level = 0; level < mapped->levelCount(); level++) {
+                const unsigned char* data = mapped->levelData(level);
+                for (size_t offset = 0; offset < mapped->levelSize(level); offset += 64) {
+                    sum += data[offset];
+                }
+            }
+            doNotOptimize(&sum);
+        });
+        cacheBest = std::min(cacheBest, duration);
+        cacheTotal += duration;
+    }
+
+    // the uncompressed path uploads the decoded image and lets the driver generate the mipmaps, drivers store RGB
+    // with 4 bytes per pixel
+    double uncompressedSize = double(width) * height * 4 * 4 / 3;
+    print("{} iterations of {} ({}x{})\n", iterations, path, width, height);
+    print("  decode (stb_image): best {:8.2f} ms, average {:8.2f} ms\n", decodeBest, decodeTotal / iterations);
+    print("  cooked (mmap):      best {:8.2f} ms, average {:8.2f} ms\n", cacheBest, cacheTotal / iterations);
+    print("  speedup:            {:.1f}x\n", decodeBest / cacheBest);
+    print("  GPU memory: {:.1f} MB as RGBA8, {:.1f} MB as {}, {:.1f}x smaller\n", uncompressedSize / (1024.0 * 1024.0),
+          cache->dataSize() / (1024.0 * 1024.0), textureFormatName(cache->textureFormat()),
+          uncompressedSize / cache->dataSize());
+}
@@ -0,0 +1,7 @@
+in vec4 color;
+
+out vec4 fragmentColor;
+
+void main() {
+  fragmentColor = color;
+}
@@ -0,0 +1,11 @@
+#include "include/frame.glsl"
+
+in vec3 vertex_position;
+in vec4 vertex_color;
+
+out vec4 color;
+
+void main() {
+  color = vertex_color;
+  gl_Position = frame.view_projection * vec4(vertex_position, 1.0);
+}
@@ -1,9 +1,11 @@
-#version 410
+#include "include/lighting.glsl"
 
 in vec3 frag_position;
+in vec3 frag_world_position;
+in vec3 frag_normal;
 out vec4 fragmentColor;
 
 void main() {
-  float color = 0.3 + frag_position.y / 32;
-  fragmentColor = vec4(color, color, color, 1.0);
+  float albedo = 0.3 + frag_position.y / 32;
+  fragmentColor = vec4(diffuse_lighting(vec3(albedo), frag_normal, frag_world_position), 1.0);
 }
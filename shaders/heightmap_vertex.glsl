@@ -1,12 +1,47 @@
-#version 410
+#include "include/frame.glsl"
 
-in vec3 vertex_position;
+// heightmap samples of this vertex and of the mesh of the next coarser level
+in vec2 vertex_heights;
+// x and z of the octahedral encoded normal, terrain normals always point up
+in vec2 vertex_normal;
 
-uniform mat4 mvp;
+layout(std140) uniform Object {
+  mat4 model;
+  // xy: distance at which morphing to the next coarser level starts and where it is complete, z: vertices per row,
+  // w: samples between neighboring vertices
+  vec4 chunk;
+  // xy: first sample of the chunk
+  vec4 origin;
+  // xy: last sample of the map, z: elevation of one sample step
+  vec4 map;
+} object;
+
+// camera position in terrain space, the level of detail is selected in terrain space on the CPU
+uniform vec3 terrain_camera_position;
 
 out vec3 frag_position;
+out vec3 frag_world_position;
+out vec3 frag_normal;
 
 void main() {
-  frag_position = vertex_position;
-  gl_Position = mvp * vec4(vertex_position, 1.0);
+  // x and z are not stored, the vertices of a chunk are laid out row by row
+  int columns = int(object.chunk.z);
+  vec2 grid = vec2(gl_VertexID % columns, gl_VertexID / columns);
+  vec2 xz = min(object.origin.xy + grid * object.chunk.w, object.map.xy);
+  vec2 heights = vertex_heights * object.map.z;
+  vec3 vertex_position = vec3(xz.x, heights.x, xz.y);
+
+  float distance = length(vertex_position - terrain_camera_position);
+  vec2 morph_range = object.chunk.xy;
+  float morph = clamp((distance - morph_range.x) / (morph_range.y - morph_range.x), 0.0, 1.0);
+  vec3 position = vec3(xz.x, mix(heights.x, heights.y, morph), xz.y);
+
+  vec3 normal = normalize(vec3(vertex_normal.x, 1.0 - abs(vertex_normal.x) - abs(vertex_normal.y), vertex_normal.y));
+
+  vec4 world_position = object.model * vec4(position, 1.0);
+  frag_position = position;
+  frag_world_position = world_position.xyz;
+  // the terrain is scaled non uniformly, normals need the inverse transpose
+  frag_normal = transpose(inverse(mat3(object.model))) * normal;
+  gl_Position = frame.view_projection * world_position;
 }
@@ -0,0 +1,9 @@
+// per frame values, laid out as FrameUniforms in uniform_buffer.h
+layout(std140) uniform Frame {
+  mat4 view;
+  mat4 projection;
+  mat4 view_projection;
+  vec4 camera_position;
+  vec4 light_position;
+  vec4 light_color;
+} frame;
@@ -0,0 +1,8 @@
+#include "frame.glsl"
+
+// ambient plus diffuse light of the point light
+vec3 diffuse_lighting(vec3 albedo, vec3 normal, vec3 world_position) {
+  vec3 light_direction = normalize(frame.light_position.xyz - world_position);
+  float diffuse = max(dot(normalize(normal), light_direction), 0.0);
+  return albedo * (0.3 + 0.7 * diffuse * frame.light_color.rgb);
+}
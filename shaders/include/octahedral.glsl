@@ -0,0 +1,8 @@
+// unit vector from its octahedral encoding, the inverse of encodeOctahedral in vertex_format.cpp
+vec3 decode_octahedral(vec2 encoded) {
+  vec3 normal = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+  if (normal.z < 0.0) {
+    normal.xy = (1.0 - abs(normal.yx)) * vec2(normal.x >= 0.0 ? 1.0 : -1.0, normal.y >= 0.0 ? 1.0 : -1.0);
+  }
+  return normalize(normal);
+}
@@ -1,5 +1,3 @@
-#version 410
-
 in vec3 color;
 
 out vec4 fragmentColor;
@@ -1,13 +1,25 @@
-#version 410
+#include "include/frame.glsl"
 
 in vec3 vertex_position;
 in vec3 vertex_color;
+#ifdef INSTANCED
+in mat4 instance_model;
+#endif
 
 out vec3 color;
 
-uniform mat4 mvp;
+layout(std140) uniform Object {
+  // unused when instanced, the model matrix comes from instance_model
+  mat4 model;
+  vec4 parameters[3];
+} object;
 
 void main() {
-  color = vertex_color;
-  gl_Position = mvp * vec4(vertex_position, 1.0);
+#ifdef INSTANCED
+  mat4 model = instance_model;
+#else
+  mat4 model = object.model;
+#endif
+  color = vertex_color * frame.light_color.rgb;
+  gl_Position = frame.view_projection * model * vec4(vertex_position, 1.0);
 }
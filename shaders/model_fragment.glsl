@@ -1,11 +1,14 @@
-#version 410
+#include "include/lighting.glsl"
 
 in vec2 frag_texture_coordinate;
+in vec3 frag_world_position;
+in vec3 frag_normal;
 
 out vec4 fragmentColor;
 
 uniform sampler2D model_texture;
 
 void main() {
-  fragmentColor = texture(model_texture, frag_texture_coordinate);
+  vec4 albedo = texture(model_texture, frag_texture_coordinate);
+  fragmentColor = vec4(diffuse_lighting(albedo.rgb, frag_normal, frag_world_position), albedo.a);
 }
@@ -1,13 +1,41 @@
-#version 410
+#include "include/frame.glsl"
+#include "include/octahedral.glsl"
 
 in vec3 vertex_position;
 in vec2 texture_coordinate;
+// octahedral encoded in xy for compact vertex formats
+in vec3 vertex_normal;
+#ifdef INSTANCED
+in mat4 instance_model;
+#endif
 
 out vec2 frag_texture_coordinate;
+out vec3 frag_world_position;
+out vec3 frag_normal;
 
-uniform mat4 mvp;
+layout(std140) uniform Object {
+  // unused when instanced, the model matrix comes from instance_model
+  mat4 model;
+  // dequantization of the vertex attributes, identity for float vertices
+  vec4 position_scale;
+  // w is 1 if the normals are octahedral encoded
+  vec4 position_offset;
+  // scale in xy, offset in zw
+  vec4 texture_coordinate_transform;
+} object;
 
 void main() {
-  frag_texture_coordinate = texture_coordinate;
-  gl_Position = mvp * vec4(vertex_position, 1.0);
+#ifdef INSTANCED
+  mat4 model = instance_model;
+#else
+  mat4 model = object.model;
+#endif
+  vec3 position = vertex_position * object.position_scale.xyz + object.position_offset.xyz;
+  vec3 normal = object.position_offset.w > 0.5 ? decode_octahedral(vertex_normal.xy) : vertex_normal;
+  vec4 world_position = model * vec4(position, 1.0);
+  frag_texture_coordinate =
+    texture_coordinate * object.texture_coordinate_transform.xy + object.texture_coordinate_transform.zw;
+  frag_world_position = world_position.xyz;
+  frag_normal = mat3(model) * normal;
+  gl_Position = frame.view_projection * world_position;
 }
@@ -0,0 +1,128 @@
+#include "asset_loader.h"
+
+#include "profiler.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+#include <fmt/format.h>
+using namespace fmt;
+
+// width of the bars in the timeline
+const int TIMELINE_COLUMNS = 50;
+
+AssetLoader::AssetLoader(ThreadPool& threadPool) : threadPool(threadPool), shared(std::make_shared<SharedState>()) {
+    this->shared->start = Clock::now();
+}
+
+void AssetLoader::submit(const std::string& name, std::function<std::function<void()>()> read) {
+    size_t index;
+    {
+        std::lock_guard<std::mutex> lock(this->shared->mutex);
+        index = this->shared->timelines.size();
+        this->shared->timelines.emplace_back();
+        this->shared->timelines.back().name = name;
+    }
+    this->shared->pending++;
+
+    // empty if reading failed
+    auto upload = std::make_shared<std::function<void()>>();
+    std::shared_ptr<SharedState> shared = this->shared;
+    TaskHandle readTask = this->threadPool.submit([shared, index, read, upload] {
+        PROFILE_SCOPE("Read asset");
+        {
+            std::lock_guard<std::mutex> lock(shared->mutex);
+            // threads are numbered in the order they picked up their first asset
+            auto thread = shared->threads.emplace(std::this_thread::get_id(), int(shared->threads.size())).first;
+            shared->timelines[index].thread = thread->second;
+            shared->timelines[index].readStart = shared->now();
+        }
+        try {
+            *upload = read();
+        } catch (const std::exception& error) {
+            print(stderr, "Warning: {}\n", error.what());
+        }
+        std::lock_guard<std::mutex> lock(shared->mutex);
+        shared->timelines[index].readEnd = shared->now();
+    });
+
+    this->threadPool.submitToRenderThread([shared, index, upload] {
+        PROFILE_SCOPE("Upload asset");
+        {
+            std::lock_guard<std::mutex> lock(shared->mutex);
+            shared->timelines[index].uploadStart = shared->now();
+        }
+        bool failed = !*upload;
+        if (*upload) {
+            try {
+                (*upload)();
+            } catch (const std::exception& error) {
+                print(stderr, "Warning: {}\n", error.what());
+                failed = true;
+            }
+        }
+        // releases the data read for the upload
+        *upload = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(shared->mutex);
+            shared->timelines[index].uploadEnd = shared->now();
+            shared->timelines[index].failed = failed;
+        }
+        shared->pending--;
+    }, {readTask});
+}
+
+void AssetLoader::markFirstFrame() {
+    if (this->firstFrame < 0.0) {
+        this->firstFrame = this->shared->now();
+    }
+}
+
+void AssetLoader::printTimeline(FILE* file) const {
+    std::vector<Timeline> timelines;
+    {
+        std::lock_guard<std::mutex> lock(this->shared->mutex);
+        timelines = this->shared->timelines;
+    }
+
+    double end = 0.0;
+    double readFirst = 1e30;
+    double readLast = 0.0;
+    double readTotal = 0.0;
+    for (const auto& timeline : timelines) {
+        end = std::max({end, timeline.readEnd, timeline.uploadEnd});
+        if (timeline.readEnd >= 0.0) {
+            readFirst = std::min(readFirst, timeline.readStart);
+            readLast = std::max(readLast, timeline.readEnd);
+            readTotal += timeline.readEnd - timeline.readStart;
+        }
+    }
+    end = std::max({end, this->firstFrame, 1.0});
+
+    // '-' while the asset is read on its worker, '#' while it is uploaded on the render thread
+    print(file, "Startup timeline, {:.1f} ms, '-' read on a worker thread, '#' uploaded on the render thread\n", end);
+    auto column = [end](double time) {
+        return std::min(TIMELINE_COLUMNS - 1, int(time / end * TIMELINE_COLUMNS));
+    };
+    for (const auto& timeline : timelines) {
+        std::string bar(TIMELINE_COLUMNS, ' ');
+        if (timeline.readEnd >= 0.0) {
+            std::fill(bar.begin() + column(timeline.readStart), bar.begin() + column(timeline.readEnd) + 1, '-');
+        }
+        if (timeline.uploadEnd >= 0.0) {
+            std::fill(bar.begin() + column(timeline.uploadStart), bar.begin() + column(timeline.uploadEnd) + 1, '#');
+        }
+        print(file, "  |{}| thread {} read {:7.1f} - {:7.1f} ms, upload {:7.1f} - {:7.1f} ms  {}{}\n", bar,
+              timeline.thread, timeline.readStart, timeline.readEnd, timeline.uploadStart, timeline.uploadEnd,
+              timeline.name, timeline.failed ? " (failed)" : "");
+    }
+    if (this->firstFrame >= 0.0) {
+        print(file, "First frame after {:.1f} ms\n", this->firstFrame);
+    }
+    if (readTotal > 0.0) {
+        // 1 if the assets were read one after another, up to the number of workers if they were read side by side
+        print(file, "Reading took {:.1f} ms of worker time in {:.1f} ms, {:.2f}x overlap\n", readTotal,
+              readLast - readFirst, readTotal / std::max(readLast - readFirst, 1e-3));
+    }
+}
@@ -0,0 +1,80 @@
+#ifndef ASSET_LOADER_H
+#define ASSET_LOADER_H
+
+#include "thread_pool.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// loads assets in the background. File reading, decoding and any other CPU work run on the worker threads, only the
+// upload of the finished data runs on the render thread as a continuation, so frames can be drawn with placeholders in
+// the meantime. Records when every asset was read and uploaded for a startup timeline.
+class AssetLoader {
+public:
+    explicit AssetLoader(ThreadPool& threadPool);
+    AssetLoader(const AssetLoader&) = delete;
+    AssetLoader& operator=(const AssetLoader&) = delete;
+
+    // read runs on a worker thread, upload is called with its result by ThreadPool::runRenderTasks. If either throws
+    // the asset is skipped with a warning and the placeholder of the caller stays in place.
+    template <typename T>
+    void load(const std::string& name, std::function<T()> read, std::function<void(T&)> upload) {
+        this->submit(name, [read, upload]() -> std::function<void()> {
+            std::shared_ptr<T> data = std::make_shared<T>(read());
+            return [data, upload] { upload(*data); };
+        });
+    }
+
+    // assets which are still being read or waiting for their upload
+    size_t pendingCount() const {
+        return this->shared->pending;
+    }
+    void markFirstFrame();
+    // one line per asset with the worker it was read on and its read and upload interval, followed by how much of the
+    // reading overlapped
+    void printTimeline(FILE* file) const;
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    // milliseconds since the loader was created, negative until the event happened
+    struct Timeline {
+        std::string name;
+        int thread = -1;
+        double readStart = -1.0;
+        double readEnd = -1.0;
+        double uploadStart = -1.0;
+        double uploadEnd = -1.0;
+        bool failed = false;
+    };
+
+    // shared with the jobs, which may outlive the loader
+    struct SharedState {
+        Clock::time_point start;
+        std::mutex mutex;
+        std::vector<Timeline> timelines;
+        std::map<std::thread::id, int> threads;
+        std::atomic<size_t> pending{0};
+
+        double now() const {
+            return std::chrono::duration<double, std::milli>(Clock::now() - this->start).count();
+        }
+    };
+
+    // read returns the upload of the asset
+    void submit(const std::string& name, std::function<std::function<void()>()> read);
+
+    ThreadPool& threadPool;
+    std::shared_ptr<SharedState> shared;
+    double firstFrame = -1.0;
+};
+
+#endif // !ASSET_LOADER_H
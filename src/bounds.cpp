@@ -0,0 +1,67 @@
+#include "bounds.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <glm/common.hpp>
+#include <glm/geometric.hpp>
+#include <glm/vec4.hpp>
+
+BoundingBox BoundingBox::fromPoints(const glm::vec3* points, size_t count, size_t stride) {
+    if (count == 0) {
+        return BoundingBox();
+    }
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(points);
+    BoundingBox box(points[0], points[0]);
+    for (size_t i = 1; i < count; i++) {
+        const glm::vec3& point = *reinterpret_cast<const glm::vec3*>(bytes + i * stride);
+        box.minimum = glm::min(box.minimum, point);
+        box.maximum = glm::max(box.maximum, point);
+    }
+    return box;
+}
+
+BoundingBox BoundingBox::transformed(const glm::mat4& transformation) const {
+    // the extent along each new axis is the sum of the absolute projections of the old extents (Arvo)
+    glm::vec3 center = glm::vec3(transformation * glm::vec4(this->center(), 1.0f));
+    glm::vec3 extent = this->extent();
+    glm::vec3 newExtent;
+    for (int row = 0; row < 3; row++) {
+        newExtent[row] = std::abs(transformation[0][row]) * extent.x + std::abs(transformation[1][row]) * extent.y +
+                         std::abs(transformation[2][row]) * extent.z;
+    }
+    return BoundingBox(center - newExtent, center + newExtent);
+}
+
+BoundingSphere BoundingSphere::fromBox(const BoundingBox& box) {
+    return BoundingSphere(box.center(), glm::length(box.extent()));
+}
+
+BoundingSphere BoundingSphere::transformed(const glm::mat4& transformation) const {
+    glm::vec3 center = glm::vec3(transformation * glm::vec4(this->center, 1.0f));
+    float scaleX = glm::length(glm::vec3(transformation[0]));
+    float scaleY = glm::length(glm::vec3(transformation[1]));
+    float scaleZ = glm::length(glm::vec3(transformation[2]));
+    float scale = std::max(std::max(scaleX, scaleY), scaleZ);
+    return BoundingSphere(center, this->radius * scale);
+}
+
+void BoundingBoxList::add(const BoundingBox& box) {
+    glm::vec3 center = box.center();
+    glm::vec3 extent = box.extent();
+    this->centerX.push_back(center.x);
+    this->centerY.push_back(center.y);
+    this->centerZ.push_back(center.z);
+    this->extentX.push_back(extent.x);
+    this->extentY.push_back(extent.y);
+    this->extentZ.push_back(extent.z);
+}
+
+void BoundingBoxList::clear() {
+    this->centerX.clear();
+    this->centerY.clear();
+    this->centerZ.clear();
+    this->extentX.clear();
+    this->extentY.clear();
+    this->extentZ.clear();
+}
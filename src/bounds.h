@@ -0,0 +1,54 @@
+#ifndef BOUNDS_H
+#define BOUNDS_H
+
+#include <cstddef>
+#include <vector>
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+
+// axis aligned bounding box
+struct BoundingBox {
+    glm::vec3 minimum = glm::vec3();
+    glm::vec3 maximum = glm::vec3();
+
+    BoundingBox() = default;
+    BoundingBox(glm::vec3 minimum, glm::vec3 maximum) : minimum(minimum), maximum(maximum) {
+    }
+    static BoundingBox fromPoints(const glm::vec3* points, size_t count, size_t stride = sizeof(glm::vec3));
+
+    glm::vec3 center() const {
+        return (this->minimum + this->maximum) * 0.5f;
+    }
+    glm::vec3 extent() const {
+        return (this->maximum - this->minimum) * 0.5f;
+    }
+    // axis aligned box around this box after it was transformed
+    BoundingBox transformed(const glm::mat4& transformation) const;
+};
+
+struct BoundingSphere {
+    glm::vec3 center = glm::vec3();
+    float radius = 0.0f;
+
+    BoundingSphere() = default;
+    BoundingSphere(glm::vec3 center, float radius) : center(center), radius(radius) {
+    }
+    static BoundingSphere fromBox(const BoundingBox& box);
+
+    BoundingSphere transformed(const glm::mat4& transformation) const;
+};
+
+// many bounding boxes stored as structure of arrays, so they can be tested against a frustum with SIMD
+struct BoundingBoxList {
+    std::vector<float> centerX, centerY, centerZ;
+    std::vector<float> extentX, extentY, extentZ;
+
+    void add(const BoundingBox& box);
+    void clear();
+    size_t size() const {
+        return this->centerX.size();
+    }
+};
+
+#endif // !BOUNDS_H
@@ -0,0 +1,68 @@
+#include "debug_draw.h"
+
+#include "render_state.h"
+#include "render_stats.h"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+static uint32_t packColor(glm::vec3 color) {
+    auto channel = [](float value) { return uint32_t(std::min(std::max(value, 0.0f), 1.0f) * 255.0f + 0.5f); };
+    // bytes in memory order r, g, b, a on little endian machines
+    return channel(color.x) | (channel(color.y) << 8) | (channel(color.z) << 16) | (255u << 24);
+}
+
+DebugDraw::DebugDraw(std::shared_ptr<ShaderProgram> program) : program(std::move(program)) {
+    glGenVertexArrays(1, &this->vao);
+    renderState.bindVertexArray(this->vao);
+    glEnableVertexAttribArray(POSITION_LOCATION);
+    glEnableVertexAttribArray(COLOR_LOCATION);
+}
+
+DebugDraw::~DebugDraw() {
+    renderState.deleteVertexArray(this->vao);
+}
+
+void DebugDraw::line(glm::vec3 from, glm::vec3 to, glm::vec3 color) {
+    uint32_t packed = packColor(color);
+    this->vertices.push_back(Vertex{from, packed});
+    this->vertices.push_back(Vertex{to, packed});
+}
+
+void DebugDraw::box(const BoundingBox& box, const glm::mat4& transformation, glm::vec3 color) {
+    // corner i has the maximum on axis a if bit a of i is set
+    glm::vec3 corners[8];
+    for (int i = 0; i < 8; i++) {
+        glm::vec3 corner((i & 1) ? box.maximum.x : box.minimum.x, (i & 2) ? box.maximum.y : box.minimum.y,
+                         (i & 4) ? box.maximum.z : box.minimum.z);
+        corners[i] = glm::vec3(transformation * glm::vec4(corner, 1.0f));
+    }
+    for (int i = 0; i < 8; i++) {
+        for (int axis = 1; axis < 8; axis <<= 1) {
+            if (!(i & axis)) {
+                this->line(corners[i], corners[i | axis], color);
+            }
+        }
+    }
+}
+
+void DebugDraw::draw(StreamBuffer& stream) {
+    if (this->vertices.empty()) {
+        return;
+    }
+    size_t bytes = sizeof(Vertex) * this->vertices.size();
+    // aligned to whole vertices, so the offset is the first vertex of the draw
+    StreamAllocation allocation = stream.allocate(bytes, sizeof(Vertex));
+    std::memcpy(allocation.data, this->vertices.data(), bytes);
+    stream.flush();
+
+    this->program->use();
+    renderState.bindVertexArray(this->vao);
+    glBindBuffer(GL_ARRAY_BUFFER, allocation.buffer);
+    glVertexAttribPointer(POSITION_LOCATION, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, position));
+    glVertexAttribPointer(COLOR_LOCATION, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Vertex), (void*)offsetof(Vertex, color));
+    glDrawArrays(GL_LINES, GLint(allocation.offset / sizeof(Vertex)), GLsizei(this->vertices.size()));
+    renderStats.drawCalls++;
+    this->vertices.clear();
+}
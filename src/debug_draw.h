@@ -0,0 +1,52 @@
+#ifndef DEBUG_DRAW_H
+#define DEBUG_DRAW_H
+
+#include "bounds.h"
+#include "shader_program.h"
+#include "stream_buffer.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <GL/glew.h>
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+
+// colored lines collected during a frame, e.g. bounding boxes, and drawn in one call through the stream buffer. The
+// program reads the view projection from the Frame block.
+class DebugDraw {
+public:
+    static const GLuint POSITION_LOCATION = 0;
+    static const GLuint COLOR_LOCATION = 1;
+
+    explicit DebugDraw(std::shared_ptr<ShaderProgram> program);
+    ~DebugDraw();
+    DebugDraw(const DebugDraw&) = delete;
+    DebugDraw& operator=(const DebugDraw&) = delete;
+
+    void line(glm::vec3 from, glm::vec3 to, glm::vec3 color);
+    // the twelve edges of box after transformation
+    void box(const BoundingBox& box, const glm::mat4& transformation, glm::vec3 color);
+    // streams the lines of the frame and draws them, then starts over
+    void draw(StreamBuffer& stream);
+
+    size_t lineCount() const {
+        return this->vertices.size() / 2;
+    }
+
+private:
+    struct Vertex {
+        glm::vec3 position;
+        // RGBA8
+        uint32_t color;
+    };
+
+    std::shared_ptr<ShaderProgram> program;
+    GLuint vao = 0;
+    std::vector<Vertex> vertices;
+};
+
+#endif // !DEBUG_DRAW_H
@@ -0,0 +1,69 @@
+#include "fleet.h"
+
+#include "profiler.h"
+#include "render_stats.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+// ships per range of the parallel update, small fleets are updated on the calling thread alone
+const size_t SHIPS_PER_RANGE = 2048;
+
+Fleet::Fleet(const BoundingSphere& shipBounds, const BoundingBox& shipBox, float shipScale, ThreadPool& threadPool)
+    : threadPool(threadPool), shipBounds(shipBounds), shipBox(shipBox), shipScale(shipScale) {
+    this->spacing = shipBounds.radius * shipScale * 2.5f;
+}
+
+void Fleet::resize(size_t size) {
+    // square grid layers stacked on top of each other, filled from the center
+    size_t side = size_t(std::ceil(std::sqrt(double(std::min<size_t>(size, 2500)))));
+    size_t layerSize = std::max<size_t>(side * side, 1);
+    this->ships.resize(size);
+    for (size_t i = 0; i < size; i++) {
+        size_t layer = i / layerSize;
+        size_t x = (i % layerSize) % side;
+        size_t z = (i % layerSize) / side;
+        glm::vec3 position(float(x) - float(side) * 0.5f, float(layer), float(z) - float(side) * 0.5f);
+        this->ships[i].offset = position * this->spacing;
+        this->ships[i].phase = float(i % 97) * 0.37f;
+    }
+}
+
+void Fleet::update(glm::vec3 center, float time, const Frustum& frustum, OcclusionCuller* occlusion) {
+    glm::vec3 scale(this->shipScale);
+    this->shipTransforms.resize(this->ships.size());
+    this->shipVisibility.resize(this->ships.size());
+    this->threadPool.parallelFor(this->ships.size(), [&](size_t begin, size_t end) {
+        PROFILE_SCOPE("Fleet range");
+        for (size_t i = begin; i < end; i++) {
+            const Ship& ship = this->ships[i];
+            // bob up and down so every transform is rebuilt every frame
+            glm::vec3 position = center + ship.offset;
+            position.y += std::sin(time + ship.phase) * this->spacing * 0.1f;
+
+            glm::mat4 model = glm::translate(glm::mat4(1.0f), position);
+            model = glm::rotate(model, std::sin(time * 0.5f + ship.phase) * 0.2f, glm::vec3(0.0f, 0.0f, 1.0f));
+            model = glm::scale(model, scale);
+
+            this->shipTransforms[i] = model;
+            this->shipVisibility[i] = frustum.intersects(this->shipBounds.transformed(model));
+        }
+    }, SHIPS_PER_RANGE);
+    size_t occluded = 0;
+    if (occlusion) {
+        occluded = occlusion->cull(this->shipBox, this->shipTransforms.data(), this->ships.size(),
+                                   this->shipVisibility.data());
+    }
+
+    this->transforms.clear();
+    this->transforms.reserve(this->ships.size());
+    for (size_t i = 0; i < this->ships.size(); i++) {
+        if (this->shipVisibility[i]) {
+            this->transforms.push_back(this->shipTransforms[i]);
+        }
+    }
+    renderStats.drawnObjects += unsigned(this->transforms.size());
+    renderStats.culledObjects += unsigned(this->ships.size() - this->transforms.size() - occluded);
+}
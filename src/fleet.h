@@ -0,0 +1,51 @@
+#ifndef FLEET_H
+#define FLEET_H
+
+#include "bounds.h"
+#include "frustum.h"
+#include "occlusion_culler.h"
+#include "thread_pool.h"
+
+#include <vector>
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+
+// ships flying in formation on a grid, used to measure how rendering scales with the number of objects
+class Fleet {
+public:
+    // shipBounds, shipBox and shipScale are the model space bounds and the scale the ship model is drawn with
+    Fleet(const BoundingSphere& shipBounds, const BoundingBox& shipBox, float shipScale, ThreadPool& threadPool);
+
+    void resize(size_t size);
+    size_t size() const {
+        return this->ships.size();
+    }
+
+    // moves the ships and collects the model matrices of the ones inside the frustum and not hidden behind the
+    // occluders of occlusion, if any. Large fleets are split across the worker threads.
+    void update(glm::vec3 center, float time, const Frustum& frustum, OcclusionCuller* occlusion = nullptr);
+    const std::vector<glm::mat4>& visibleTransforms() const {
+        return this->transforms;
+    }
+
+private:
+    struct Ship {
+        glm::vec3 offset;
+        float phase;
+    };
+
+    ThreadPool& threadPool;
+    BoundingSphere shipBounds;
+    BoundingBox shipBox;
+    float shipScale;
+    float spacing;
+
+    std::vector<Ship> ships;
+    // model matrix of every ship and whether it is visible, written by the workers before visible ones are collected
+    std::vector<glm::mat4> shipTransforms;
+    std::vector<unsigned char> shipVisibility;
+    std::vector<glm::mat4> transforms;
+};
+
+#endif // !FLEET_H
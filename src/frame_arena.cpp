@@ -0,0 +1,49 @@
+#include "frame_arena.h"
+
+#include <algorithm>
+#include <cstdint>
+
+FrameArena::FrameArena(size_t capacity) {
+    this->addBlock(capacity);
+}
+
+void FrameArena::addBlock(size_t size) {
+    Block block;
+    block.data = std::unique_ptr<unsigned char[]>(new unsigned char[size]);
+    block.size = size;
+    this->blocks.push_back(std::move(block));
+    this->offset = 0;
+}
+
+void* FrameArena::allocateBytes(size_t size, size_t alignment) {
+    Block* block = &this->blocks.back();
+    uintptr_t base = reinterpret_cast<uintptr_t>(block->data.get());
+    size_t aligned = (base + this->offset + alignment - 1) / alignment * alignment - base;
+    if (aligned + size > block->size) {
+        this->addBlock(std::max(size + alignment, block->size));
+        block = &this->blocks.back();
+        base = reinterpret_cast<uintptr_t>(block->data.get());
+        aligned = (base + alignment - 1) / alignment * alignment - base;
+    }
+    this->offset = aligned + size;
+    this->usedBytes += size;
+    return block->data.get() + aligned;
+}
+
+void FrameArena::reset() {
+    if (this->blocks.size() > 1) {
+        size_t total = this->capacity();
+        this->blocks.clear();
+        this->addBlock(total);
+    }
+    this->offset = 0;
+    this->usedBytes = 0;
+}
+
+size_t FrameArena::capacity() const {
+    size_t total = 0;
+    for (const auto& block : this->blocks) {
+        total += block.size;
+    }
+    return total;
+}
@@ -0,0 +1,45 @@
+#ifndef FRAME_ARENA_H
+#define FRAME_ARENA_H
+
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+// bump allocator for data that lives for one frame, everything is released at once by reset. Pointers stay valid
+// until then. If a frame needs more than the capacity, overflow blocks are added and merged into one bigger block on
+// the next reset, so the steady state is a single allocation.
+class FrameArena {
+public:
+    explicit FrameArena(size_t capacity = 1 << 20);
+    FrameArena(const FrameArena&) = delete;
+    FrameArena& operator=(const FrameArena&) = delete;
+
+    // uninitialized storage, destructors are never run
+    template <typename T>
+    T* allocate(size_t count = 1) {
+        static_assert(std::is_trivially_destructible<T>::value, "arena objects are never destroyed");
+        return static_cast<T*>(this->allocateBytes(sizeof(T) * count, alignof(T)));
+    }
+    void reset();
+
+    size_t capacity() const;
+    size_t used() const {
+        return this->usedBytes;
+    }
+
+private:
+    struct Block {
+        std::unique_ptr<unsigned char[]> data;
+        size_t size;
+    };
+
+    void* allocateBytes(size_t size, size_t alignment);
+    void addBlock(size_t size);
+
+    std::vector<Block> blocks;
+    size_t offset = 0;
+    size_t usedBytes = 0;
+};
+
+#endif // !FRAME_ARENA_H
@@ -0,0 +1,88 @@
+#include "frame_timing.h"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+#include <fmt/format.h>
+using namespace fmt;
+
+GpuFrameTimer::GpuFrameTimer() {
+    glGenQueries(GLsizei(QUERY_COUNT), this->queries);
+}
+
+GpuFrameTimer::~GpuFrameTimer() {
+    glDeleteQueries(GLsizei(QUERY_COUNT), this->queries);
+}
+
+void GpuFrameTimer::begin() {
+    // every query is in use, the oldest one has to be read before it can be reused
+    if (this->begun - this->collected == QUERY_COUNT) {
+        GLuint64 nanoseconds = 0;
+        glGetQueryObjectui64v(this->queries[this->collected % QUERY_COUNT], GL_QUERY_RESULT, &nanoseconds);
+        this->pending.push_back(nanoseconds / 1e6);
+        this->collected++;
+    }
+    glBeginQuery(GL_TIME_ELAPSED, this->queries[this->begun % QUERY_COUNT]);
+}
+
+void GpuFrameTimer::end() {
+    glEndQuery(GL_TIME_ELAPSED);
+    this->begun++;
+}
+
+std::vector<double> GpuFrameTimer::collect(bool wait) {
+    std::vector<double> times = std::move(this->pending);
+    this->pending.clear();
+    while (this->collected < this->begun) {
+        GLuint query = this->queries[this->collected % QUERY_COUNT];
+        if (!wait) {
+            GLint available = GL_FALSE;
+            glGetQueryObjectiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+            if (!available) {
+                break;
+            }
+        }
+        GLuint64 nanoseconds = 0;
+        glGetQueryObjectui64v(query, GL_QUERY_RESULT, &nanoseconds);
+        times.push_back(nanoseconds / 1e6);
+        this->collected++;
+    }
+    return times;
+}
+
+void FrameReport::addCpuTime(double milliseconds) {
+    this->cpuTimes.push_back(milliseconds);
+}
+
+void FrameReport::addGpuTimes(const std::vector<double>& milliseconds) {
+    this->gpuTimes.insert(this->gpuTimes.end(), milliseconds.begin(), milliseconds.end());
+}
+
+void FrameReport::addFrameTime(double milliseconds) {
+    this->frameTimes.push_back(milliseconds);
+}
+
+static void printRow(FILE* file, const char* name, std::vector<double> times) {
+    if (times.empty()) {
+        print(file, "{:<6} no samples\n", name);
+        return;
+    }
+    std::sort(times.begin(), times.end());
+    double sum = 0.0;
+    for (double time : times) {
+        sum += time;
+    }
+    // nearest rank percentile
+    size_t p99 = size_t(std::ceil(0.99 * double(times.size()))) - 1;
+    print(file, "{:<6} {:9.3f} {:9.3f} {:9.3f} {:9.3f}\n", name, times.front(), sum / double(times.size()), times[p99],
+          times.back());
+}
+
+void FrameReport::print(FILE* file) const {
+    fmt::print(file, "{} frames, milliseconds per frame\n", this->cpuTimes.size());
+    fmt::print(file, "{:<6} {:>9} {:>9} {:>9} {:>9}\n", "", "min", "avg", "p99", "max");
+    printRow(file, "CPU", this->cpuTimes);
+    printRow(file, "GPU", this->gpuTimes);
+    printRow(file, "Frame", this->frameTimes);
+}
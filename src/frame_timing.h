@@ -0,0 +1,54 @@
+#ifndef FRAME_TIMING_H
+#define FRAME_TIMING_H
+
+#include <cstdio>
+#include <vector>
+
+#include <GL/glew.h>
+
+// measures the GPU time of every frame with GL_TIME_ELAPSED queries. The results are read a few frames later, so the
+// CPU only waits for the GPU if it is that many frames ahead.
+class GpuFrameTimer {
+public:
+    GpuFrameTimer();
+    ~GpuFrameTimer();
+    GpuFrameTimer(const GpuFrameTimer&) = delete;
+    GpuFrameTimer& operator=(const GpuFrameTimer&) = delete;
+
+    void begin();
+    void end();
+    // GPU milliseconds of the frames finished since the last call, in frame order. With wait all ended frames are
+    // returned.
+    std::vector<double> collect(bool wait = false);
+
+private:
+    static const size_t QUERY_COUNT = 4;
+
+    GLuint queries[QUERY_COUNT];
+    // frames begun and frames whose result was read
+    size_t begun = 0;
+    size_t collected = 0;
+    std::vector<double> pending;
+};
+
+// milliseconds of each frame of a run, summarized as minimum, average, 99th percentile and maximum
+class FrameReport {
+public:
+    // time spent on the CPU submitting a frame
+    void addCpuTime(double milliseconds);
+    void addGpuTimes(const std::vector<double>& milliseconds);
+    // time from the start of a frame to the start of the next one
+    void addFrameTime(double milliseconds);
+
+    size_t frameCount() const {
+        return this->cpuTimes.size();
+    }
+    void print(FILE* file) const;
+
+private:
+    std::vector<double> cpuTimes;
+    std::vector<double> gpuTimes;
+    std::vector<double> frameTimes;
+};
+
+#endif // !FRAME_TIMING_H
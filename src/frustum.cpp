@@ -0,0 +1,75 @@
+#include "frustum.h"
+
+#include <cmath>
+
+Frustum::Frustum(const glm::mat4& matrix) {
+    // Gribb/Hartmann: the planes are sums and differences of the fourth row with the other rows
+    for (int plane = 0; plane < 6; plane++) {
+        int row = plane / 2;
+        float sign = plane % 2 == 0 ? 1.0f : -1.0f;
+        float x = matrix[0][3] + sign * matrix[0][row];
+        float y = matrix[1][3] + sign * matrix[1][row];
+        float z = matrix[2][3] + sign * matrix[2][row];
+        float w = matrix[3][3] + sign * matrix[3][row];
+        float length = std::sqrt(x * x + y * y + z * z);
+        this->normalX[plane] = x / length;
+        this->normalY[plane] = y / length;
+        this->normalZ[plane] = z / length;
+        this->distance[plane] = w / length;
+    }
+}
+
+bool Frustum::intersects(const BoundingBox& box) const {
+    glm::vec3 center = box.center();
+    glm::vec3 extent = box.extent();
+    for (int plane = 0; plane < 6; plane++) {
+        float distance = this->normalX[plane] * center.x + this->normalY[plane] * center.y +
+                         this->normalZ[plane] * center.z + this->distance[plane];
+        float radius = std::abs(this->normalX[plane]) * extent.x + std::abs(this->normalY[plane]) * extent.y +
+                       std::abs(this->normalZ[plane]) * extent.z;
+        if (distance + radius < 0.0f) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Frustum::intersects(const BoundingSphere& sphere) const {
+    for (int plane = 0; plane < 6; plane++) {
+        float distance = this->normalX[plane] * sphere.center.x + this->normalY[plane] * sphere.center.y +
+                         this->normalZ[plane] * sphere.center.z + this->distance[plane];
+        if (distance + sphere.radius < 0.0f) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void Frustum::intersects(const BoundingBoxList& boxes, unsigned char* visible) const {
+    size_t count = boxes.size();
+    const float* centerX = boxes.centerX.data();
+    const float* centerY = boxes.centerY.data();
+    const float* centerZ = boxes.centerZ.data();
+    const float* extentX = boxes.extentX.data();
+    const float* extentY = boxes.extentY.data();
+    const float* extentZ = boxes.extentZ.data();
+
+    for (size_t i = 0; i < count; i++) {
+        visible[i] = 1;
+    }
+    // branch free inner loop over the boxes, the compiler vectorizes it
+    for (int plane = 0; plane < 6; plane++) {
+        float x = this->normalX[plane];
+        float y = this->normalY[plane];
+        float z = this->normalZ[plane];
+        float w = this->distance[plane];
+        float absoluteX = std::abs(x);
+        float absoluteY = std::abs(y);
+        float absoluteZ = std::abs(z);
+        for (size_t i = 0; i < count; i++) {
+            float distance = x * centerX[i] + y * centerY[i] + z * centerZ[i] + w;
+            float radius = absoluteX * extentX[i] + absoluteY * extentY[i] + absoluteZ * extentZ[i];
+            visible[i] &= static_cast<unsigned char>(distance + radius >= 0.0f);
+        }
+    }
+}
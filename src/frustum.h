@@ -0,0 +1,27 @@
+#ifndef FRUSTUM_H
+#define FRUSTUM_H
+
+#include "bounds.h"
+
+#include <glm/mat4x4.hpp>
+
+// the six clipping planes of a view projection matrix. Bounds are tested in the space the matrix transforms from,
+// so the frustum of projection * view * model culls boxes in model space.
+class Frustum {
+public:
+    explicit Frustum(const glm::mat4& matrix);
+
+    bool intersects(const BoundingBox& box) const;
+    bool intersects(const BoundingSphere& sphere) const;
+    // visible[i] is set to 1 if boxes[i] intersects the frustum, 0 otherwise
+    void intersects(const BoundingBoxList& boxes, unsigned char* visible) const;
+
+private:
+    // planes as structure of arrays, a point p is inside if dot(normal, p) + distance >= 0 for all planes
+    float normalX[6];
+    float normalY[6];
+    float normalZ[6];
+    float distance[6];
+};
+
+#endif // !FRUSTUM_H
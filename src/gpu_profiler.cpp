@@ -0,0 +1,91 @@
+#include "gpu_profiler.h"
+
+GpuProfiler gpuProfiler;
+
+// end of a scope which was not ended before its frame was read
+const size_t NOT_ENDED = ~size_t(0);
+
+void GpuProfiler::beginFrame() {
+    if (this->track < 0) {
+        this->track = profiler.addTrack("GPU");
+    }
+    this->openScopes.clear();
+    this->frameIndex++;
+    Frame& frame = this->frames[this->frameIndex % FRAME_LATENCY];
+    // waits if the GPU is more than FRAME_LATENCY frames behind
+    this->read(frame);
+    // the GPU time once the commands issued so far reached the driver, which is close enough to line the tracks up
+    GLint64 gpuTime = 0;
+    glGetInteger64v(GL_TIMESTAMP, &gpuTime);
+    frame.clockOffset = profiler.now() - gpuTime / 1e3;
+    frame.pending = true;
+    this->started = true;
+}
+
+void GpuProfiler::read(Frame& frame) {
+    if (frame.pending) {
+        std::vector<GLuint64> timestamps(frame.usedQueries);
+        for (size_t i = 0; i < frame.usedQueries; i++) {
+            glGetQueryObjectui64v(frame.queries[i], GL_QUERY_RESULT, &timestamps[i]);
+        }
+        std::vector<ProfileEvent> events;
+        for (const auto& scope : frame.scopes) {
+            if (scope.end == NOT_ENDED) {
+                continue;
+            }
+            ProfileEvent event;
+            event.name = scope.name;
+            event.start = timestamps[scope.begin] / 1e3 + frame.clockOffset;
+            event.duration = (timestamps[scope.end] - timestamps[scope.begin]) / 1e3;
+            event.depth = scope.depth;
+            event.track = this->track;
+            events.push_back(event);
+        }
+        profiler.addEvents(events);
+    }
+    frame.usedQueries = 0;
+    frame.scopes.clear();
+    frame.pending = false;
+}
+
+bool GpuProfiler::beginScope(const char* name) {
+    if (!this->started || !profiler.isEnabled()) {
+        return false;
+    }
+    Frame& frame = this->frames[this->frameIndex % FRAME_LATENCY];
+    this->openScopes.push_back(frame.scopes.size());
+    frame.scopes.push_back(Scope{name, int(this->openScopes.size()) - 1, this->timestamp(), NOT_ENDED});
+    return true;
+}
+
+void GpuProfiler::endScope() {
+    Frame& frame = this->frames[this->frameIndex % FRAME_LATENCY];
+    frame.scopes[this->openScopes.back()].end = this->timestamp();
+    this->openScopes.pop_back();
+}
+
+size_t GpuProfiler::timestamp() {
+    Frame& frame = this->frames[this->frameIndex % FRAME_LATENCY];
+    if (frame.usedQueries == frame.queries.size()) {
+        GLuint query;
+        glGenQueries(1, &query);
+        frame.queries.push_back(query);
+    }
+    glQueryCounter(frame.queries[frame.usedQueries], GL_TIMESTAMP);
+    return frame.usedQueries++;
+}
+
+void GpuProfiler::release() {
+    // oldest frame first
+    for (size_t i = 1; i <= FRAME_LATENCY; i++) {
+        this->read(this->frames[(this->frameIndex + i) % FRAME_LATENCY]);
+    }
+    for (auto& frame : this->frames) {
+        if (!frame.queries.empty()) {
+            glDeleteQueries(GLsizei(frame.queries.size()), frame.queries.data());
+        }
+        frame = Frame();
+    }
+    this->openScopes.clear();
+    this->started = false;
+}
@@ -0,0 +1,79 @@
+#ifndef GPU_PROFILER_H
+#define GPU_PROFILER_H
+
+#include "profiler.h"
+
+#include <cstddef>
+#include <vector>
+
+#include <GL/glew.h>
+
+// measures GPU scopes with GL_TIMESTAMP queries, which unlike GL_TIME_ELAPSED queries can nest. The queries of a frame
+// are read FRAME_LATENCY frames later so the CPU does not wait for the GPU, the results are passed to the profiler on
+// a "GPU" track, converted to its clock. Render thread only, the queries are created while scopes are begun.
+class GpuProfiler {
+public:
+    // reads the scopes of the frame which used the same queries, then starts a frame
+    void beginFrame();
+    // returns false if the profiler is disabled or no frame was begun, endScope must only be called for scopes which
+    // returned true
+    bool beginScope(const char* name);
+    void endScope();
+    // passes the scopes of the pending frames to the profiler and deletes the queries, has to be called while the
+    // context is current
+    void release();
+
+private:
+    static const size_t FRAME_LATENCY = 2;
+
+    struct Scope {
+        const char* name;
+        int depth;
+        // indices of the begin and end timestamp in the queries of the frame
+        size_t begin;
+        size_t end;
+    };
+
+    struct Frame {
+        std::vector<GLuint> queries;
+        size_t usedQueries = 0;
+        std::vector<Scope> scopes;
+        // profiler time minus GPU time in microseconds, measured when the frame began
+        double clockOffset = 0.0;
+        bool pending = false;
+    };
+
+    // passes the scopes of frame to the profiler
+    void read(Frame& frame);
+    size_t timestamp();
+
+    Frame frames[FRAME_LATENCY];
+    size_t frameIndex = 0;
+    bool started = false;
+    int track = -1;
+    // scopes of the current frame which were begun but not ended yet
+    std::vector<size_t> openScopes;
+};
+
+extern GpuProfiler gpuProfiler;
+
+// measures the GPU commands issued in the rest of the enclosing block
+class GpuProfileScope {
+public:
+    explicit GpuProfileScope(const char* name) : active(gpuProfiler.beginScope(name)) {
+    }
+    ~GpuProfileScope() {
+        if (this->active) {
+            gpuProfiler.endScope();
+        }
+    }
+    GpuProfileScope(const GpuProfileScope&) = delete;
+    GpuProfileScope& operator=(const GpuProfileScope&) = delete;
+
+private:
+    bool active;
+};
+
+#define PROFILE_GPU_SCOPE(name) GpuProfileScope PROFILE_CONCATENATE(gpuProfileScope, __LINE__)(name)
+
+#endif // !GPU_PROFILER_H
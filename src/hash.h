@@ -0,0 +1,29 @@
+#ifndef HASH_H
+#define HASH_H
+
+#include <cstddef>
+#include <cstdint>
+
+constexpr uint64_t FNV_OFFSET_BASIS = 14695981039346656037ULL;
+constexpr uint64_t FNV_PRIME = 1099511628211ULL;
+
+// 64 bit FNV-1a, used to fingerprint asset files
+inline uint64_t hashBytes(const void* data, size_t size, uint64_t hash = FNV_OFFSET_BASIS) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+// same hash for null terminated strings, usable at compile time
+constexpr uint64_t hashString(const char* string, uint64_t hash = FNV_OFFSET_BASIS) {
+    for (; *string != '\0'; string++) {
+        hash ^= static_cast<unsigned char>(*string);
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+#endif // !HASH_H
@@ -0,0 +1,141 @@
+#include "headless_context.h"
+
+#include <stdexcept>
+
+#ifdef HAVE_EGL
+// keeps Xlib and its macros out, the surfaceless platform does not need a display server
+#define EGL_NO_X11
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+#include <fmt/format.h>
+using namespace fmt;
+
+// same as the window, see Program::initGlfw
+const int HEADLESS_SAMPLES = 4;
+
+#ifdef HAVE_EGL
+
+#ifndef EGL_PLATFORM_SURFACELESS_MESA
+#define EGL_PLATFORM_SURFACELESS_MESA 0x31DD
+#endif
+
+std::unique_ptr<HeadlessContext> HeadlessContext::create(int width, int height) {
+    std::unique_ptr<HeadlessContext> headless(new HeadlessContext());
+    headless->framebufferWidth = width;
+    headless->framebufferHeight = height;
+
+    // the surfaceless platform needs neither X11 nor a GPU device, fall back to the default display without it
+    EGLDisplay display = EGL_NO_DISPLAY;
+    auto getPlatformDisplay =
+        reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(eglGetProcAddress("eglGetPlatformDisplayEXT"));
+    if (getPlatformDisplay) {
+        display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+    }
+    if (display == EGL_NO_DISPLAY) {
+        display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    }
+    EGLint major, minor;
+    if (display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor)) {
+        throw std::runtime_error("Failed to initialize EGL");
+    }
+    headless->display = display;
+
+    const EGLint configAttributes[] = {EGL_SURFACE_TYPE, EGL_PBUFFER_BIT, EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+                                       EGL_NONE};
+    EGLConfig config;
+    EGLint configCount = 0;
+    if (!eglBindAPI(EGL_OPENGL_API) || !eglChooseConfig(display, configAttributes, &config, 1, &configCount) ||
+        configCount == 0) {
+        throw std::runtime_error(format("EGL {}.{} does not support desktop OpenGL", major, minor));
+    }
+
+    const EGLint contextAttributes[] = {EGL_CONTEXT_MAJOR_VERSION_KHR,
+                                        4,
+                                        EGL_CONTEXT_MINOR_VERSION_KHR,
+                                        1,
+                                        EGL_CONTEXT_OPENGL_PROFILE_MASK_KHR,
+                                        EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT_KHR,
+                                        EGL_NONE};
+    EGLContext context = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttributes);
+    if (context == EGL_NO_CONTEXT) {
+        throw std::runtime_error("Failed to create an OpenGL 4.1 core context with EGL");
+    }
+    headless->context = context;
+    // EGL_KHR_surfaceless_context, there is nothing to draw to but framebuffer objects
+    if (!eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context)) {
+        throw std::runtime_error("Failed to make the EGL context current without a surface");
+    }
+    return headless;
+}
+
+HeadlessContext::~HeadlessContext() {
+    if (this->framebuffer != 0) {
+        glDeleteFramebuffers(1, &this->framebuffer);
+        glDeleteRenderbuffers(1, &this->colorBuffer);
+        glDeleteRenderbuffers(1, &this->depthBuffer);
+    }
+    if (this->context) {
+        eglMakeCurrent(this->display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        eglDestroyContext(this->display, this->context);
+    }
+    if (this->display) {
+        eglTerminate(this->display);
+    }
+}
+
+#else
+
+std::unique_ptr<HeadlessContext> HeadlessContext::create(int /*unused*/, int /*unused*/) {
+    throw std::runtime_error("Headless rendering needs EGL, which was not found when building");
+}
+
+HeadlessContext::~HeadlessContext() {
+}
+
+#endif
+
+void HeadlessContext::initGlew() {
+    glewExperimental = GL_TRUE;
+    GLenum result = glewInit();
+#ifdef GLEW_ERROR_NO_GLX_DISPLAY
+    // GLEW built for GLX loads the GL functions first and then fails to find the X display for the GLX extensions,
+    // which an EGL context does not need
+    if (result == GLEW_ERROR_NO_GLX_DISPLAY) {
+        result = GLEW_OK;
+    }
+#endif
+    if (result != GLEW_OK) {
+        throw std::runtime_error(
+            format("Failed to initialize GLEW: {}", reinterpret_cast<const char*>(glewGetErrorString(result))));
+    }
+}
+
+void HeadlessContext::initFramebuffer() {
+    glGenRenderbuffers(1, &this->colorBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, this->colorBuffer);
+    glRenderbufferStorageMultisample(GL_RENDERBUFFER, HEADLESS_SAMPLES, GL_RGBA8, this->framebufferWidth,
+                                     this->framebufferHeight);
+    glGenRenderbuffers(1, &this->depthBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, this->depthBuffer);
+    glRenderbufferStorageMultisample(GL_RENDERBUFFER, HEADLESS_SAMPLES, GL_DEPTH_COMPONENT24, this->framebufferWidth,
+                                     this->framebufferHeight);
+
+    glGenFramebuffers(1, &this->framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, this->framebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, this->colorBuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, this->depthBuffer);
+    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    if (status != GL_FRAMEBUFFER_COMPLETE) {
+        throw std::runtime_error(format("Headless framebuffer is incomplete (0x{:x})", status));
+    }
+    glViewport(0, 0, this->framebufferWidth, this->framebufferHeight);
+}
+
+std::string HeadlessContext::renderer() const {
+    const GLubyte* renderer = glGetString(GL_RENDERER);
+    const GLubyte* version = glGetString(GL_VERSION);
+    return format("{}, OpenGL {}", renderer ? reinterpret_cast<const char*>(renderer) : "unknown",
+                  version ? reinterpret_cast<const char*>(version) : "unknown");
+}
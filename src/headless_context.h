@@ -0,0 +1,47 @@
+#ifndef HEADLESS_CONTEXT_H
+#define HEADLESS_CONTEXT_H
+
+#include <memory>
+#include <string>
+
+#include <GL/glew.h>
+
+// OpenGL 4.1 core context without a window or a display server, created with EGL on Mesa's surfaceless platform so it
+// also works on machines without a GPU (llvmpipe). There is no default framebuffer, frames are drawn into a
+// multisampled framebuffer object instead.
+class HeadlessContext {
+public:
+    // makes the context current on the calling thread, throws if EGL or an OpenGL 4.1 core context are not available
+    static std::unique_ptr<HeadlessContext> create(int width, int height);
+    ~HeadlessContext();
+    HeadlessContext(const HeadlessContext&) = delete;
+    HeadlessContext& operator=(const HeadlessContext&) = delete;
+
+    // loads the GL functions of the context with GLEW, throws if that fails
+    void initGlew();
+    // creates and binds the framebuffer object, the GL functions have to be loaded by GLEW first
+    void initFramebuffer();
+
+    int width() const {
+        return this->framebufferWidth;
+    }
+    int height() const {
+        return this->framebufferHeight;
+    }
+    // renderer and version string of the driver, e.g. to tell llvmpipe and GPU results apart
+    std::string renderer() const;
+
+private:
+    HeadlessContext() = default;
+
+    // EGLDisplay and EGLContext, kept opaque so the EGL headers stay out of this header
+    void* display = nullptr;
+    void* context = nullptr;
+    int framebufferWidth = 0;
+    int framebufferHeight = 0;
+    GLuint framebuffer = 0;
+    GLuint colorBuffer = 0;
+    GLuint depthBuffer = 0;
+};
+
+#endif // !HEADLESS_CONTEXT_H
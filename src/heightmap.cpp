@@ -1,40 +1,60 @@
 #include "heightmap.h"
 
-#include <glm/vec3.hpp>
-#include <vector>
+#include <algorithm>
+#include <stdexcept>
 
 #include <stb_image.h>
 
 #include <fmt/format.h>
 using namespace fmt;
 
-Object loadHeightMap(std::string path) {
+HeightMap HeightMap::loadFromFile(const std::string& path) {
     int width, height, nrChannels;
-    unsigned char* data = stbi_load(path.c_str(), &width, &height, &nrChannels, 0);
+    bool wide = stbi_is_16_bit(path.c_str());
+    void* data = wide ? static_cast<void*>(stbi_load_16(path.c_str(), &width, &height, &nrChannels, 0))
+                      : static_cast<void*>(stbi_load(path.c_str(), &width, &height, &nrChannels, 0));
     if (!data) {
         throw std::runtime_error(format("Failed to load texture {}", path));
     }
     if (nrChannels != 1) {
-        throw new std::runtime_error(format("Heightmap has more than one color: {}", path));
+        stbi_image_free(data);
+        throw std::runtime_error(format("Heightmap has more than one color: {}", path));
     }
 
-    std::vector<glm::vec3> vertices;
-    for (int w = 0; w < width; w++) {
-        for (int h = 0; h < height; h++) {
-            unsigned char elevation = data[w + h * width];
-            vertices.push_back(glm::vec3(w, elevation / 16, h));
-        }
+    HeightMap heightMap;
+    heightMap.columns = width;
+    heightMap.rows = height;
+    heightMap.samples.resize(size_t(width) * height);
+    if (wide) {
+        const uint16_t* samples = static_cast<const uint16_t*>(data);
+        std::copy(samples, samples + heightMap.samples.size(), heightMap.samples.begin());
+    } else {
+        // 255 * 257 = 65535, so the full 8 bit range maps to the full 16 bit range
+        const unsigned char* samples = static_cast<const unsigned char*>(data);
+        std::transform(samples, samples + heightMap.samples.size(), heightMap.samples.begin(),
+                       [](unsigned char sample) { return uint16_t(sample * 257); });
     }
+    stbi_image_free(data);
+    return heightMap;
+}
 
-    std::vector<glm::uvec3> indices;
-    for (int w = 0; w < width - 1; w++) {
-        for (int h = 0; h < height - 1; h++) {
-            // upper left triangle, CCW
-            indices.push_back(glm::uvec3(w + h * height, w + (h + 1) * height, w + 1 + h * height));
-            // lower right triangle, CCW
-            indices.push_back(glm::uvec3(w + (h + 1) * height, w + 1 + (h + 1) * height, w + 1 + h * height));
-        }
+HeightMap HeightMap::fromSamples(int width, int height, std::vector<uint16_t> samples) {
+    if (width <= 0 || height <= 0 || samples.size() != size_t(width) * height) {
+        throw std::runtime_error(format("Heightmap needs {}x{} samples, got {}", width, height, samples.size()));
     }
+    HeightMap heightMap;
+    heightMap.columns = width;
+    heightMap.rows = height;
+    heightMap.samples = std::move(samples);
+    return heightMap;
+}
+
+float HeightMap::elevation(int x, int z) const {
+    x = std::min(std::max(x, 0), this->columns - 1);
+    return this->row(z)[x] * HEIGHTMAP_ELEVATION_SCALE;
+}
 
-    return Object(vertices, indices);
+const uint16_t* HeightMap::row(int z) const {
+    z = std::min(std::max(z, 0), this->rows - 1);
+    return &this->samples[size_t(z) * this->columns];
 }
@@ -1,10 +1,36 @@
 #ifndef HEIGHTMAP_H
 #define HEIGHTMAP_H
 
-#include "object.h"
-
+#include <cstdint>
 #include <string>
+#include <vector>
+
+// elevation in world units of one 16 bit sample, an 8 bit map has one world unit per 16 color values
+const float HEIGHTMAP_ELEVATION_SCALE = 1.0f / (16.0f * 257.0f);
+
+// 16 bit elevation samples of a grayscale heightmap image
+class HeightMap {
+public:
+    // 8 bit maps are widened to 16 bit
+    static HeightMap loadFromFile(const std::string& path);
+    static HeightMap fromSamples(int width, int height, std::vector<uint16_t> samples);
+
+    int width() const {
+        return this->columns;
+    }
+    int height() const {
+        return this->rows;
+    }
+    // elevation in world units, coordinates are clamped to the edge of the map
+    float elevation(int x, int z) const;
+    // samples of row z, which is clamped to the edge of the map
+    const uint16_t* row(int z) const;
 
-Object loadHeightMap(std::string path);
+private:
+    HeightMap() = default;
+    int columns = 0;
+    int rows = 0;
+    std::vector<uint16_t> samples;
+};
 
-#endif // !HEIGHTMAP_H
\ No newline at end of file
+#endif // !HEIGHTMAP_H
@@ -1,11 +1,49 @@
 #include "program.h"
 
-#define STB_IMAGE_IMPLEMENTATION
-#include <stb_image.h>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+#include <fmt/format.h>
+using namespace fmt;
+
+static void printUsage(const char* name) {
+    print(stderr,
+          "usage: {} [--fleet <ships>] [--vertex-format float|half|snorm16] [--texture-budget <MB>] "
+          "[--headless <frames>] [--trace <file>] [--no-occlusion]\n",
+          name);
+}
+
+int main(int argc, char** argv) {
+    ProgramOptions options;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--fleet") == 0 && i + 1 < argc) {
+            options.fleetSize = std::max(std::atoi(argv[++i]), 0);
+        } else if (std::strcmp(argv[i], "--vertex-format") == 0 && i + 1 < argc) {
+            try {
+                options.vertexFormat = parseVertexFormat(argv[++i]);
+            } catch (const std::runtime_error& error) {
+                print(stderr, "{}\n", error.what());
+                printUsage(argv[0]);
+                return 1;
+            }
+        } else if (std::strcmp(argv[i], "--texture-budget") == 0 && i + 1 < argc) {
+            options.textureBudget = size_t(std::max(std::atoi(argv[++i]), 0)) * 1024 * 1024;
+        } else if (std::strcmp(argv[i], "--headless") == 0 && i + 1 < argc) {
+            options.headlessFrames = std::max(std::atoi(argv[++i]), 1);
+        } else if (std::strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+            options.tracePath = argv[++i];
+        } else if (std::strcmp(argv[i], "--no-occlusion") == 0) {
+            options.occlusionCulling = false;
+        } else {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
 
-int main() {
     Program program;
-    program.init();
+    program.init(options);
     program.mainLoop();
     return 0;
 }
@@ -0,0 +1,124 @@
+#include "mapped_file.h"
+
+#include <stdexcept>
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <fmt/format.h>
+using namespace fmt;
+
+#ifdef _WIN32
+MappedFile MappedFile::open(const std::string& path) {
+    MappedFile mappedFile;
+    // shared for writing so the source stamp of a mapped cooked file can be updated, see isCookedFrom
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        throw std::runtime_error(format("Failed to open file {}", path));
+    }
+    mappedFile.file = file;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size)) {
+        throw std::runtime_error(format("Failed to get size of file {}", path));
+    }
+    mappedFile.length = static_cast<size_t>(size.QuadPart);
+    if (mappedFile.length == 0) {
+        return mappedFile;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping) {
+        throw std::runtime_error(format("Failed to map file {}", path));
+    }
+    mappedFile.mapping = mapping;
+    mappedFile.bytes = static_cast<const unsigned char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+    if (!mappedFile.bytes) {
+        throw std::runtime_error(format("Failed to map file {}", path));
+    }
+    return mappedFile;
+}
+
+void MappedFile::close() {
+    if (this->bytes) {
+        UnmapViewOfFile(this->bytes);
+    }
+    if (this->mapping) {
+        CloseHandle(this->mapping);
+    }
+    if (this->file) {
+        CloseHandle(this->file);
+    }
+    this->bytes = nullptr;
+    this->mapping = nullptr;
+    this->file = nullptr;
+    this->length = 0;
+}
+#else
+MappedFile MappedFile::open(const std::string& path) {
+    MappedFile mappedFile;
+    int file = ::open(path.c_str(), O_RDONLY);
+    if (file < 0) {
+        throw std::runtime_error(format("Failed to open file {}", path));
+    }
+
+    struct stat status;
+    if (fstat(file, &status) != 0) {
+        ::close(file);
+        throw std::runtime_error(format("Failed to get size of file {}", path));
+    }
+    mappedFile.length = static_cast<size_t>(status.st_size);
+    if (mappedFile.length == 0) {
+        ::close(file);
+        return mappedFile;
+    }
+
+    // the mapping stays valid after the file descriptor is closed
+    void* bytes = mmap(nullptr, mappedFile.length, PROT_READ, MAP_PRIVATE, file, 0);
+    ::close(file);
+    if (bytes == MAP_FAILED) {
+        throw std::runtime_error(format("Failed to map file {}", path));
+    }
+    mappedFile.bytes = static_cast<const unsigned char*>(bytes);
+    return mappedFile;
+}
+
+void MappedFile::close() {
+    if (this->bytes) {
+        munmap(const_cast<unsigned char*>(this->bytes), this->length);
+    }
+    this->bytes = nullptr;
+    this->length = 0;
+}
+#endif
+
+MappedFile::MappedFile(MappedFile&& other) noexcept {
+    *this = std::move(other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+    if (this != &other) {
+        this->close();
+        std::swap(this->bytes, other.bytes);
+        std::swap(this->length, other.length);
+#ifdef _WIN32
+        std::swap(this->file, other.file);
+        std::swap(this->mapping, other.mapping);
+#endif
+    }
+    return *this;
+}
+
+MappedFile::~MappedFile() {
+    this->close();
+}
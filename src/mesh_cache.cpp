@@ -0,0 +1,167 @@
+#include "mesh_cache.h"
+
+#include "source_stamp.h"
+
+#include <cstddef>
+#include <cstring>
+#include <ostream>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include <fmt/format.h>
+using namespace fmt;
+
+static const char MESH_CACHE_MAGIC[4] = {'O', 'M', 'S', 'H'};
+static const uint64_t DATA_ALIGNMENT = 16;
+
+static_assert(sizeof(Vertex) == 32, "Vertex layout changed, bump MESH_CACHE_VERSION");
+static_assert(sizeof(Submesh) == 36, "Submesh layout changed, bump MESH_CACHE_VERSION");
+
+static uint64_t alignOffset(uint64_t offset) {
+    return (offset + DATA_ALIGNMENT - 1) / DATA_ALIGNMENT * DATA_ALIGNMENT;
+}
+
+std::string MeshCache::pathFor(const std::string& sourcePath) {
+    return sourcePath + ".mesh";
+}
+
+std::unique_ptr<MeshCache> MeshCache::open(const std::string& cachePath, const std::string& sourcePath) {
+    SourceStamp cacheStamp;
+    if (!stampSource(cachePath, cacheStamp) || cacheStamp.size < sizeof(MeshCacheHeader)) {
+        return nullptr;
+    }
+
+    std::unique_ptr<MeshCache> cache(new MeshCache(MappedFile::open(cachePath)));
+    const MeshCacheHeader* header = cache->header;
+    if (memcmp(header->magic, MESH_CACHE_MAGIC, sizeof(MESH_CACHE_MAGIC)) != 0 ||
+        header->version != MESH_CACHE_VERSION || header->vertexSize != sizeof(Vertex) ||
+        header->indexSize != sizeof(uint32_t)) {
+        return nullptr;
+    }
+
+    // offsets are compared before the sizes are added, a corrupt offset close to 2^64 would wrap around otherwise
+    uint64_t fileSize = cache->file.size();
+    if (header->vertexOffset > fileSize ||
+        uint64_t(header->vertexCount) * sizeof(Vertex) > fileSize - header->vertexOffset ||
+        header->indexOffset > fileSize ||
+        uint64_t(header->indexCount) * sizeof(uint32_t) > fileSize - header->indexOffset ||
+        header->submeshOffset > fileSize ||
+        uint64_t(header->submeshCount) * sizeof(Submesh) > fileSize - header->submeshOffset ||
+        header->materialOffset > fileSize ||
+        uint64_t(header->materialCount) * sizeof(MeshCacheMaterial) > fileSize - header->materialOffset) {
+        return nullptr;
+    }
+
+    SourceStamp stamp;
+    stamp.size = header->sourceSize;
+    stamp.modificationTime = header->sourceModificationTime;
+    if (!isCookedFrom(sourcePath, stamp, header->sourceHash, cachePath, offsetof(MeshCacheHeader, sourceSize))) {
+        return nullptr;
+    }
+    return cache;
+}
+
+void MeshCache::write(const std::string& cachePath, const std::string& sourcePath, const MeshData& mesh) {
+    SourceStamp sourceStamp;
+    if (!stampSource(sourcePath, sourceStamp)) {
+        throw std::runtime_error(format("Failed to read source of mesh cache {}", sourcePath));
+    }
+
+    MeshCacheHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, MESH_CACHE_MAGIC, sizeof(MESH_CACHE_MAGIC));
+    header.version = MESH_CACHE_VERSION;
+    header.vertexSize = sizeof(Vertex);
+    header.indexSize = sizeof(uint32_t);
+    header.sourceSize = sourceStamp.size;
+    header.sourceModificationTime = sourceStamp.modificationTime;
+    header.sourceHash = hashFile(sourcePath);
+    header.vertexCount = static_cast<uint32_t>(mesh.vertices.size());
+    header.indexCount = static_cast<uint32_t>(mesh.indices.size());
+    header.submeshCount = static_cast<uint32_t>(mesh.submeshes.size());
+    header.materialCount = static_cast<uint32_t>(mesh.materials.size());
+    header.vertexOffset = alignOffset(sizeof(MeshCacheHeader));
+    header.indexOffset = alignOffset(header.vertexOffset + mesh.vertices.size() * sizeof(Vertex));
+    header.submeshOffset = alignOffset(header.indexOffset + mesh.indices.size() * sizeof(uint32_t));
+    header.materialOffset = alignOffset(header.submeshOffset + mesh.submeshes.size() * sizeof(Submesh));
+    for (int i = 0; i < 3; i++) {
+        header.boundsMin[i] = mesh.boundsMin[i];
+        header.boundsMax[i] = mesh.boundsMax[i];
+    }
+
+    std::vector<MeshCacheMaterial> materials(mesh.materials.size());
+    for (size_t i = 0; i < mesh.materials.size(); i++) {
+        const std::string& texture = mesh.materials[i].diffuseTexture;
+        if (texture.size() >= MESH_CACHE_PATH_LENGTH) {
+            throw std::runtime_error(format("Texture path {} is too long for the mesh cache", texture));
+        }
+        memset(materials[i].diffuseTexture, 0, MESH_CACHE_PATH_LENGTH);
+        memcpy(materials[i].diffuseTexture, texture.c_str(), texture.size());
+    }
+
+    bool written = writeCookedFile(cachePath, [&](std::ostream& out) {
+        uint64_t position = 0;
+        auto writeAt = [&out, &position](uint64_t offset, const void* data, size_t size) {
+            static const char padding[DATA_ALIGNMENT] = {};
+            out.write(padding, offset - position);
+            out.write(static_cast<const char*>(data), size);
+            position = offset + size;
+        };
+        writeAt(0, &header, sizeof(header));
+        writeAt(header.vertexOffset, mesh.vertices.data(), mesh.vertices.size() * sizeof(Vertex));
+        writeAt(header.indexOffset, mesh.indices.data(), mesh.indices.size() * sizeof(uint32_t));
+        writeAt(header.submeshOffset, mesh.submeshes.data(), mesh.submeshes.size() * sizeof(Submesh));
+        writeAt(header.materialOffset, materials.data(), materials.size() * sizeof(MeshCacheMaterial));
+    });
+    if (!written) {
+        throw std::runtime_error(format("Failed to write mesh cache {}", cachePath));
+    }
+}
+
+MeshCache::MeshCache(MappedFile file) : file(std::move(file)) {
+    this->header = reinterpret_cast<const MeshCacheHeader*>(this->file.data());
+}
+
+const Vertex* MeshCache::vertices() const {
+    return reinterpret_cast<const Vertex*>(this->file.data() + this->header->vertexOffset);
+}
+
+uint32_t MeshCache::vertexCount() const {
+    return this->header->vertexCount;
+}
+
+const uint32_t* MeshCache::indices() const {
+    return reinterpret_cast<const uint32_t*>(this->file.data() + this->header->indexOffset);
+}
+
+uint32_t MeshCache::indexCount() const {
+    return this->header->indexCount;
+}
+
+const Submesh* MeshCache::submeshes() const {
+    return reinterpret_cast<const Submesh*>(this->file.data() + this->header->submeshOffset);
+}
+
+uint32_t MeshCache::submeshCount() const {
+    return this->header->submeshCount;
+}
+
+std::vector<MaterialData> MeshCache::materials() const {
+    const MeshCacheMaterial* cached =
+        reinterpret_cast<const MeshCacheMaterial*>(this->file.data() + this->header->materialOffset);
+    std::vector<MaterialData> materials(this->header->materialCount);
+    for (size_t i = 0; i < materials.size(); i++) {
+        materials[i].diffuseTexture = std::string(cached[i].diffuseTexture,
+                                                  strnlen(cached[i].diffuseTexture, MESH_CACHE_PATH_LENGTH));
+    }
+    return materials;
+}
+
+glm::vec3 MeshCache::boundsMin() const {
+    return glm::vec3(this->header->boundsMin[0], this->header->boundsMin[1], this->header->boundsMin[2]);
+}
+
+glm::vec3 MeshCache::boundsMax() const {
+    return glm::vec3(this->header->boundsMax[0], this->header->boundsMax[1], this->header->boundsMax[2]);
+}
@@ -0,0 +1,72 @@
+#ifndef MESH_CACHE_H
+#define MESH_CACHE_H
+
+#include "mapped_file.h"
+#include "mesh_import.h"
+#include "vertex.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <glm/vec3.hpp>
+
+// bump whenever the layout of the header or of Vertex changes or when cooking produces different data
+const uint32_t MESH_CACHE_VERSION = 3;
+
+const size_t MESH_CACHE_PATH_LENGTH = 256;
+
+struct MeshCacheMaterial {
+    char diffuseTexture[MESH_CACHE_PATH_LENGTH];
+};
+
+struct MeshCacheHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t vertexSize;
+    uint32_t indexSize;
+    // the source file this cache was cooked from
+    uint64_t sourceSize;
+    int64_t sourceModificationTime;
+    uint64_t sourceHash;
+    // data layout, offsets are relative to the start of the file
+    uint64_t vertexOffset;
+    uint64_t indexOffset;
+    uint64_t submeshOffset;
+    uint64_t materialOffset;
+    uint32_t vertexCount;
+    uint32_t indexCount;
+    uint32_t submeshCount;
+    uint32_t materialCount;
+    float boundsMin[3];
+    float boundsMax[3];
+};
+
+// binary, memory mapped version of a mesh imported by Assimp
+class MeshCache {
+public:
+    static std::string pathFor(const std::string& sourcePath);
+
+    // returns nullptr if there is no cache file or if it is outdated
+    static std::unique_ptr<MeshCache> open(const std::string& cachePath, const std::string& sourcePath);
+    static void write(const std::string& cachePath, const std::string& sourcePath, const MeshData& mesh);
+
+    const Vertex* vertices() const;
+    uint32_t vertexCount() const;
+    const uint32_t* indices() const;
+    uint32_t indexCount() const;
+    const Submesh* submeshes() const;
+    uint32_t submeshCount() const;
+    std::vector<MaterialData> materials() const;
+    glm::vec3 boundsMin() const;
+    glm::vec3 boundsMax() const;
+
+private:
+    explicit MeshCache(MappedFile file);
+
+    MappedFile file;
+    const MeshCacheHeader* header = nullptr;
+};
+
+#endif // !MESH_CACHE_H
@@ -0,0 +1,135 @@
+#include "mesh_import.h"
+
+#include <assimp/Importer.hpp>
+#include <assimp/postprocess.h>
+#include <assimp/scene.h>
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+#include <glm/common.hpp>
+#include <glm/geometric.hpp>
+#include <glm/mat3x3.hpp>
+#include <glm/mat4x4.hpp>
+#include <glm/matrix.hpp>
+#include <glm/vec4.hpp>
+
+#include <fmt/format.h>
+using namespace fmt;
+
+static glm::mat4 toMat4(const aiMatrix4x4& matrix) {
+    // assimp matrices are row major, glm matrices column major
+    return glm::mat4(glm::vec4(matrix.a1, matrix.b1, matrix.c1, matrix.d1),
+                     glm::vec4(matrix.a2, matrix.b2, matrix.c2, matrix.d2),
+                     glm::vec4(matrix.a3, matrix.b3, matrix.c3, matrix.d3),
+                     glm::vec4(matrix.a4, matrix.b4, matrix.c4, matrix.d4));
+}
+
+static void appendMesh(const aiMesh* mesh, const glm::mat4& transformation, MeshData& meshData) {
+    glm::mat3 normalTransformation = glm::transpose(glm::inverse(glm::mat3(transformation)));
+    uint32_t baseVertex = static_cast<uint32_t>(meshData.vertices.size());
+
+    Submesh submesh;
+    submesh.indexOffset = static_cast<uint32_t>(meshData.indices.size());
+    submesh.material = mesh->mMaterialIndex;
+    submesh.boundsMin = glm::vec3(std::numeric_limits<float>::max());
+    submesh.boundsMax = glm::vec3(std::numeric_limits<float>::lowest());
+
+    // load vertex positions
+    for (unsigned int i = 0; i < mesh->mNumVertices; i++) {
+        Vertex vertex;
+        glm::vec4 position(mesh->mVertices[i].x, mesh->mVertices[i].y, mesh->mVertices[i].z, 1.0f);
+        vertex.position = glm::vec3(transformation * position);
+
+        if (mesh->HasTextureCoords(0)) {
+            vertex.texturePosition.x = mesh->mTextureCoords[0][i].x;
+            vertex.texturePosition.y = mesh->mTextureCoords[0][i].y;
+        }
+        if (mesh->HasNormals()) {
+            glm::vec3 normal(mesh->mNormals[i].x, mesh->mNormals[i].y, mesh->mNormals[i].z);
+            vertex.normal = glm::normalize(normalTransformation * normal);
+        }
+
+        submesh.boundsMin = glm::min(submesh.boundsMin, vertex.position);
+        submesh.boundsMax = glm::max(submesh.boundsMax, vertex.position);
+        meshData.vertices.push_back(vertex);
+    }
+
+    // load vertex incides, points and lines are skipped
+    for (unsigned int i = 0; i < mesh->mNumFaces; i++) {
+        const aiFace& face = mesh->mFaces[i];
+        if (face.mNumIndices != 3) {
+            continue;
+        }
+        for (unsigned int j = 0; j < face.mNumIndices; j++) {
+            meshData.indices.push_back(baseVertex + face.mIndices[j]);
+        }
+    }
+
+    submesh.indexCount = static_cast<uint32_t>(meshData.indices.size()) - submesh.indexOffset;
+    if (submesh.indexCount > 0) {
+        meshData.submeshes.push_back(submesh);
+    }
+}
+
+static void appendNode(const aiScene* scene, const aiNode* node, const glm::mat4& parentTransformation,
+                       MeshData& meshData) {
+    glm::mat4 transformation = parentTransformation * toMat4(node->mTransformation);
+    for (unsigned int i = 0; i < node->mNumMeshes; i++) {
+        appendMesh(scene->mMeshes[node->mMeshes[i]], transformation, meshData);
+    }
+    for (unsigned int i = 0; i < node->mNumChildren; i++) {
+        appendNode(scene, node->mChildren[i], transformation, meshData);
+    }
+}
+
+// reorders the index buffer so all submeshes with the same material are next to each other
+static void sortByMaterial(MeshData& meshData) {
+    std::stable_sort(meshData.submeshes.begin(), meshData.submeshes.end(),
+                     [](const Submesh& a, const Submesh& b) { return a.material < b.material; });
+
+    std::vector<unsigned int> indices;
+    indices.reserve(meshData.indices.size());
+    for (auto& submesh : meshData.submeshes) {
+        auto first = meshData.indices.begin() + submesh.indexOffset;
+        submesh.indexOffset = static_cast<uint32_t>(indices.size());
+        indices.insert(indices.end(), first, first + submesh.indexCount);
+    }
+    meshData.indices.swap(indices);
+}
+
+MeshData importMesh(const std::string& path) {
+    MeshData meshData;
+    Assimp::Importer importer;
+    const aiScene* scene = importer.ReadFile(path.c_str(), aiProcess_Triangulate | aiProcess_FlipUVs);
+    if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) {
+        throw std::runtime_error(format("Failed to load model from {}: {}", path, importer.GetErrorString()));
+    }
+
+    appendNode(scene, scene->mRootNode, glm::mat4(1.0f), meshData);
+    if (meshData.submeshes.empty()) {
+        throw std::runtime_error(format("Model {} does not contain any triangles", path));
+    }
+    sortByMaterial(meshData);
+
+    for (unsigned int i = 0; i < scene->mNumMaterials; i++) {
+        MaterialData material;
+        aiString texturePath;
+        // embedded textures ("*0") are not supported
+        if (scene->mMaterials[i]->GetTextureCount(aiTextureType_DIFFUSE) > 0 &&
+            scene->mMaterials[i]->GetTexture(aiTextureType_DIFFUSE, 0, &texturePath) == aiReturn_SUCCESS &&
+            texturePath.C_Str()[0] != '*') {
+            material.diffuseTexture = texturePath.C_Str();
+        }
+        meshData.materials.push_back(material);
+    }
+
+    meshData.boundsMin = meshData.submeshes[0].boundsMin;
+    meshData.boundsMax = meshData.submeshes[0].boundsMax;
+    for (const auto& submesh : meshData.submeshes) {
+        meshData.boundsMin = glm::min(meshData.boundsMin, submesh.boundsMin);
+        meshData.boundsMax = glm::max(meshData.boundsMax, submesh.boundsMax);
+    }
+    return meshData;
+}
@@ -0,0 +1,40 @@
+#ifndef MESH_IMPORT_H
+#define MESH_IMPORT_H
+
+#include "vertex.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <glm/vec3.hpp>
+
+// range of the shared index buffer drawn with one material
+struct Submesh {
+    uint32_t indexOffset = 0;
+    uint32_t indexCount = 0;
+    uint32_t material = 0;
+    glm::vec3 boundsMin = glm::vec3();
+    glm::vec3 boundsMax = glm::vec3();
+};
+
+struct MaterialData {
+    // relative to the directory of the model, empty if the material has no texture
+    std::string diffuseTexture;
+};
+
+// all meshes of a scene merged into one vertex and index buffer, as it is stored on the CPU before it is uploaded
+struct MeshData {
+    std::vector<Vertex> vertices;
+    std::vector<unsigned int> indices;
+    // sorted by material
+    std::vector<Submesh> submeshes;
+    std::vector<MaterialData> materials;
+    glm::vec3 boundsMin = glm::vec3();
+    glm::vec3 boundsMax = glm::vec3();
+};
+
+// import a scene with Assimp, node transformations are applied to the vertices. Does not need an OpenGL context.
+MeshData importMesh(const std::string& path);
+
+#endif // !MESH_IMPORT_H
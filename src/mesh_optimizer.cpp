@@ -0,0 +1,305 @@
+#include "mesh_optimizer.h"
+
+#include "hash.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+
+#include <glm/geometric.hpp>
+#include <glm/vec3.hpp>
+
+// size of the LRU cache Forsyth's scoring is tuned for, larger than the simulated FIFO cache on purpose
+const int FORSYTH_CACHE_SIZE = 32;
+const float FORSYTH_LAST_TRIANGLE_SCORE = 0.75f;
+const float FORSYTH_CACHE_DECAY = 1.5f;
+const float FORSYTH_VALENCE_SCALE = 2.0f;
+const float FORSYTH_VALENCE_POWER = 0.5f;
+
+VertexCacheStatistics analyzeVertexCache(const unsigned int* indices, size_t indexCount, size_t vertexCount,
+                                         unsigned int cacheSize) {
+    VertexCacheStatistics statistics;
+    if (indexCount < 3) {
+        return statistics;
+    }
+
+    // a vertex is in the FIFO cache if fewer than cacheSize misses happened since it was inserted
+    const size_t NOT_CACHED = ~size_t(0);
+    std::vector<size_t> insertedAt(vertexCount, NOT_CACHED);
+    size_t misses = 0;
+    size_t referenced = 0;
+    for (size_t i = 0; i < indexCount; i++) {
+        unsigned int vertex = indices[i];
+        if (insertedAt[vertex] == NOT_CACHED) {
+            referenced++;
+        } else if (misses - insertedAt[vertex] < cacheSize) {
+            continue;
+        }
+        insertedAt[vertex] = misses++;
+    }
+
+    statistics.acmr = float(misses) / float(indexCount / 3);
+    statistics.atvr = float(misses) / float(referenced);
+    return statistics;
+}
+
+struct VertexHash {
+    size_t operator()(const Vertex& vertex) const {
+        return size_t(hashBytes(&vertex, sizeof(Vertex)));
+    }
+};
+
+struct VertexEqual {
+    bool operator()(const Vertex& a, const Vertex& b) const {
+        return std::memcmp(&a, &b, sizeof(Vertex)) == 0;
+    }
+};
+
+size_t deduplicateVertices(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices) {
+    std::unordered_map<Vertex, unsigned int, VertexHash, VertexEqual> unique(vertices.size());
+    std::vector<unsigned int> remap(vertices.size());
+    std::vector<Vertex> uniqueVertices;
+    uniqueVertices.reserve(vertices.size());
+    for (size_t i = 0; i < vertices.size(); i++) {
+        auto inserted = unique.emplace(vertices[i], unsigned(uniqueVertices.size()));
+        if (inserted.second) {
+            uniqueVertices.push_back(vertices[i]);
+        }
+        remap[i] = inserted.first->second;
+    }
+
+    for (auto& index : indices) {
+        index = remap[index];
+    }
+    size_t removed = vertices.size() - uniqueVertices.size();
+    vertices.swap(uniqueVertices);
+    return removed;
+}
+
+static float forsythScore(int cachePosition, unsigned int remainingTriangles) {
+    if (remainingTriangles == 0) {
+        return -1.0f; // no triangles left, never selected again
+    }
+    float score = 0.0f;
+    if (cachePosition >= 0 && cachePosition < 3) {
+        // used by the last triangle, a fixed score so strips are not preferred over fans
+        score = FORSYTH_LAST_TRIANGLE_SCORE;
+    } else if (cachePosition >= 3) {
+        float scale = 1.0f / (FORSYTH_CACHE_SIZE - 3);
+        score = std::pow(1.0f - (cachePosition - 3) * scale, FORSYTH_CACHE_DECAY);
+    }
+    // vertices with few triangles left are finished first, so they do not stay behind as isolated triangles
+    return score + FORSYTH_VALENCE_SCALE * std::pow(float(remainingTriangles), -FORSYTH_VALENCE_POWER);
+}
+
+void optimizeVertexCache(unsigned int* indices, size_t indexCount, size_t vertexCount) {
+    size_t triangleCount = indexCount / 3;
+    if (triangleCount == 0) {
+        return;
+    }
+
+    // triangles of each vertex, the first remaining[vertex] entries are the triangles not emitted yet
+    std::vector<unsigned int> remaining(vertexCount, 0);
+    for (size_t i = 0; i < triangleCount * 3; i++) {
+        remaining[indices[i]]++;
+    }
+    std::vector<size_t> firstTriangle(vertexCount + 1, 0);
+    for (size_t vertex = 0; vertex < vertexCount; vertex++) {
+        firstTriangle[vertex + 1] = firstTriangle[vertex] + remaining[vertex];
+    }
+    std::vector<unsigned int> vertexTriangles(triangleCount * 3);
+    std::vector<size_t> filled(firstTriangle.begin(), firstTriangle.end() - 1);
+    for (size_t i = 0; i < triangleCount * 3; i++) {
+        vertexTriangles[filled[indices[i]]++] = unsigned(i / 3);
+    }
+
+    std::vector<int> cachePosition(vertexCount, -1);
+    std::vector<float> vertexScore(vertexCount);
+    for (size_t vertex = 0; vertex < vertexCount; vertex++) {
+        vertexScore[vertex] = forsythScore(-1, remaining[vertex]);
+    }
+    std::vector<unsigned char> emitted(triangleCount, 0);
+
+    std::vector<unsigned int> output(triangleCount * 3);
+    std::vector<unsigned int> cache;
+    std::vector<unsigned int> nextCache;
+    cache.reserve(FORSYTH_CACHE_SIZE + 3);
+    nextCache.reserve(FORSYTH_CACHE_SIZE + 3);
+    long best = -1;
+    size_t scanPosition = 0;
+    for (size_t emittedCount = 0; emittedCount < triangleCount; emittedCount++) {
+        if (best < 0) {
+            // no remaining triangle shares a vertex with the cache, continue with the next one in input order.
+            // Scanning for the best score instead would make disconnected meshes quadratic.
+            while (emitted[scanPosition]) {
+                scanPosition++;
+            }
+            best = long(scanPosition);
+        }
+
+        const unsigned int* corners = &indices[best * 3];
+        std::copy(corners, corners + 3, &output[emittedCount * 3]);
+        emitted[best] = 1;
+
+        // remove the triangle from the remaining triangles of its vertices
+        for (int corner = 0; corner < 3; corner++) {
+            unsigned int vertex = corners[corner];
+            unsigned int* triangles = &vertexTriangles[firstTriangle[vertex]];
+            unsigned int* last = triangles + remaining[vertex] - 1;
+            *std::find(triangles, last + 1, unsigned(best)) = *last;
+            remaining[vertex]--;
+        }
+
+        // the vertices of the triangle move to the front of the LRU cache
+        nextCache.assign(corners, corners + 3);
+        nextCache.erase(std::unique(nextCache.begin(), nextCache.end()), nextCache.end());
+        if (nextCache.size() == 3 && nextCache[0] == nextCache[2]) {
+            nextCache.pop_back();
+        }
+        for (unsigned int vertex : cache) {
+            if (std::find(nextCache.begin(), nextCache.end(), vertex) == nextCache.end()) {
+                nextCache.push_back(vertex);
+            }
+        }
+        cache.swap(nextCache);
+
+        // rescore the vertices in and just evicted from the cache, the next triangle is the best one using them
+        for (size_t position = 0; position < cache.size(); position++) {
+            unsigned int vertex = cache[position];
+            cachePosition[vertex] = position < size_t(FORSYTH_CACHE_SIZE) ? int(position) : -1;
+            vertexScore[vertex] = forsythScore(cachePosition[vertex], remaining[vertex]);
+        }
+        best = -1;
+        float bestScore = -1e30f;
+        for (unsigned int vertex : cache) {
+            const unsigned int* triangles = &vertexTriangles[firstTriangle[vertex]];
+            for (unsigned int i = 0; i < remaining[vertex]; i++) {
+                unsigned int triangle = triangles[i];
+                const unsigned int* triangleCorners = &indices[triangle * 3];
+                float score = vertexScore[triangleCorners[0]] + vertexScore[triangleCorners[1]] +
+                              vertexScore[triangleCorners[2]];
+                if (score > bestScore) {
+                    bestScore = score;
+                    best = long(triangle);
+                }
+            }
+        }
+        if (cache.size() > size_t(FORSYTH_CACHE_SIZE)) {
+            cache.resize(FORSYTH_CACHE_SIZE);
+        }
+    }
+
+    std::copy(output.begin(), output.end(), indices);
+}
+
+void optimizeOverdraw(unsigned int* indices, size_t indexCount, const Vertex* vertices, size_t vertexCount,
+                      float threshold) {
+    size_t triangleCount = indexCount / 3;
+    if (triangleCount < 2) {
+        return;
+    }
+
+    // clusters start where the simulated cache misses all three vertices, reordering whole clusters keeps the
+    // locality inside of them
+    const size_t NOT_CACHED = ~size_t(0);
+    std::vector<size_t> insertedAt(vertexCount, NOT_CACHED);
+    std::vector<size_t> clusterStarts;
+    size_t misses = 0;
+    for (size_t triangle = 0; triangle < triangleCount; triangle++) {
+        int triangleMisses = 0;
+        for (int corner = 0; corner < 3; corner++) {
+            unsigned int vertex = indices[triangle * 3 + corner];
+            if (insertedAt[vertex] == NOT_CACHED || misses - insertedAt[vertex] >= VERTEX_CACHE_SIZE) {
+                insertedAt[vertex] = misses++;
+                triangleMisses++;
+            }
+        }
+        if (triangle == 0 || triangleMisses == 3) {
+            clusterStarts.push_back(triangle);
+        }
+    }
+    if (clusterStarts.size() < 2) {
+        return;
+    }
+    clusterStarts.push_back(triangleCount);
+
+    // area weighted centroid and normal of each cluster and of the whole range
+    size_t clusterCount = clusterStarts.size() - 1;
+    std::vector<glm::vec3> clusterCentroids(clusterCount, glm::vec3(0.0f));
+    std::vector<glm::vec3> clusterNormals(clusterCount, glm::vec3(0.0f));
+    glm::vec3 meshCentroid(0.0f);
+    float meshArea = 0.0f;
+    for (size_t cluster = 0; cluster < clusterCount; cluster++) {
+        float clusterArea = 0.0f;
+        for (size_t triangle = clusterStarts[cluster]; triangle < clusterStarts[cluster + 1]; triangle++) {
+            glm::vec3 a = vertices[indices[triangle * 3]].position;
+            glm::vec3 b = vertices[indices[triangle * 3 + 1]].position;
+            glm::vec3 c = vertices[indices[triangle * 3 + 2]].position;
+            glm::vec3 normal = glm::cross(b - a, c - a);
+            float area = glm::length(normal);
+            clusterCentroids[cluster] += (a + b + c) * (area / 3.0f);
+            clusterNormals[cluster] += normal;
+            clusterArea += area;
+        }
+        meshCentroid += clusterCentroids[cluster];
+        meshArea += clusterArea;
+        if (clusterArea > 0.0f) {
+            clusterCentroids[cluster] /= clusterArea;
+        }
+    }
+    if (meshArea > 0.0f) {
+        meshCentroid /= meshArea;
+    }
+
+    // clusters facing away from the center are likely to occlude the others, they are drawn first
+    std::vector<float> occlusion(clusterCount);
+    for (size_t cluster = 0; cluster < clusterCount; cluster++) {
+        float length = glm::length(clusterNormals[cluster]);
+        occlusion[cluster] =
+            length > 0.0f ? glm::dot(clusterCentroids[cluster] - meshCentroid, clusterNormals[cluster] / length) : 0.0f;
+    }
+    std::vector<size_t> order(clusterCount);
+    for (size_t cluster = 0; cluster < clusterCount; cluster++) {
+        order[cluster] = cluster;
+    }
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return occlusion[a] > occlusion[b]; });
+
+    std::vector<unsigned int> reordered;
+    reordered.reserve(triangleCount * 3);
+    for (size_t cluster : order) {
+        reordered.insert(reordered.end(), indices + clusterStarts[cluster] * 3,
+                         indices + clusterStarts[cluster + 1] * 3);
+    }
+
+    float acmr = analyzeVertexCache(indices, triangleCount * 3, vertexCount).acmr;
+    float reorderedAcmr = analyzeVertexCache(reordered.data(), reordered.size(), vertexCount).acmr;
+    if (reorderedAcmr <= acmr * threshold) {
+        std::copy(reordered.begin(), reordered.end(), indices);
+    }
+}
+
+void optimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices) {
+    const unsigned int UNUSED = ~0u;
+    std::vector<unsigned int> remap(vertices.size(), UNUSED);
+    std::vector<Vertex> ordered;
+    ordered.reserve(vertices.size());
+    for (auto& index : indices) {
+        if (remap[index] == UNUSED) {
+            remap[index] = unsigned(ordered.size());
+            ordered.push_back(vertices[index]);
+        }
+        index = remap[index];
+    }
+    vertices.swap(ordered);
+}
+
+void optimizeMesh(MeshData& mesh) {
+    deduplicateVertices(mesh.vertices, mesh.indices);
+    for (const auto& submesh : mesh.submeshes) {
+        unsigned int* indices = mesh.indices.data() + submesh.indexOffset;
+        optimizeVertexCache(indices, submesh.indexCount, mesh.vertices.size());
+        optimizeOverdraw(indices, submesh.indexCount, mesh.vertices.data(), mesh.vertices.size());
+    }
+    optimizeVertexFetch(mesh.vertices, mesh.indices);
+}
@@ -0,0 +1,44 @@
+#ifndef MESH_OPTIMIZER_H
+#define MESH_OPTIMIZER_H
+
+#include "mesh_import.h"
+#include "vertex.h"
+
+#include <cstddef>
+#include <vector>
+
+// entries of the post transform cache simulated by analyzeVertexCache, a conservative size for current GPUs
+const unsigned int VERTEX_CACHE_SIZE = 16;
+
+struct VertexCacheStatistics {
+    // average cache miss ratio, vertex shader invocations per triangle. 0.5 is the optimum for large regular grids,
+    // 3 means no vertex is reused at all.
+    float acmr = 0.0f;
+    // average transformed vertex ratio, vertex shader invocations per referenced vertex. 1 is the optimum.
+    float atvr = 0.0f;
+};
+
+// simulates a FIFO post transform cache of cacheSize vertices
+VertexCacheStatistics analyzeVertexCache(const unsigned int* indices, size_t indexCount, size_t vertexCount,
+                                         unsigned int cacheSize = VERTEX_CACHE_SIZE);
+
+// merges bitwise identical vertices, returns the number of vertices removed
+size_t deduplicateVertices(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices);
+
+// reorders the triangles for the post transform cache (Forsyth, "Linear-Speed Vertex Cache Optimisation").
+// Works on any index range, the vertices are not touched.
+void optimizeVertexCache(unsigned int* indices, size_t indexCount, size_t vertexCount);
+
+// reorders clusters of triangles of a cache optimized index range so triangles on the outside of the mesh are drawn
+// first (Sander et al., "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw"). The new order is only
+// kept if its ACMR is at most threshold times the ACMR of the cache optimized order.
+void optimizeOverdraw(unsigned int* indices, size_t indexCount, const Vertex* vertices, size_t vertexCount,
+                      float threshold = 1.05f);
+
+// sorts the vertices by their first use in the index buffer and drops unreferenced vertices
+void optimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices);
+
+// all of the above, each submesh is optimized on its own so the submeshes stay contiguous index ranges
+void optimizeMesh(MeshData& mesh);
+
+#endif // !MESH_OPTIMIZER_H
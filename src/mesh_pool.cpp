@@ -0,0 +1,86 @@
+#include "mesh_pool.h"
+
+#include "render_state.h"
+
+#include <algorithm>
+#include <utility>
+
+// initial capacity of the shared buffers, room for several meshes of the size of the space ship
+const size_t INITIAL_VERTEX_CAPACITY = 64 * 1024;
+const size_t INITIAL_INDEX_CAPACITY = 3 * INITIAL_VERTEX_CAPACITY;
+
+MeshPool::MeshPool(std::vector<VertexAttribute> attributes, size_t vertexSize)
+    : attributes(std::move(attributes)), stride(vertexSize) {
+    glGenVertexArrays(1, &this->vao);
+    this->vertexCapacity = INITIAL_VERTEX_CAPACITY;
+    this->indexCapacity = INITIAL_INDEX_CAPACITY;
+    grow(this->vbo, 0, this->vertexCapacity * this->stride);
+    grow(this->ebo, 0, this->indexCapacity * sizeof(unsigned int));
+    this->setVertexAttributes();
+}
+
+MeshPool::~MeshPool() {
+    renderState.deleteVertexArray(this->vao);
+    glDeleteBuffers(1, &this->vbo);
+    glDeleteBuffers(1, &this->ebo);
+}
+
+MeshRange MeshPool::add(const void* vertices, size_t vertexCount, const unsigned int* indices, size_t indexCount) {
+    bool grown = false;
+    if (this->vertexCount + vertexCount > this->vertexCapacity) {
+        size_t capacity = std::max(this->vertexCapacity * 2, this->vertexCount + vertexCount);
+        grow(this->vbo, this->vertexCount * this->stride, capacity * this->stride);
+        this->vertexCapacity = capacity;
+        grown = true;
+    }
+    if (this->indexCount + indexCount > this->indexCapacity) {
+        size_t capacity = std::max(this->indexCapacity * 2, this->indexCount + indexCount);
+        grow(this->ebo, this->indexCount * sizeof(unsigned int), capacity * sizeof(unsigned int));
+        this->indexCapacity = capacity;
+        grown = true;
+    }
+    if (grown) {
+        this->setVertexAttributes();
+    }
+
+    MeshRange range;
+    range.baseVertex = GLint(this->vertexCount);
+    range.firstIndex = this->indexCount;
+    range.vertexCount = vertexCount;
+    range.indexCount = indexCount;
+    // GL_COPY_WRITE_BUFFER leaves the vertex array and the other bindings untouched
+    glBindBuffer(GL_COPY_WRITE_BUFFER, this->vbo);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, this->vertexCount * this->stride, vertexCount * this->stride, vertices);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, this->ebo);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, this->indexCount * sizeof(unsigned int), indexCount * sizeof(unsigned int),
+                    indices);
+    this->vertexCount += vertexCount;
+    this->indexCount += indexCount;
+    this->meshes++;
+    return range;
+}
+
+void MeshPool::grow(GLuint& buffer, size_t used, size_t capacity) {
+    GLuint grown = 0;
+    glGenBuffers(1, &grown);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, grown);
+    glBufferData(GL_COPY_WRITE_BUFFER, capacity, nullptr, GL_STATIC_DRAW);
+    if (buffer != 0) {
+        // the copy stays on the GPU, draws issued before still read the old buffer until it is released
+        glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, used);
+        glDeleteBuffers(1, &buffer);
+    }
+    buffer = grown;
+}
+
+void MeshPool::setVertexAttributes() {
+    renderState.bindVertexArray(this->vao);
+    glBindBuffer(GL_ARRAY_BUFFER, this->vbo);
+    for (const auto& attribute : this->attributes) {
+        glEnableVertexAttribArray(attribute.location);
+        glVertexAttribPointer(attribute.location, attribute.size, attribute.type, attribute.normalized,
+                              GLsizei(this->stride), (void*)attribute.offset);
+    }
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->ebo);
+}
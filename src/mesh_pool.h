@@ -0,0 +1,76 @@
+#ifndef MESH_POOL_H
+#define MESH_POOL_H
+
+#include <cstddef>
+#include <vector>
+
+#include <GL/glew.h>
+
+// one interleaved vertex attribute of the vertices in a mesh pool
+struct VertexAttribute {
+    GLuint location;
+    GLint size;
+    GLenum type;
+    GLboolean normalized;
+    size_t offset;
+};
+
+// where a mesh lives in its pool. Its indices are relative to its first vertex, so they are drawn with baseVertex.
+struct MeshRange {
+    GLint baseVertex = 0;
+    // in 32 bit indices
+    size_t firstIndex = 0;
+    size_t vertexCount = 0;
+    size_t indexCount = 0;
+};
+
+// static meshes of one vertex layout suballocated from one shared vertex and one shared 32 bit index buffer, drawn
+// through a single vertex array. Draws of different meshes only differ in their index offset and base vertex, so the
+// render queue can merge them into one multi draw. The buffers double when a mesh does not fit, the old contents are
+// copied on the GPU and the ranges handed out stay valid. Meshes live as long as the pool. Render thread only.
+class MeshPool {
+public:
+    MeshPool(std::vector<VertexAttribute> attributes, size_t vertexSize);
+    ~MeshPool();
+    MeshPool(const MeshPool&) = delete;
+    MeshPool& operator=(const MeshPool&) = delete;
+
+    // copies vertexCount vertices of the pool's layout and indexCount indices behind the meshes added so far
+    MeshRange add(const void* vertices, size_t vertexCount, const unsigned int* indices, size_t indexCount);
+
+    GLuint vertexArray() const {
+        return this->vao;
+    }
+    size_t vertexSize() const {
+        return this->stride;
+    }
+    size_t meshCount() const {
+        return this->meshes;
+    }
+    // used and allocated bytes of both buffers
+    size_t usedBytes() const {
+        return this->vertexCount * this->stride + this->indexCount * sizeof(unsigned int);
+    }
+    size_t capacityBytes() const {
+        return this->vertexCapacity * this->stride + this->indexCapacity * sizeof(unsigned int);
+    }
+
+private:
+    // replaces buffer by one of capacity bytes holding its first used bytes
+    static void grow(GLuint& buffer, size_t used, size_t capacity);
+    void setVertexAttributes();
+
+    std::vector<VertexAttribute> attributes;
+    size_t stride;
+    GLuint vao = 0;
+    GLuint vbo = 0;
+    GLuint ebo = 0;
+    // in vertices and indices
+    size_t vertexCount = 0;
+    size_t vertexCapacity = 0;
+    size_t indexCount = 0;
+    size_t indexCapacity = 0;
+    size_t meshes = 0;
+};
+
+#endif // !MESH_POOL_H
@@ -1,80 +1,227 @@
 #include "model.h"
 
-#include <assimp/Importer.hpp>
-#include <assimp/postprocess.h>
-#include <assimp/scene.h>
-
+#include "mesh_optimizer.h"
+#include "render_state.h"
+#include "render_stats.h"
+#include "source_stamp.h"
+#include "texture_cache.h"
+
+#include <algorithm>
+#include <cstddef>
 #include <stdexcept>
+#include <utility>
 
 #include <fmt/format.h>
 using namespace fmt;
 
-Model Model::loadFromFile(const std::string& path) {
-    Model model;
-    Assimp::Importer importer;
-    const aiScene* scene = importer.ReadFile(path.c_str(), aiProcess_Triangulate | aiProcess_FlipUVs);
-    if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) {
-        throw std::runtime_error(format("Failed to load model from {}: {}", path, importer.GetErrorString()));
+const Vertex* ModelData::vertices() const {
+    return this->cache ? this->cache->vertices() : this->mesh.vertices.data();
+}
+
+size_t ModelData::vertexCount() const {
+    return this->cache ? this->cache->vertexCount() : this->mesh.vertices.size();
+}
+
+const unsigned int* ModelData::indices() const {
+    return this->cache ? this->cache->indices() : this->mesh.indices.data();
+}
+
+size_t ModelData::indexCount() const {
+    return this->cache ? this->cache->indexCount() : this->mesh.indices.size();
+}
+
+std::unique_ptr<MeshPool> Model::createMeshPool(VertexFormat format) {
+    if (format == VertexFormat::Float) {
+        return std::unique_ptr<MeshPool>(
+            new MeshPool({{POSITION_LOCATION, 3, GL_FLOAT, GL_FALSE, offsetof(Vertex, position)},
+                          {TEXTURE_POSITION_LOCATION, 2, GL_FLOAT, GL_FALSE, offsetof(Vertex, texturePosition)},
+                          {NORMAL_LOCATION, 3, GL_FLOAT, GL_FALSE, offsetof(Vertex, normal)}},
+                         sizeof(Vertex)));
     }
 
-    // load vertex positions
-    auto mesh = scene->mMeshes[0];
-    for (unsigned int i = 0; i < mesh->mNumVertices; i++) {
-        Vertex vertex;
-        vertex.position.x = mesh->mVertices[i].x;
-        vertex.position.y = mesh->mVertices[i].y;
-        vertex.position.z = mesh->mVertices[i].z;
+    // the shaders dequantize positions and texture coordinates and decode the octahedral normals
+    GLenum positionType = format == VertexFormat::Half ? GL_HALF_FLOAT : GL_SHORT;
+    GLboolean positionNormalized = format == VertexFormat::Half ? GL_FALSE : GL_TRUE;
+    return std::unique_ptr<MeshPool>(new MeshPool(
+        {{POSITION_LOCATION, 3, positionType, positionNormalized, offsetof(PackedVertex, position)},
+         {TEXTURE_POSITION_LOCATION, 2, GL_UNSIGNED_SHORT, GL_TRUE, offsetof(PackedVertex, texturePosition)},
+         {NORMAL_LOCATION, 2, GL_SHORT, GL_TRUE, offsetof(PackedVertex, normal)}},
+        sizeof(PackedVertex)));
+}
 
-        vertex.texturePosition.x = mesh->mTextureCoords[0][i].x;
-        vertex.texturePosition.y = mesh->mTextureCoords[0][i].y;
+Model Model::loadFromFile(const std::string& path, TextureManager& textures, MeshPool& meshes, VertexFormat format) {
+    return fromData(readFromFile(path, format), textures, meshes);
+}
 
-        vertex.normal.x = mesh->mNormals[i].x;
-        vertex.normal.y = mesh->mNormals[i].y;
-        vertex.normal.z = mesh->mNormals[i].z;
+ModelData Model::readFromFile(const std::string& path, VertexFormat format) {
+    ModelData data;
+    data.path = path;
+    data.format = format;
+
+    std::string cachePath = MeshCache::pathFor(path);
+    data.cache = MeshCache::open(cachePath, path);
+    if (data.cache) {
+        // the vertices and indices stay in the mapped file, float vertices are handed to the driver without a copy
+        data.mesh.submeshes.assign(data.cache->submeshes(), data.cache->submeshes() + data.cache->submeshCount());
+        data.mesh.materials = data.cache->materials();
+        data.mesh.boundsMin = data.cache->boundsMin();
+        data.mesh.boundsMax = data.cache->boundsMax();
+    } else {
+        data.mesh = importMesh(path);
+        optimizeMesh(data.mesh);
+        try {
+            MeshCache::write(cachePath, path, data.mesh);
+        } catch (const std::runtime_error& error) {
+            // not being able to cook the mesh only costs startup time on the next run
+            print(stderr, "Warning: {}\n", error.what());
+        }
+    }
 
-        model.vertices.push_back(vertex);
+    if (format != VertexFormat::Float) {
+        data.quantization = VertexQuantization::fromVertices(data.vertices(), data.vertexCount());
+        data.packedVertices.resize(data.vertexCount());
+        packVertices(data.vertices(), data.vertexCount(), format, data.quantization, data.packedVertices.data());
     }
 
-    // load vertex incides
-    for (unsigned int i = 0; i < mesh->mNumFaces; i++) {
-        aiFace face = mesh->mFaces[i];
-        for (unsigned int j = 0; j < face.mNumIndices; j++) {
-            model.indices.push_back(face.mIndices[j]);
+    // the textures themselves are read by the texture manager
+    std::string directory = path.substr(0, path.find_last_of("/\\") + 1);
+    for (const auto& material : data.mesh.materials) {
+        data.materialTextures.emplace_back();
+        if (!material.diffuseTexture.empty()) {
+            std::string texturePath = directory + material.diffuseTexture;
+            // a build can ship the cooked texture without its source image
+            SourceStamp stamp;
+            if (stampSource(texturePath, stamp) || stampSource(TextureCache::pathFor(texturePath), stamp)) {
+                data.materialTextures.back() = texturePath;
+            } else {
+                print(stderr, "Warning: Texture {} of {} not found, using the default texture\n", texturePath, path);
+            }
         }
     }
+    return data;
+}
+
+Model Model::fromData(const ModelData& data, TextureManager& textures, MeshPool& meshes) {
+    if (meshes.vertexSize() != vertexSize(data.format)) {
+        // the format member hides fmt::format
+        throw std::runtime_error(fmt::format("The mesh pool does not hold {} vertices of {}",
+                                             vertexFormatName(data.format), data.path));
+    }
+    Model model;
+    model.format = data.format;
+    model.quantization = data.quantization;
+    model.upload(data, meshes);
+    model.loadMaterials(data.materialTextures, textures);
+
+    model.submeshes = data.mesh.submeshes;
+    model.box = BoundingBox(data.mesh.boundsMin, data.mesh.boundsMax);
+    model.sphere = BoundingSphere::fromBox(model.box);
+    for (const auto& submesh : model.submeshes) {
+        model.submeshBounds.add(BoundingBox(submesh.boundsMin, submesh.boundsMax));
+    }
+    model.submeshVisibility.resize(model.submeshes.size());
+    return model;
+}
 
-    glGenVertexArrays(1, &model.vao); // one attribute
-    glBindVertexArray(model.vao);
+void Model::loadMaterials(const std::vector<std::string>& paths, TextureManager& textures) {
+    for (const auto& path : paths) {
+        this->materialTextures.push_back(path.empty() ? nullptr : textures.load(path));
+    }
+}
 
-    // load vertex positions
-    glGenBuffers(1, &model.vbo); // one buffer in this vertex buffer object
-    glBindBuffer(GL_ARRAY_BUFFER, model.vbo); // set current buffer
-    glBufferData(GL_ARRAY_BUFFER, sizeof(Vertex) * model.vertices.size(), &model.vertices[0],
-                 GL_STATIC_DRAW); // copy data to GPU memory
+void Model::upload(const ModelData& data, MeshPool& meshes) {
+    // compact formats are packed by readFromFile
+    const void* vertices = data.vertices();
+    if (this->format != VertexFormat::Float) {
+        vertices = data.packedVertices.data();
+    }
+    this->mesh = meshes.add(vertices, data.vertexCount(), data.indices(), data.indexCount());
+    this->vertexArray = meshes.vertexArray();
+    this->vertexBufferSize = vertexSize(this->format) * data.vertexCount();
+}
 
-    glEnableVertexAttribArray(0); // activate first attribute
-    glBindBuffer(GL_ARRAY_BUFFER, model.vbo);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), nullptr);
+void Model::setDefaultTexture(TextureHandle texture) {
+    this->defaultTexture = std::move(texture);
+}
 
-    // load vertex incides
-    glGenBuffers(1, &model.ebo);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, model.ebo);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(unsigned int) * model.indices.size(), &model.indices[0],
-                 GL_STATIC_DRAW);
+void Model::requestTextures(TextureManager& textures, float pixels) const {
+    for (const auto& texture : this->materialTextures) {
+        if (texture) {
+            textures.request(texture, pixels);
+        }
+    }
+    if (this->defaultTexture) {
+        textures.request(this->defaultTexture, pixels);
+    }
+}
 
-    // load texture coordinates
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, texturePosition));
+ObjectUniforms Model::objectUniforms(const glm::mat4& model) const {
+    ObjectUniforms uniforms;
+    uniforms.model = model;
+    // float vertices keep the identity transform of a default quantization
+    uniforms.parameters[0] = this->quantization.positionScaleParameter();
+    uniforms.parameters[1] = this->quantization.positionOffsetParameter();
+    uniforms.parameters[1].w = this->format == VertexFormat::Float ? 0.0f : 1.0f; // octahedral normals
+    uniforms.parameters[2] = this->quantization.texturePositionParameter();
+    return uniforms;
+}
 
-    return model;
+void Model::submit(RenderQueue& queue, ShaderProgram& program, size_t objectBlock, const Frustum& frustum,
+                   GLuint instance, glm::vec3 position) {
+    frustum.intersects(this->submeshBounds, this->submeshVisibility.data());
+    DrawPacket packet;
+    packet.program = &program;
+    packet.instanceCount = 1;
+    packet.firstInstance = instance;
+    packet.objectBlock = objectBlock;
+    this->submitVisibleSubmeshes(queue, packet, position);
 }
 
-void Model::addTexture(Texture texture) {
-    this->textures.push_back(texture);
+void Model::submitInstanced(RenderQueue& queue, ShaderProgram& program, size_t objectBlock, GLuint firstInstance,
+                            size_t count, glm::vec3 position) {
+    if (count == 0) {
+        return;
+    }
+
+    // the instances are culled by the caller, the submeshes of every instance are drawn
+    std::fill(this->submeshVisibility.begin(), this->submeshVisibility.end(), 1);
+    DrawPacket packet;
+    packet.program = &program;
+    packet.instanceCount = GLsizei(count);
+    packet.firstInstance = firstInstance;
+    packet.objectBlock = objectBlock;
+    this->submitVisibleSubmeshes(queue, packet, position);
+    renderStats.drawnInstances += unsigned(count);
 }
 
-void Model::draw(bool wireframe) {
-    this->textures[0].bind();
-    glBindVertexArray(this->vao);
-    glDrawElements(wireframe ? GL_LINES : GL_TRIANGLES, this->indices.size(), GL_UNSIGNED_INT, nullptr);
+void Model::submitVisibleSubmeshes(RenderQueue& queue, DrawPacket packet, glm::vec3 position) {
+    packet.vertexArray = this->vertexArray;
+    packet.baseVertex = this->mesh.baseVertex;
+    for (size_t i = 0; i < this->submeshes.size();) {
+        if (!this->submeshVisibility[i]) {
+            renderStats.culledSubmeshes++;
+            i++;
+            continue;
+        }
+
+        // merge the following visible submeshes of the same material into one draw call
+        const Submesh& first = this->submeshes[i];
+        uint32_t indexCount = first.indexCount;
+        for (i++; i < this->submeshes.size() && this->submeshVisibility[i] &&
+                  this->submeshes[i].material == first.material &&
+                  this->submeshes[i].indexOffset == first.indexOffset + indexCount;
+             i++) {
+            indexCount += this->submeshes[i].indexCount;
+        }
+
+        const ManagedTexture* texture =
+            first.material < this->materialTextures.size() ? this->materialTextures[first.material].get() : nullptr;
+        if (!texture) {
+            texture = this->defaultTexture.get();
+        }
+        packet.texture = texture ? texture->id() : 0;
+        packet.indexOffset = this->mesh.firstIndex + first.indexOffset;
+        packet.indexCount = GLsizei(indexCount);
+        queue.submit(packet, position);
+    }
 }
@@ -1,29 +1,122 @@
 #ifndef MODEL_H
 #define MODEL_H
 
-#include "texture.h"
+#include "bounds.h"
+#include "frustum.h"
+#include "mesh_cache.h"
+#include "mesh_import.h"
+#include "mesh_pool.h"
+#include "render_queue.h"
+#include "shader_program.h"
+#include "texture_manager.h"
+#include "uniform_buffer.h"
 #include "vertex.h"
+#include "vertex_format.h"
 
+#include <memory>
 #include <string>
 #include <vector>
 
 #include <GL/glew.h>
 
+#include <glm/mat4x4.hpp>
+
+// everything Model reads, decodes and packs before the GL upload. Does not need an OpenGL context, so it can be
+// prepared on a worker thread.
+struct ModelData {
+    std::string path;
+    VertexFormat format = VertexFormat::Float;
+    // the mapped cooked mesh, or nullptr if the mesh was imported
+    std::unique_ptr<MeshCache> cache;
+    // the imported mesh, or the submeshes, materials and bounds of the cache
+    MeshData mesh;
+    // vertices in format if it is a compact format
+    std::vector<PackedVertex> packedVertices;
+    VertexQuantization quantization;
+    // path of the diffuse texture of each material, empty if there is none
+    std::vector<std::string> materialTextures;
+
+    const Vertex* vertices() const;
+    size_t vertexCount() const;
+    const unsigned int* indices() const;
+    size_t indexCount() const;
+};
+
 class Model {
 public:
-    static Model loadFromFile(const std::string& path);
-    void addTexture(Texture texture);
-    void draw(bool wireframe);
+    // attribute locations of the vertex_position, texture_coordinate and vertex_normal inputs
+    static const GLuint POSITION_LOCATION = 0;
+    static const GLuint TEXTURE_POSITION_LOCATION = 1;
+    static const GLuint NORMAL_LOCATION = 2;
+
+    // pool for the meshes of all models with vertices in format
+    static std::unique_ptr<MeshPool> createMeshPool(VertexFormat format);
+    // loads the cooked mesh next to path if it is up to date, otherwise imports path and cooks it.
+    // The diffuse textures of the materials are loaded relative to the model by textures. The vertices are stored in
+    // meshes in its format, compact formats have to be dequantized by the program with the parameters set by
+    // objectUniforms.
+    static Model loadFromFile(const std::string& path, TextureManager& textures, MeshPool& meshes,
+                              VertexFormat format = VertexFormat::Snorm16);
+    // the CPU side of loadFromFile, safe to call from any thread
+    static ModelData readFromFile(const std::string& path, VertexFormat format = VertexFormat::Snorm16);
+    // the GL side of loadFromFile, render thread only. Throws if meshes is not a pool for the format of data.
+    static Model fromData(const ModelData& data, TextureManager& textures, MeshPool& meshes);
+    // used by all materials without a texture of their own, replaces the previous default texture
+    void setDefaultTexture(TextureHandle texture);
+    // the model is drawn this frame covering about pixels on screen, streams in the mip levels its textures need
+    void requestTextures(TextureManager& textures, float pixels) const;
+    // model matrix and the dequantization of the vertices, in the layout read by the model shaders
+    ObjectUniforms objectUniforms(const glm::mat4& model) const;
+    // the program has to read the model matrix from the instance_model attribute and the dequantization from
+    // objectBlock, which is shared by all instances. instance is the model matrix pushed to the queue
+    // (RenderQueue::pushInstances). frustum is in model space, submeshes outside of it are skipped. position is the
+    // model's center in world space.
+    void submit(RenderQueue& queue, ShaderProgram& program, size_t objectBlock, const Frustum& frustum,
+                GLuint instance, glm::vec3 position);
+    // count instances from firstInstance on with a single packet per material, the instances are culled by the caller
+    void submitInstanced(RenderQueue& queue, ShaderProgram& program, size_t objectBlock, GLuint firstInstance,
+                         size_t count, glm::vec3 position);
+
+    const BoundingBox& boundingBox() const {
+        return this->box;
+    }
+    const BoundingSphere& boundingSphere() const {
+        return this->sphere;
+    }
+    VertexFormat vertexFormat() const {
+        return this->format;
+    }
+    // size of the vertices in the mesh pool
+    size_t vertexBytes() const {
+        return this->vertexBufferSize;
+    }
 
 private:
     Model() = default;
-    std::vector<Vertex> vertices;
-    std::vector<unsigned int> indices;
-    std::vector<Texture> textures;
+    void upload(const ModelData& data, MeshPool& meshes);
+    void loadMaterials(const std::vector<std::string>& paths, TextureManager& textures);
+    // one packet per run of submeshes marked in submeshVisibility, packet holds the fields shared by all of them
+    void submitVisibleSubmeshes(RenderQueue& queue, DrawPacket packet, glm::vec3 position);
+
+    // diffuse texture of each material, null if the material uses the default texture
+    std::vector<TextureHandle> materialTextures;
+    TextureHandle defaultTexture;
+
+    // sorted by material, so consecutive visible submeshes can be drawn with one call
+    std::vector<Submesh> submeshes;
+    BoundingBoxList submeshBounds;
+    std::vector<unsigned char> submeshVisibility;
+
+    BoundingBox box;
+    BoundingSphere sphere;
+
+    VertexFormat format = VertexFormat::Float;
+    VertexQuantization quantization;
+    size_t vertexBufferSize = 0;
 
-    GLuint vao;
-    GLuint vbo;
-    GLuint ebo;
+    // the vertex array of the mesh pool
+    GLuint vertexArray = 0;
+    MeshRange mesh;
 };
 
 #endif // !MODEL_H
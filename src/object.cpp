@@ -1,40 +1,43 @@
 #include "object.h"
 
-Object::Object(std::vector<glm::vec3> vertices, std::vector<glm::uvec3> indices) {
-    glGenVertexArrays(1, &this->vertexAttributeObject); // one attribute
-    glBindVertexArray(this->vertexAttributeObject);
-
-    GLuint vertexPositions = 0;
-    glGenBuffers(1, &vertexPositions); // one buffer in this vertex buffer object
-    glBindBuffer(GL_ARRAY_BUFFER, vertexPositions); // set current buffer
-    glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec3) * vertices.size(), &vertices[0],
-                 GL_STATIC_DRAW); // copy data to GPU memory
-
-    glEnableVertexAttribArray(0); // activate first attribute
-    glBindBuffer(GL_ARRAY_BUFFER, vertexPositions);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, nullptr);
-
-    GLuint ebo = 0;
-    glGenBuffers(1, &ebo);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(glm::uvec3) * indices.size(), &indices[0], GL_STATIC_DRAW);
-
-    this->incidesCount = indices.size() * 3;
+#include <cstddef>
+
+struct ObjectVertex {
+    glm::vec3 position;
+    glm::vec3 color;
+};
+
+std::unique_ptr<MeshPool> Object::createMeshPool() {
+    return std::unique_ptr<MeshPool>(
+        new MeshPool({{POSITION_LOCATION, 3, GL_FLOAT, GL_FALSE, offsetof(ObjectVertex, position)},
+                      {COLOR_LOCATION, 3, GL_FLOAT, GL_FALSE, offsetof(ObjectVertex, color)}},
+                     sizeof(ObjectVertex)));
 }
 
-Object::Object(std::vector<glm::vec3> vertices, std::vector<glm::uvec3> indices, std::vector<glm::vec3> colors)
-    : Object(vertices, indices) {
-    GLuint vertexColors = 0;
-    glGenBuffers(1, &vertexColors); // one buffer in this vertex buffer object
-    glBindBuffer(GL_ARRAY_BUFFER, vertexColors); // set current buffer
-    glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec3) * colors.size(), &colors[0],
-                 GL_STATIC_DRAW); // copy data to GPU memory
-
-    glEnableVertexAttribArray(1); // activate first attribute
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, nullptr);
+Object::Object(MeshPool& meshes, const std::vector<glm::vec3>& vertices, const std::vector<glm::uvec3>& indices,
+               const std::vector<glm::vec3>& colors) {
+    std::vector<ObjectVertex> objectVertices(vertices.size());
+    for (size_t i = 0; i < vertices.size(); i++) {
+        objectVertices[i].position = vertices[i];
+        objectVertices[i].color = i < colors.size() ? colors[i] : glm::vec3(0.0f);
+    }
+    static_assert(sizeof(glm::uvec3) == sizeof(unsigned int) * 3, "a triangle has to be three packed indices");
+    this->mesh = meshes.add(objectVertices.data(), objectVertices.size(),
+                            reinterpret_cast<const unsigned int*>(indices.data()), indices.size() * 3);
+    this->vertexArray = meshes.vertexArray();
+
+    this->box = BoundingBox::fromPoints(vertices.data(), vertices.size());
+    this->sphere = BoundingSphere::fromBox(this->box);
 }
 
-void Object::draw(bool wireframe) {
-    glBindVertexArray(this->vertexAttributeObject);
-    glDrawElements(wireframe ? GL_LINES : GL_TRIANGLES, this->incidesCount, GL_UNSIGNED_INT, nullptr);
+void Object::submit(RenderQueue& queue, ShaderProgram& program, GLuint instance, glm::vec3 position) {
+    DrawPacket packet;
+    packet.program = &program;
+    packet.vertexArray = this->vertexArray;
+    packet.indexOffset = this->mesh.firstIndex;
+    packet.indexCount = GLsizei(this->mesh.indexCount);
+    packet.baseVertex = this->mesh.baseVertex;
+    packet.instanceCount = 1;
+    packet.firstInstance = instance;
+    queue.submit(packet, position);
 }
@@ -1,21 +1,45 @@
 #ifndef OBJECT_H
 #define OBJECT_H
 
+#include "bounds.h"
+#include "mesh_pool.h"
+#include "render_queue.h"
+#include "shader_program.h"
+
 #include <GL/glew.h>
 
+#include <memory>
 #include <vector>
 
 #include <glm/vec3.hpp>
 
 class Object {
 public:
-    Object(std::vector<glm::vec3> vertics, std::vector<glm::uvec3> indices);
-    Object(std::vector<glm::vec3> vertics, std::vector<glm::uvec3> indices, std::vector<glm::vec3> colors);
-    void draw(bool wireframe);
+    // attribute locations of the vertex_position and vertex_color inputs
+    static const GLuint POSITION_LOCATION = 0;
+    static const GLuint COLOR_LOCATION = 1;
+
+    // pool for the meshes of all objects
+    static std::unique_ptr<MeshPool> createMeshPool();
+    // objects without colors are black
+    Object(MeshPool& meshes, const std::vector<glm::vec3>& vertices, const std::vector<glm::uvec3>& indices,
+           const std::vector<glm::vec3>& colors = std::vector<glm::vec3>());
+    // the program has to read the model matrix from the instance_model attribute, instance is the model matrix pushed
+    // to the queue (RenderQueue::pushInstances). position is the object's center in world space.
+    void submit(RenderQueue& queue, ShaderProgram& program, GLuint instance, glm::vec3 position);
+
+    const BoundingBox& boundingBox() const {
+        return this->box;
+    }
+    const BoundingSphere& boundingSphere() const {
+        return this->sphere;
+    }
 
 private:
-    GLuint vertexAttributeObject = 0;
-    unsigned int incidesCount = 0;
+    GLuint vertexArray = 0;
+    MeshRange mesh;
+    BoundingBox box;
+    BoundingSphere sphere;
 };
 
 #endif
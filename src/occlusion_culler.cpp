@@ -0,0 +1,327 @@
+#include "occlusion_culler.h"
+
+#include "profiler.h"
+#include "render_stats.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <utility>
+
+// rows rasterized by one task, every task walks all triangles overlapping its band
+const int BAND_ROWS = 8;
+// occluder triangles set up and boxes tested per range of the parallel loops
+const size_t TRIANGLES_PER_RANGE = 512;
+const size_t BOXES_PER_RANGE = 256;
+// the pyramid level a box is tested on is the finest one on which it touches fewer texels along each axis
+const int MAX_BOX_TEXELS = 4;
+
+static double microsecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+}
+
+// keeps the nearer depth for the texels of one row inside the triangle. Branch free so the compiler vectorizes it,
+// texels outside are pushed far behind the far plane instead of being skipped, the plane can be extrapolated to any
+// depth outside of the triangle.
+static void rasterizeSpan(float* depth, int count, const float* edge, const float* edgeStep, float plane,
+                          float planeStep) {
+    float edge0 = edge[0], edge1 = edge[1], edge2 = edge[2];
+    float step0 = edgeStep[0], step1 = edgeStep[1], step2 = edgeStep[2];
+    for (int i = 0; i < count; i++) {
+        float x = float(i);
+        int outside = int(edge0 + step0 * x < 0.0f) | int(edge1 + step1 * x < 0.0f) | int(edge2 + step2 * x < 0.0f);
+        float value = plane + planeStep * x + float(outside) * 1e30f;
+        depth[i] = value < depth[i] ? value : depth[i];
+    }
+}
+
+OcclusionCuller::OcclusionCuller(ThreadPool& threadPool, int width, int height)
+    : threadPool(threadPool), width(width), height(height) {
+    glm::ivec2 size(width, height);
+    this->levelSizes.push_back(size);
+    while (size.x > 1 || size.y > 1) {
+        size = glm::ivec2((size.x + 1) / 2, (size.y + 1) / 2);
+        this->levelSizes.push_back(size);
+    }
+    for (const auto& levelSize : this->levelSizes) {
+        this->levels.emplace_back(size_t(levelSize.x) * levelSize.y, 1.0f);
+    }
+}
+
+void OcclusionCuller::begin(const glm::mat4& viewProjection) {
+    this->viewProjection = viewProjection;
+    this->vertices.clear();
+    this->batches.clear();
+    this->rasterized = false;
+    this->elapsed = 0.0;
+}
+
+void OcclusionCuller::addOccluders(const glm::vec3* vertices, size_t count, const glm::mat4& model) {
+    if (count == 0) {
+        return;
+    }
+    glm::mat4 matrix = this->viewProjection * model;
+    if (this->batches.empty() || this->batches.back().matrix != matrix) {
+        this->batches.push_back(Batch{this->vertices.size(), matrix});
+    }
+    this->vertices.insert(this->vertices.end(), vertices, vertices + count);
+}
+
+void OcclusionCuller::rasterize() {
+    PROFILE_SCOPE("Occlusion rasterize");
+    auto start = std::chrono::steady_clock::now();
+
+    size_t triangleCount = this->vertices.size() / 3;
+    this->triangles.resize(triangleCount * 2);
+    for (size_t batch = 0; batch < this->batches.size(); batch++) {
+        size_t first = this->batches[batch].first / 3;
+        size_t end = batch + 1 < this->batches.size() ? this->batches[batch + 1].first / 3 : triangleCount;
+        const glm::mat4& matrix = this->batches[batch].matrix;
+        this->threadPool.parallelFor(end - first, [&](size_t begin, size_t rangeEnd) {
+            for (size_t i = first + begin; i < first + rangeEnd; i++) {
+                this->setup(i, matrix);
+            }
+        }, TRIANGLES_PER_RANGE);
+    }
+
+    std::fill(this->levels[0].begin(), this->levels[0].end(), 1.0f);
+    int bands = (this->height + BAND_ROWS - 1) / BAND_ROWS;
+    this->threadPool.parallelFor(size_t(bands), [this](size_t begin, size_t end) {
+        PROFILE_SCOPE("Occlusion band");
+        for (size_t band = begin; band < end; band++) {
+            int firstRow = int(band) * BAND_ROWS;
+            this->rasterizeBand(firstRow, std::min(firstRow + BAND_ROWS, this->height));
+        }
+    });
+    this->buildPyramid();
+    this->rasterized = true;
+    this->elapsed += microsecondsSince(start);
+}
+
+void OcclusionCuller::setup(size_t i, const glm::mat4& matrix) {
+    glm::vec4 clip[3];
+    for (int k = 0; k < 3; k++) {
+        clip[k] = matrix * glm::vec4(this->vertices[i * 3 + k], 1.0f);
+    }
+
+    // clipped against the near plane z = -w a triangle keeps up to four vertices. The other planes are not needed,
+    // the raster is clamped to the screen.
+    glm::vec4 polygon[4];
+    int count = 0;
+    for (int k = 0; k < 3; k++) {
+        const glm::vec4& current = clip[k];
+        const glm::vec4& next = clip[(k + 1) % 3];
+        float currentDistance = current.z + current.w;
+        float nextDistance = next.z + next.w;
+        if (currentDistance >= 0.0f) {
+            polygon[count++] = current;
+        }
+        if ((currentDistance >= 0.0f) != (nextDistance >= 0.0f)) {
+            polygon[count++] = current + (next - current) * (currentDistance / (currentDistance - nextDistance));
+        }
+    }
+
+    Triangle& first = this->triangles[i * 2];
+    Triangle& second = this->triangles[i * 2 + 1];
+    first = Triangle();
+    second = Triangle();
+    if (count >= 3) {
+        this->setupTriangle(polygon[0], polygon[1], polygon[2], first);
+    }
+    if (count == 4) {
+        this->setupTriangle(polygon[0], polygon[2], polygon[3], second);
+    }
+}
+
+void OcclusionCuller::setupTriangle(const glm::vec4& a, const glm::vec4& b, const glm::vec4& c,
+                                    Triangle& triangle) const {
+    const glm::vec4* clip[3] = {&a, &b, &c};
+    double x[3], y[3], z[3];
+    for (int k = 0; k < 3; k++) {
+        if (clip[k]->w <= 0.0f) {
+            return;
+        }
+        double inverseW = 1.0 / clip[k]->w;
+        x[k] = (clip[k]->x * inverseW * 0.5 + 0.5) * this->width;
+        y[k] = (clip[k]->y * inverseW * 0.5 + 0.5) * this->height;
+        z[k] = clip[k]->z * inverseW * 0.5 + 0.5;
+    }
+
+    // both sides occlude, clockwise triangles are turned around
+    double area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+    if (area < 0.0) {
+        std::swap(x[1], x[2]);
+        std::swap(y[1], y[2]);
+        std::swap(z[1], z[2]);
+        area = -area;
+    }
+    if (!(area > 1e-9)) {
+        return;
+    }
+
+    double minX = std::max(std::min({x[0], x[1], x[2]}), 0.0);
+    double maxX = std::min(std::max({x[0], x[1], x[2]}), double(this->width));
+    double minY = std::max(std::min({y[0], y[1], y[2]}), 0.0);
+    double maxY = std::min(std::max({y[0], y[1], y[2]}), double(this->height));
+    if (minX >= maxX || minY >= maxY) {
+        return;
+    }
+
+    // the edge opposite of each vertex, the vertex lies on its positive side
+    for (int edge = 0; edge < 3; edge++) {
+        int from = (edge + 1) % 3;
+        int to = (edge + 2) % 3;
+        triangle.edgeA[edge] = y[from] - y[to];
+        triangle.edgeB[edge] = x[to] - x[from];
+        triangle.edgeC[edge] = x[from] * y[to] - y[from] * x[to];
+    }
+    triangle.depthA = ((z[1] - z[0]) * (y[2] - y[0]) - (z[2] - z[0]) * (y[1] - y[0])) / area;
+    triangle.depthB = ((x[1] - x[0]) * (z[2] - z[0]) - (x[2] - x[0]) * (z[1] - z[0])) / area;
+    // texels are sampled at their center but store the farthest depth of the plane within them, so a sloped occluder
+    // is nowhere nearer than it is
+    triangle.depthC = z[0] - triangle.depthA * x[0] - triangle.depthB * y[0] +
+                      0.5 * (std::abs(triangle.depthA) + std::abs(triangle.depthB));
+    triangle.minX = int(std::floor(minX));
+    triangle.maxX = int(std::ceil(maxX));
+    triangle.minY = int(std::floor(minY));
+    triangle.maxY = int(std::ceil(maxY));
+}
+
+void OcclusionCuller::rasterizeBand(int firstRow, int endRow) {
+    float* depth = this->levels[0].data();
+    for (const auto& triangle : this->triangles) {
+        int minY = std::max(triangle.minY, firstRow);
+        int maxY = std::min(triangle.maxY, endRow);
+        if (minY >= maxY) {
+            continue;
+        }
+        // the rows start in double precision, stepping along a row in single precision is exact enough
+        double left = triangle.minX + 0.5;
+        float edgeStep[3] = {float(triangle.edgeA[0]), float(triangle.edgeA[1]), float(triangle.edgeA[2])};
+        for (int y = minY; y < maxY; y++) {
+            double center = y + 0.5;
+            float edge[3];
+            for (int k = 0; k < 3; k++) {
+                edge[k] = float(triangle.edgeA[k] * left + triangle.edgeB[k] * center + triangle.edgeC[k]);
+            }
+            float plane = float(triangle.depthA * left + triangle.depthB * center + triangle.depthC);
+            rasterizeSpan(depth + y * this->width + triangle.minX, triangle.maxX - triangle.minX, edge, edgeStep,
+                          plane, float(triangle.depthA));
+        }
+    }
+}
+
+void OcclusionCuller::buildPyramid() {
+    for (size_t level = 1; level < this->levels.size(); level++) {
+        glm::ivec2 source = this->levelSizes[level - 1];
+        glm::ivec2 size = this->levelSizes[level];
+        const float* finer = this->levels[level - 1].data();
+        float* coarser = this->levels[level].data();
+        for (int y = 0; y < size.y; y++) {
+            // odd sizes repeat the last row and column
+            const float* row0 = finer + y * 2 * source.x;
+            const float* row1 = finer + std::min(y * 2 + 1, source.y - 1) * source.x;
+            for (int x = 0; x < size.x; x++) {
+                int x0 = x * 2;
+                int x1 = std::min(x * 2 + 1, source.x - 1);
+                coarser[x + y * size.x] = std::max(std::max(row0[x0], row0[x1]), std::max(row1[x0], row1[x1]));
+            }
+        }
+    }
+}
+
+bool OcclusionCuller::occluded(const BoundingBox& box, const glm::mat4& matrix) const {
+    float minX = 1e30f, minY = 1e30f, nearest = 1e30f;
+    float maxX = -1e30f, maxY = -1e30f;
+    for (int corner = 0; corner < 8; corner++) {
+        glm::vec4 position(corner & 1 ? box.maximum.x : box.minimum.x, corner & 2 ? box.maximum.y : box.minimum.y,
+                           corner & 4 ? box.maximum.z : box.minimum.z, 1.0f);
+        glm::vec4 clip = matrix * position;
+        if (clip.z < -clip.w) {
+            return false; // crosses the near plane
+        }
+        float inverseW = 1.0f / clip.w;
+        minX = std::min(minX, clip.x * inverseW);
+        maxX = std::max(maxX, clip.x * inverseW);
+        minY = std::min(minY, clip.y * inverseW);
+        maxY = std::max(maxY, clip.y * inverseW);
+        nearest = std::min(nearest, clip.z * inverseW);
+    }
+    if (maxX < -1.0f || minX > 1.0f || maxY < -1.0f || minY > 1.0f) {
+        return false; // left to the frustum
+    }
+
+    // texels touched by the box, grown by a texel so a box peeking over the silhouette of an occluder within a texel
+    // whose center is covered is still visible
+    int x0 = std::max(int(std::floor((std::max(minX, -1.0f) * 0.5f + 0.5f) * this->width)) - 1, 0);
+    int x1 = std::min(int(std::floor((std::min(maxX, 1.0f) * 0.5f + 0.5f) * this->width)) + 1, this->width - 1);
+    int y0 = std::max(int(std::floor((std::max(minY, -1.0f) * 0.5f + 0.5f) * this->height)) - 1, 0);
+    int y1 = std::min(int(std::floor((std::min(maxY, 1.0f) * 0.5f + 0.5f) * this->height)) + 1, this->height - 1);
+    int level = 0;
+    while (level + 1 < int(this->levels.size()) &&
+           std::max((x1 >> level) - (x0 >> level), (y1 >> level) - (y0 >> level)) >= MAX_BOX_TEXELS) {
+        level++;
+    }
+
+    const float* depth = this->levels[level].data();
+    int levelWidth = this->levelSizes[level].x;
+    float farthest = 0.0f;
+    for (int y = y0 >> level; y <= y1 >> level; y++) {
+        for (int x = x0 >> level; x <= x1 >> level; x++) {
+            farthest = std::max(farthest, depth[x + y * levelWidth]);
+        }
+    }
+    return nearest * 0.5f + 0.5f > farthest;
+}
+
+bool OcclusionCuller::isOccluded(const BoundingBox& box, const glm::mat4& model) const {
+    return this->rasterized && this->occluded(box, this->viewProjection * model);
+}
+
+size_t OcclusionCuller::cull(const BoundingBoxList& boxes, const glm::mat4& model, unsigned char* visible) {
+    if (!this->rasterized) {
+        return 0;
+    }
+    PROFILE_SCOPE("Occlusion test");
+    auto start = std::chrono::steady_clock::now();
+    glm::mat4 matrix = this->viewProjection * model;
+    std::atomic<size_t> occludedCount(0);
+    this->threadPool.parallelFor(boxes.size(), [&](size_t begin, size_t end) {
+        size_t occludedRange = 0;
+        for (size_t i = begin; i < end; i++) {
+            glm::vec3 center(boxes.centerX[i], boxes.centerY[i], boxes.centerZ[i]);
+            glm::vec3 extent(boxes.extentX[i], boxes.extentY[i], boxes.extentZ[i]);
+            if (visible[i] && this->occluded(BoundingBox(center - extent, center + extent), matrix)) {
+                visible[i] = 0;
+                occludedRange++;
+            }
+        }
+        occludedCount += occludedRange;
+    }, BOXES_PER_RANGE);
+    renderStats.occludedObjects += unsigned(occludedCount);
+    this->elapsed += microsecondsSince(start);
+    return occludedCount;
+}
+
+size_t OcclusionCuller::cull(const BoundingBox& box, const glm::mat4* models, size_t count, unsigned char* visible) {
+    if (!this->rasterized) {
+        return 0;
+    }
+    PROFILE_SCOPE("Occlusion test");
+    auto start = std::chrono::steady_clock::now();
+    std::atomic<size_t> occludedCount(0);
+    this->threadPool.parallelFor(count, [&](size_t begin, size_t end) {
+        size_t occludedRange = 0;
+        for (size_t i = begin; i < end; i++) {
+            if (visible[i] && this->occluded(box, this->viewProjection * models[i])) {
+                visible[i] = 0;
+                occludedRange++;
+            }
+        }
+        occludedCount += occludedRange;
+    }, BOXES_PER_RANGE);
+    renderStats.occludedObjects += unsigned(occludedCount);
+    this->elapsed += microsecondsSince(start);
+    return occludedCount;
+}
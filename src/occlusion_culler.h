@@ -0,0 +1,99 @@
+#ifndef OCCLUSION_CULLER_H
+#define OCCLUSION_CULLER_H
+
+#include "bounds.h"
+#include "thread_pool.h"
+
+#include <cstddef>
+#include <vector>
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+
+// size of the depth buffer occluders are rasterized into, about a quarter of the window along each axis
+const int OCCLUSION_BUFFER_WIDTH = 320;
+const int OCCLUSION_BUFFER_HEIGHT = 200;
+
+// occlusion culling on the CPU. Occluder triangles are rasterized into a small depth buffer, a box is occluded if its
+// nearest corner lies behind the farthest depth of all texels its screen rectangle touches, which is read from a max
+// depth pyramid. Occluders must lie inside the geometry they stand for, so only hidden objects are culled. Triangle
+// setup is split across the worker threads by triangles, rasterization by bands of rows, testing by boxes.
+class OcclusionCuller {
+public:
+    OcclusionCuller(ThreadPool& threadPool, int width, int height);
+    OcclusionCuller(const OcclusionCuller&) = delete;
+    OcclusionCuller& operator=(const OcclusionCuller&) = delete;
+
+    // drops the occluders of the last frame, occluders and boxes are transformed by viewProjection * model
+    void begin(const glm::mat4& viewProjection);
+    // three vertices per triangle, copied. Both sides of a triangle occlude.
+    void addOccluders(const glm::vec3* vertices, size_t count, const glm::mat4& model);
+    // rasterizes the occluders added since begin and builds the depth pyramid
+    void rasterize();
+
+    // thread safe once rasterized. Boxes crossing the near plane or outside the screen are never occluded.
+    bool isOccluded(const BoundingBox& box, const glm::mat4& model) const;
+    // clear visible[i] of the occluded boxes, boxes which are not visible are not tested. Returns the number of
+    // occluded boxes, which are counted in the render stats.
+    size_t cull(const BoundingBoxList& boxes, const glm::mat4& model, unsigned char* visible);
+    size_t cull(const BoundingBox& box, const glm::mat4* models, size_t count, unsigned char* visible);
+
+    size_t occluderTriangleCount() const {
+        return this->vertices.size() / 3;
+    }
+    // time spent rasterizing and testing since begin
+    double microseconds() const {
+        return this->elapsed;
+    }
+
+private:
+    // screen space triangle after clipping, ready to be rasterized
+    struct Triangle {
+        // texels covered by its bounds, minimum inclusive and maximum exclusive. Empty if the triangle was clipped.
+        int minX = 0;
+        int minY = 0;
+        int maxX = 0;
+        int maxY = 0;
+        // edge functions a * x + b * y + c, positive inside, and the depth plane. Double precision since clipped
+        // vertices can lie far outside of the screen.
+        double edgeA[3];
+        double edgeB[3];
+        double edgeC[3];
+        double depthA;
+        double depthB;
+        double depthC;
+    };
+
+    // occluders added with the same model share a matrix
+    struct Batch {
+        size_t first;
+        glm::mat4 matrix;
+    };
+
+    // clips triangle i against the near plane into triangles 2 * i and 2 * i + 1
+    void setup(size_t i, const glm::mat4& matrix);
+    // projects a triangle in clip space, triangles without area stay empty
+    void setupTriangle(const glm::vec4& a, const glm::vec4& b, const glm::vec4& c, Triangle& triangle) const;
+    void rasterizeBand(int firstRow, int endRow);
+    void buildPyramid();
+    // matrix transforms the box to clip space
+    bool occluded(const BoundingBox& box, const glm::mat4& matrix) const;
+
+    ThreadPool& threadPool;
+    int width;
+    int height;
+    glm::mat4 viewProjection = glm::mat4(1.0f);
+    std::vector<glm::vec3> vertices;
+    std::vector<Batch> batches;
+    std::vector<Triangle> triangles;
+    // level 0 is the depth buffer, every further level the maximum of 2x2 texels of the previous one. Depth is 0 at
+    // the near and 1 at the far plane.
+    std::vector<std::vector<float>> levels;
+    std::vector<glm::ivec2> levelSizes;
+    bool rasterized = false;
+    double elapsed = 0.0;
+};
+
+#endif // !OCCLUSION_CULLER_H
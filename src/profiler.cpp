@@ -0,0 +1,199 @@
+#include "profiler.h"
+
+#include <algorithm>
+#include <fstream>
+
+#include <fmt/format.h>
+using namespace fmt;
+
+Profiler profiler;
+
+Profiler::Profiler() : start(std::chrono::steady_clock::now()) {
+}
+
+double Profiler::now() const {
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - this->start).count();
+}
+
+Profiler::ThreadRing& Profiler::threadRing() {
+    // there is a single profiler, so one ring per thread is enough
+    thread_local ThreadRing* ring = nullptr;
+    if (!ring) {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->rings.emplace_back(new ThreadRing());
+        ring = this->rings.back().get();
+        ring->track = int(this->tracks.size());
+        this->tracks.push_back(format("Thread {}", ring->track));
+    }
+    return *ring;
+}
+
+void Profiler::setThreadName(const std::string& name) {
+    ThreadRing& ring = this->threadRing();
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->tracks[size_t(ring.track)] = name;
+}
+
+int Profiler::addTrack(const std::string& name) {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->tracks.push_back(name);
+    return int(this->tracks.size()) - 1;
+}
+
+std::vector<std::string> Profiler::trackNames() const {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    return this->tracks;
+}
+
+bool Profiler::beginScope(const char* name) {
+    if (!this->enabled) {
+        return false;
+    }
+    ThreadRing& ring = this->threadRing();
+    if (ring.depth < MAX_DEPTH) {
+        ring.names[ring.depth] = name;
+        ring.starts[ring.depth] = this->now();
+    }
+    ring.depth++;
+    return true;
+}
+
+void Profiler::endScope() {
+    ThreadRing& ring = this->threadRing();
+    ring.depth--;
+    if (ring.depth >= MAX_DEPTH) {
+        return;
+    }
+    uint64_t written = ring.written.load(std::memory_order_relaxed);
+    ProfileEvent& event = ring.events[written % RING_CAPACITY];
+    event.name = ring.names[ring.depth];
+    event.start = ring.starts[ring.depth];
+    event.duration = this->now() - event.start;
+    event.depth = ring.depth;
+    event.track = ring.track;
+    ring.written.store(written + 1, std::memory_order_release);
+}
+
+void Profiler::beginFrame() {
+    double frameStart = this->now();
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        for (auto& ring : this->rings) {
+            uint64_t written = ring->written.load(std::memory_order_acquire);
+            // a thread which finished more scopes than fit into its ring since the last frame loses the oldest ones
+            uint64_t first = std::max(ring->read, written > RING_CAPACITY ? written - RING_CAPACITY : 0);
+            for (uint64_t i = first; i < written; i++) {
+                this->current.events.push_back(ring->events[i % RING_CAPACITY]);
+            }
+            // the thread kept writing while the events were copied, drop the ones it may have overwritten
+            uint64_t overwritten = ring->written.load(std::memory_order_acquire);
+            if (overwritten > first + RING_CAPACITY) {
+                uint64_t lost = overwritten - first - RING_CAPACITY;
+                auto begin = this->current.events.end() - std::ptrdiff_t(written - first);
+                this->current.events.erase(begin, begin + std::ptrdiff_t(std::min(lost, written - first)));
+            }
+            ring->read = written;
+        }
+    }
+
+    this->current.end = frameStart;
+    this->history.push_back(std::move(this->current));
+    this->current = ProfileFrame();
+    this->current.start = frameStart;
+    if (this->history.size() > FRAME_HISTORY) {
+        this->capture(this->history.front());
+        this->history.pop_front();
+    }
+}
+
+void Profiler::addEvents(const std::vector<ProfileEvent>& events) {
+    for (const auto& event : events) {
+        if (event.start >= this->current.start) {
+            this->current.events.push_back(event);
+            continue;
+        }
+        for (auto frame = this->history.rbegin(); frame != this->history.rend(); ++frame) {
+            if (event.start >= frame->start) {
+                frame->events.push_back(event);
+                break;
+            }
+        }
+    }
+}
+
+const ProfileFrame& Profiler::frame() const {
+    // the oldest frame is only complete once the history is full
+    return this->history.size() == FRAME_HISTORY ? this->history.front() : this->empty;
+}
+
+void Profiler::startCapture(size_t frames, const std::string& path) {
+    this->captured.clear();
+    this->captureFrames = frames;
+    this->captureStart = this->now();
+    this->capturePath = path;
+}
+
+void Profiler::capture(const ProfileFrame& frame) {
+    // the frame which was running when the capture started is incomplete
+    if (this->captureFrames == 0 || frame.start < this->captureStart) {
+        return;
+    }
+    this->captured.insert(this->captured.end(), frame.events.begin(), frame.events.end());
+    if (--this->captureFrames == 0) {
+        this->writeChromeTrace(this->capturePath);
+        this->captured.clear();
+    }
+}
+
+void Profiler::finishCapture() {
+    while (this->captureFrames > 0 && !this->history.empty()) {
+        this->capture(this->history.front());
+        this->history.pop_front();
+    }
+    if (this->captureFrames > 0) {
+        this->captureFrames = 0;
+        this->writeChromeTrace(this->capturePath);
+        this->captured.clear();
+    }
+}
+
+static std::string escapeJson(const std::string& text) {
+    std::string escaped;
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            escaped += '\\';
+        }
+        escaped += c;
+    }
+    return escaped;
+}
+
+void Profiler::writeChromeTrace(const std::string& path) const {
+    std::ofstream out(path.c_str(), std::ios::out | std::ios::trunc);
+    if (!out) {
+        print(stderr, "Warning: failed to write profile {}\n", path);
+        return;
+    }
+    // trace event format, complete events plus one metadata event naming each track
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    const char* separator = "\n";
+    std::vector<std::string> names = this->trackNames();
+    for (size_t track = 0; track < names.size(); track++) {
+        out << separator
+            << format("{{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":{},\"args\":{{\"name\":\"{}\"}}}}",
+                      track, escapeJson(names[track]));
+        separator = ",\n";
+    }
+    for (const auto& event : this->captured) {
+        out << separator
+            << format("{{\"name\":\"{}\",\"ph\":\"X\",\"pid\":1,\"tid\":{},\"ts\":{:.3f},\"dur\":{:.3f}}}",
+                      escapeJson(event.name), event.track, event.start, event.duration);
+        separator = ",\n";
+    }
+    out << "\n]}\n";
+    if (!out) {
+        print(stderr, "Warning: failed to write profile {}\n", path);
+        return;
+    }
+    print("Wrote {} scopes to {}\n", this->captured.size(), path);
+}
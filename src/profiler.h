@@ -0,0 +1,137 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// one finished scope, times in microseconds since the profiler was created
+struct ProfileEvent {
+    const char* name = nullptr;
+    double start = 0.0;
+    double duration = 0.0;
+    // nesting depth on its track, 0 for the outermost scopes
+    int depth = 0;
+    // thread or GPU the scope ran on, see Profiler::trackNames
+    int track = 0;
+};
+
+struct ProfileFrame {
+    double start = 0.0;
+    double end = 0.0;
+    std::vector<ProfileEvent> events;
+};
+
+// hierarchical CPU profiler. Every thread records its scopes into a ring buffer only it writes to, so recording takes
+// no locks. Once per frame the render thread collects the scopes all threads finished since the previous frame, they
+// are shown in the profiler panel and can be captured to a Chrome trace. Scope names have to outlive the profiler,
+// e.g. string literals.
+class Profiler {
+public:
+    Profiler();
+    Profiler(const Profiler&) = delete;
+    Profiler& operator=(const Profiler&) = delete;
+
+    void setEnabled(bool enabled) {
+        this->enabled = enabled;
+    }
+    bool isEnabled() const {
+        return this->enabled;
+    }
+    // names the track of the calling thread, "Thread n" otherwise
+    void setThreadName(const std::string& name);
+    // returns false if the profiler is disabled, endScope must only be called for scopes which returned true
+    bool beginScope(const char* name);
+    void endScope();
+    // microseconds since the profiler was created
+    double now() const;
+
+    // render thread, at the start of every frame. The scopes finished since the previous call become a frame.
+    void beginFrame();
+    // track for scopes measured elsewhere, e.g. on the GPU
+    int addTrack(const std::string& name);
+    // scopes of such a track, they are added to the frame they started in as long as it is in the history
+    void addEvents(const std::vector<ProfileEvent>& events);
+
+    // GPU results arrive a few frames late, this is the newest frame that has them
+    const ProfileFrame& frame() const;
+    std::vector<std::string> trackNames() const;
+
+    // records the scopes of the next frames and writes them to path as a Chrome trace (chrome://tracing or
+    // ui.perfetto.dev) once they are complete
+    void startCapture(size_t frames, const std::string& path);
+    bool isCapturing() const {
+        return this->captureFrames > 0;
+    }
+    // writes what was captured so far, e.g. when the program exits before the capture is complete
+    void finishCapture();
+
+private:
+    static const size_t RING_CAPACITY = 8192;
+    static const int MAX_DEPTH = 32;
+    // frames kept for late results, one more than the latency of the GPU profiler
+    static const size_t FRAME_HISTORY = 3;
+
+    // written only by its thread, read by the render thread in beginFrame
+    struct ThreadRing {
+        int track = 0;
+        ProfileEvent events[RING_CAPACITY];
+        std::atomic<uint64_t> written{0};
+        uint64_t read = 0;
+        // open scopes of the thread, deeper ones are not recorded
+        const char* names[MAX_DEPTH];
+        double starts[MAX_DEPTH];
+        int depth = 0;
+    };
+
+    ThreadRing& threadRing();
+    void capture(const ProfileFrame& frame);
+    void writeChromeTrace(const std::string& path) const;
+
+    std::chrono::steady_clock::time_point start;
+    std::atomic<bool> enabled{true};
+
+    mutable std::mutex mutex;
+    std::vector<std::unique_ptr<ThreadRing>> rings;
+    std::vector<std::string> tracks;
+
+    // render thread only, the frame being collected and the finished ones, oldest first
+    ProfileFrame current;
+    std::deque<ProfileFrame> history;
+    ProfileFrame empty;
+    std::vector<ProfileEvent> captured;
+    size_t captureFrames = 0;
+    double captureStart = 0.0;
+    std::string capturePath;
+};
+
+extern Profiler profiler;
+
+// records the rest of the enclosing block as a scope
+class ProfileScope {
+public:
+    explicit ProfileScope(const char* name) : active(profiler.beginScope(name)) {
+    }
+    ~ProfileScope() {
+        if (this->active) {
+            profiler.endScope();
+        }
+    }
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+    bool active;
+};
+
+#define PROFILE_CONCATENATE_(a, b) a##b
+#define PROFILE_CONCATENATE(a, b) PROFILE_CONCATENATE_(a, b)
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCATENATE(profileScope, __LINE__)(name)
+
+#endif // !PROFILER_H
@@ -0,0 +1,158 @@
+#include "profiler_panel.h"
+
+#include "hash.h"
+
+#include <algorithm>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <imgui.h>
+
+#include <fmt/format.h>
+using namespace fmt;
+
+// frames written to CAPTURE_PATH by the capture button
+const size_t CAPTURE_FRAMES = 120;
+const char* const CAPTURE_PATH = "profile.json";
+const float TRACK_LABEL_WIDTH = 80.0f;
+const float ROW_HEIGHT = 18.0f;
+const float TRACK_SPACING = 4.0f;
+
+// the same scope gets the same color in every frame
+static ImU32 scopeColor(const char* name) {
+    float hue = float(hashString(name) % 1024) / 1024.0f;
+    return ImColor::HSV(hue, 0.5f, 0.65f);
+}
+
+static void drawTimeline(const ProfileFrame& frame, const std::vector<std::string>& trackNames) {
+    // deepest scope per track, -1 for tracks without scopes in this frame
+    std::vector<int> depths(trackNames.size(), -1);
+    for (const auto& event : frame.events) {
+        if (size_t(event.track) < depths.size()) {
+            depths[size_t(event.track)] = std::max(depths[size_t(event.track)], event.depth);
+        }
+    }
+
+    ImDrawList* drawList = ImGui::GetWindowDrawList();
+    ImVec2 origin = ImGui::GetCursorScreenPos();
+    float left = origin.x + TRACK_LABEL_WIDTH;
+    float width = std::max(ImGui::GetContentRegionAvail().x - TRACK_LABEL_WIDTH, 1.0f);
+    float scale = width / float(frame.end - frame.start);
+    float y = origin.y;
+    const ProfileEvent* hovered = nullptr;
+    for (size_t track = 0; track < trackNames.size(); track++) {
+        if (depths[track] < 0) {
+            continue;
+        }
+        float height = float(depths[track] + 1) * ROW_HEIGHT;
+        drawList->AddText(ImVec2(origin.x, y), IM_COL32(255, 255, 255, 255), trackNames[track].c_str());
+        // GPU scopes can run past the end of the frame
+        drawList->PushClipRect(ImVec2(left, y), ImVec2(left + width, y + height), true);
+        for (const auto& event : frame.events) {
+            if (size_t(event.track) != track) {
+                continue;
+            }
+            float x0 = std::max(left + float(event.start - frame.start) * scale, left);
+            float x1 = std::min(left + float(event.start + event.duration - frame.start) * scale, left + width);
+            if (x1 < x0) {
+                continue;
+            }
+            // scopes shorter than a pixel are still visible
+            x1 = std::max(x1, x0 + 1.0f);
+            float y0 = y + float(event.depth) * ROW_HEIGHT;
+            ImVec2 min(x0, y0);
+            ImVec2 max(x1, y0 + ROW_HEIGHT - 1.0f);
+            drawList->AddRectFilled(min, max, scopeColor(event.name));
+            if (x1 - x0 > ImGui::CalcTextSize(event.name).x + 4.0f) {
+                drawList->AddText(ImVec2(x0 + 2.0f, y0 + 2.0f), IM_COL32(255, 255, 255, 255), event.name);
+            }
+            if (ImGui::IsMouseHoveringRect(min, max)) {
+                hovered = &event;
+            }
+        }
+        drawList->PopClipRect();
+        y += height + TRACK_SPACING;
+    }
+    ImGui::Dummy(ImVec2(TRACK_LABEL_WIDTH + width, y - origin.y));
+    if (hovered) {
+        ImGui::SetTooltip("%s\n%.3f ms", hovered->name, hovered->duration / 1e3);
+    }
+}
+
+static void drawScopeTimes(const ProfileFrame& frame, const std::vector<std::string>& trackNames) {
+    struct ScopeTime {
+        double duration = 0.0;
+        int count = 0;
+    };
+    // nested scopes include the time of their children
+    std::map<std::pair<int, std::string>, ScopeTime> times;
+    for (const auto& event : frame.events) {
+        ScopeTime& time = times[std::make_pair(event.track, std::string(event.name))];
+        time.duration += event.duration;
+        time.count++;
+    }
+    std::vector<std::pair<std::pair<int, std::string>, ScopeTime>> sorted(times.begin(), times.end());
+    std::sort(sorted.begin(), sorted.end(),
+              [](const std::pair<std::pair<int, std::string>, ScopeTime>& a,
+                 const std::pair<std::pair<int, std::string>, ScopeTime>& b) {
+                  return a.second.duration > b.second.duration;
+              });
+
+    ImGui::Columns(4, "scope times");
+    ImGui::Text("Scope");
+    ImGui::NextColumn();
+    ImGui::Text("Track");
+    ImGui::NextColumn();
+    ImGui::Text("Count");
+    ImGui::NextColumn();
+    ImGui::Text("Milliseconds");
+    ImGui::NextColumn();
+    ImGui::Separator();
+    for (const auto& scope : sorted) {
+        int track = scope.first.first;
+        ImGui::Text("%s", scope.first.second.c_str());
+        ImGui::NextColumn();
+        ImGui::Text("%s", size_t(track) < trackNames.size() ? trackNames[size_t(track)].c_str() : "");
+        ImGui::NextColumn();
+        ImGui::Text("%d", scope.second.count);
+        ImGui::NextColumn();
+        ImGui::Text("%.3f", scope.second.duration / 1e3);
+        ImGui::NextColumn();
+    }
+    ImGui::Columns(1);
+}
+
+void drawProfilerPanel(Profiler& profiler) {
+    ImGui::SetNextWindowSize(ImVec2(800.0f, 400.0f), ImGuiCond_FirstUseEver);
+    if (!ImGui::Begin("Profiler")) {
+        ImGui::End();
+        return;
+    }
+
+    bool enabled = profiler.isEnabled();
+    if (ImGui::Checkbox("Enabled", &enabled)) {
+        profiler.setEnabled(enabled);
+    }
+    ImGui::SameLine();
+    if (profiler.isCapturing()) {
+        ImGui::Text("Capturing to %s", CAPTURE_PATH);
+    } else if (ImGui::Button(format("Capture {} frames", CAPTURE_FRAMES).c_str())) {
+        profiler.startCapture(CAPTURE_FRAMES, CAPTURE_PATH);
+    }
+
+    const ProfileFrame& frame = profiler.frame();
+    if (frame.events.empty() || frame.end <= frame.start) {
+        ImGui::Text("No scopes recorded");
+        ImGui::End();
+        return;
+    }
+    ImGui::Text("Frame: %.2f ms, %d scopes", (frame.end - frame.start) / 1e3, int(frame.events.size()));
+    std::vector<std::string> trackNames = profiler.trackNames();
+    drawTimeline(frame, trackNames);
+    if (ImGui::CollapsingHeader("Scope times")) {
+        drawScopeTimes(frame, trackNames);
+    }
+    ImGui::End();
+}
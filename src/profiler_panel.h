@@ -0,0 +1,10 @@
+#ifndef PROFILER_PANEL_H
+#define PROFILER_PANEL_H
+
+#include "profiler.h"
+
+// ImGui window showing the scopes of the profiler's last complete frame as a timeline with one lane per thread and
+// the GPU, and their total time per frame. Has to be called between ImGui::NewFrame and ImGui::Render.
+void drawProfilerPanel(Profiler& profiler);
+
+#endif // !PROFILER_PANEL_H
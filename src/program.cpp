@@ -1,11 +1,17 @@
 #include "program.h"
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
 #include <iostream>
 #include <stdexcept>
 
+#include <glm/geometric.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtx/rotate_vector.hpp>
 #include <glm/mat4x4.hpp>
+#include <glm/matrix.hpp>
+#include <glm/vec4.hpp>
 
 #include <fmt/format.h>
 using namespace fmt;
@@ -15,9 +21,15 @@ using namespace fmt;
 #include "gui/imgui_impl_glfw.h"
 #include "gui/imgui_impl_opengl3.h"
 
+#include "frustum.h"
+#include "gpu_profiler.h"
 #include "heightmap.h"
 #include "model.h"
-#include "shader.h"
+#include "profiler.h"
+#include "profiler_panel.h"
+#include "program_cache.h"
+#include "render_state.h"
+#include "render_stats.h"
 #include "shader_program.h"
 
 static void glfwErrorCallback(int /*unused*/, const char* message) {
@@ -36,17 +48,66 @@ static void openglErrorCallback(GLenum /*unused*/, GLenum type, GLuint /*unused*
     }
 }
 
+// counts the object as drawn or culled, the cheap sphere test rejects most invisible objects. Objects inside the
+// frustum are tested against the occluders if there are any, the culler counts the occluded ones.
+static bool isVisible(const Frustum& frustum, const BoundingSphere& sphere, const BoundingBox& box,
+                      const glm::mat4& model, OcclusionCuller* occlusion) {
+    if (!frustum.intersects(sphere.transformed(model)) || !frustum.intersects(box.transformed(model))) {
+        renderStats.culledObjects++;
+        return false;
+    }
+    unsigned char visible = 1;
+    if (occlusion && occlusion->cull(box, &model, 1, &visible) > 0) {
+        return false;
+    }
+    renderStats.drawnObjects++;
+    return true;
+}
+
 const int WINDOW_WIDTH = 1280;
 const int WINDOW_HEIGHT = 800;
 
-void Program::init() {
-    this->initGlfw();
+const float SPACESHIP_SCALE = 0.001f;
+// headless runs advance the simulation by a fixed step per frame, so every run sees the same frames
+const float HEADLESS_FRAME_RATE = 60.0f;
+// frames drawn after the assets are loaded before the measurement starts, lets the terrain and textures stream in
+const int HEADLESS_WARMUP_FRAMES = 60;
+// milliseconds per frame spent on tasks the worker threads queued for the render thread, e.g. asset uploads
+const double RENDER_TASK_BUDGET = 4.0;
+// binaries of the linked shader programs, specific to the driver they were built with
+const char* const PROGRAM_CACHE_DIRECTORY = "shaders/cache";
+// initial size of the per frame data in the stream buffer, it grows when e.g. a large fleet needs more
+const size_t STREAM_BUFFER_FRAME_SIZE = size_t(1) * 1024 * 1024;
+
+constexpr UniformId TERRAIN_CAMERA_POSITION_UNIFORM("terrain_camera_position");
+
+void Program::init(const ProgramOptions& options) {
+    profiler.setThreadName("Render");
+    this->threadPool = std::unique_ptr<ThreadPool>(new ThreadPool());
+    this->assetLoader = std::unique_ptr<AssetLoader>(new AssetLoader(*this->threadPool));
+    this->headlessFrames = options.headlessFrames;
+    this->tracePath = options.tracePath;
+    this->occlusionCulling = options.occlusionCulling;
+    this->occlusionCuller = std::unique_ptr<OcclusionCuller>(
+        new OcclusionCuller(*this->threadPool, OCCLUSION_BUFFER_WIDTH, OCCLUSION_BUFFER_HEIGHT));
+    if (this->headlessFrames > 0) {
+        this->initHeadless();
+    } else {
+        this->initGlfw();
+    }
     this->initGlew();
     this->initOpenGL();
-    this->initGui();
-    this->loadModel();
+    this->initShaders();
+    this->textureManager = std::unique_ptr<TextureManager>(
+        new TextureManager(*this->assetLoader, *this->threadPool, options.textureBudget));
+    if (!this->headless) {
+        this->initGui();
+    }
+    this->loadModel(options.vertexFormat);
+    this->initFleet(options.fleetSize);
     this->initLight();
     this->initHeightMap();
+    this->initUniformBuffers();
     this->initCamera();
 }
 
@@ -74,17 +135,35 @@ void Program::initGlfw() {
     glfwSetWindowUserPointer(this->window, (void*)this);
 }
 
+void Program::initHeadless() {
+    // same size as the window so the results are comparable
+    this->headless = HeadlessContext::create(WINDOW_WIDTH, WINDOW_HEIGHT);
+}
+
 void Program::initGlew() {
+    if (this->headless) {
+        this->headless->initGlew();
+        return;
+    }
     glewExperimental = GL_TRUE;
-    glewInit();
+    GLenum result = glewInit();
+    if (result != GLEW_OK) {
+        throw std::runtime_error(
+            format("Failed to initialize GLEW: {}", reinterpret_cast<const char*>(glewGetErrorString(result))));
+    }
 }
 
 void Program::initOpenGL() {
+    if (this->headless) {
+        this->headless->initFramebuffer();
+    }
+    this->gpuTimer = std::unique_ptr<GpuFrameTimer>(new GpuFrameTimer());
     glEnable(GL_DEBUG_OUTPUT);
     glDebugMessageCallback(openglErrorCallback, nullptr);
 
-    glEnable(GL_DEPTH_TEST); // enable depth testing
-    glDepthFunc(GL_LESS); // smaller value is closer
+    renderState.setDepthTest(true);
+    renderState.setDepthFunction(GL_LESS); // smaller value is closer
+    glPrimitiveRestartIndex(PRIMITIVE_RESTART_INDEX);
     glEnable(GL_MULTISAMPLE);
     glViewport(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT);
 }
@@ -107,26 +186,93 @@ void Program::initGui() {
     ImGui::StyleColorsDark();
 }
 
-void Program::loadModel() {
-    // load model
-    this->spaceShip = std::make_shared<Model>(Model::loadFromFile("assets/spaceship/Corvette-F3.obj"));
-    this->spaceShip->addTexture(Texture::loadFromFile("assets/spaceship/SF_Corvette-F3_diffuse.jpg"));
-
-    // load shader
-    Shader fragmentShader = Shader::loadFromFile("shaders/model_fragment.glsl", Shader::Type::Fragment);
-    Shader vertexShader = Shader::loadFromFile("shaders/model_vertex.glsl", Shader::Type::Vertex);
-    this->spaceShipShaderProgram = std::make_shared<ShaderProgram>();
-    this->spaceShipShaderProgram->attachShader(vertexShader);
-    this->spaceShipShaderProgram->attachShader(fragmentShader);
-    this->spaceShipShaderProgram->setAttribLocation("vertex_position", 0);
-    this->spaceShipShaderProgram->setAttribLocation("texture_coordinate", 1);
-    this->spaceShipShaderProgram->link();
+void Program::initShaders() {
+    std::vector<std::pair<std::string, unsigned int>> uniformBlocks = {{"Frame", FRAME_UNIFORM_BINDING},
+                                                                       {"Object", OBJECT_UNIFORM_BINDING}};
+
+    // the meshes in the mesh pools are drawn with the INSTANCED permutations, which read the model matrix from the
+    // instance_model attribute
+    ProgramDescription model;
+    model.vertexPath = "shaders/model_vertex.glsl";
+    model.fragmentPath = "shaders/model_fragment.glsl";
+    model.attributeLocations = {{"vertex_position", Model::POSITION_LOCATION},
+                                {"texture_coordinate", Model::TEXTURE_POSITION_LOCATION},
+                                {"vertex_normal", Model::NORMAL_LOCATION},
+                                {"instance_model", INSTANCE_MODEL_LOCATION}};
+    model.uniformBlockBindings = uniformBlocks;
+    ProgramDescription instancedModel = model;
+    instancedModel.defines = {"INSTANCED"};
+
+    ProgramDescription light;
+    light.vertexPath = "shaders/light_vertex.glsl";
+    light.fragmentPath = "shaders/light_fragment.glsl";
+    light.defines = {"INSTANCED"};
+    light.attributeLocations = {{"vertex_position", Object::POSITION_LOCATION},
+                                {"vertex_color", Object::COLOR_LOCATION},
+                                {"instance_model", INSTANCE_MODEL_LOCATION}};
+    light.uniformBlockBindings = uniformBlocks;
+
+    ProgramDescription heightMap;
+    heightMap.vertexPath = "shaders/heightmap_vertex.glsl";
+    heightMap.fragmentPath = "shaders/heightmap_fragment.glsl";
+    heightMap.attributeLocations = {{"vertex_heights", 0}, {"vertex_normal", 1}};
+    heightMap.uniformBlockBindings = uniformBlocks;
+
+    ProgramDescription debug;
+    debug.vertexPath = "shaders/debug_vertex.glsl";
+    debug.fragmentPath = "shaders/debug_fragment.glsl";
+    debug.attributeLocations = {{"vertex_position", DebugDraw::POSITION_LOCATION},
+                                {"vertex_color", DebugDraw::COLOR_LOCATION}};
+    debug.uniformBlockBindings = uniformBlocks;
+
+    this->programCache = std::unique_ptr<ProgramCache>(new ProgramCache(PROGRAM_CACHE_DIRECTORY));
+    this->modelPrograms = std::unique_ptr<ProgramVariants>(new ProgramVariants(*this->programCache, model));
+    std::vector<std::shared_ptr<ShaderProgram>> programs =
+        this->programCache->build({instancedModel, light, heightMap, debug});
+    // the same program as programs[0], the variants find it in the cache
+    this->spaceShipShaderProgram = this->modelPrograms->get({"INSTANCED"});
+    this->lightShaderProgram = programs[1];
+    this->heightMapShaderProgram = programs[2];
+    this->debugDraw = std::unique_ptr<DebugDraw>(new DebugDraw(programs[3]));
+    print("Shader programs: {} in {:.1f} ms, {} from the binary cache, {} compiled", programs.size(),
+          this->programCache->milliseconds(), this->programCache->cachedCount(), this->programCache->compiledCount());
+    if (this->programCache->rejectedCount() > 0) {
+        print(" ({} cached binaries rejected by the driver)", this->programCache->rejectedCount());
+    }
+    print("\n");
+}
+
+void Program::loadModel(VertexFormat vertexFormat) {
+    // load model, the mesh and the diffuse texture are read side by side, the texture manager draws the grey
+    // placeholder until the texture arrives
+    std::string texturePath = "assets/spaceship/SF_Corvette-F3_diffuse.jpg";
+    this->spaceShipTexture = this->textureManager->load(texturePath);
+
+    this->modelMeshes = Model::createMeshPool(vertexFormat);
+    std::string modelPath = "assets/spaceship/Corvette-F3.obj";
+    auto readModel = [modelPath, vertexFormat] { return Model::readFromFile(modelPath, vertexFormat); };
+    auto uploadModel = [this](ModelData& data) {
+        this->spaceShip = std::make_shared<Model>(Model::fromData(data, *this->textureManager, *this->modelMeshes));
+        this->spaceShip->setDefaultTexture(this->spaceShipTexture);
+        this->fleet = std::unique_ptr<Fleet>(
+            new Fleet(this->spaceShip->boundingSphere(), this->spaceShip->boundingBox(), SPACESHIP_SCALE,
+                      *this->threadPool));
+        print("Space ship: {} KB of {} vertices\n", this->spaceShip->vertexBytes() / 1024,
+              vertexFormatName(this->spaceShip->vertexFormat()));
+    };
+    this->assetLoader->load<ModelData>(modelPath, readModel, uploadModel);
 
     this->spaceShipRotation = glm::angleAxis(glm::radians(0.0f), glm::vec3(0.0f, 0.0f, 0.0f));
 }
 
+void Program::initFleet(int size) {
+    this->fleetSize = size;
+}
+
 void Program::initLight() {
+    this->objectMeshes = Object::createMeshPool();
     this->light = std::make_shared<Object>(Object(
+        *this->objectMeshes,
         {
             // vertices
             // front
@@ -172,25 +318,28 @@ void Program::initLight() {
             glm::vec3(1.0, 1.0, 1.0),
             glm::vec3(1.0, 1.0, 1.0),
         }));
-    Shader fragmentShader = Shader::loadFromFile("shaders/light_fragment.glsl", Shader::Type::Fragment);
-    Shader vertexShader = Shader::loadFromFile("shaders/light_vertex.glsl", Shader::Type::Vertex);
-    this->lightShaderProgram = std::make_shared<ShaderProgram>();
-    this->lightShaderProgram->attachShader(vertexShader);
-    this->lightShaderProgram->attachShader(fragmentShader);
-    this->lightShaderProgram->setAttribLocation("vertex_position", 0);
-    // this->lightShaderProgram->setAttribLocation("vertex_color", 1);
-    this->lightShaderProgram->link();
 }
 
 void Program::initHeightMap() {
-    this->heightMap = std::make_shared<Object>(loadHeightMap("assets/heightmap.png"));
-    Shader fragmentShader = Shader::loadFromFile("shaders/heightmap_fragment.glsl", Shader::Type::Fragment);
-    Shader vertexShader = Shader::loadFromFile("shaders/heightmap_vertex.glsl", Shader::Type::Vertex);
-    this->heightMapShaderProgram = std::make_shared<ShaderProgram>();
-    this->heightMapShaderProgram->attachShader(vertexShader);
-    this->heightMapShaderProgram->attachShader(fragmentShader);
-    this->heightMapShaderProgram->setAttribLocation("vertex_position", 0);
-    this->heightMapShaderProgram->link();
+    // decoding the heightmap and computing the chunk bounds do not need the OpenGL context, the terrain generates and
+    // uploads its chunks itself once it is in place
+    std::string path = "assets/heightmap.png";
+    ThreadPool* threadPool = this->threadPool.get();
+    auto readTerrain = [path, threadPool] {
+        auto heightMap = std::make_shared<HeightMap>(HeightMap::loadFromFile(path));
+        return std::make_shared<Terrain>(heightMap, *threadPool);
+    };
+    auto uploadTerrain = [this](std::shared_ptr<Terrain>& terrain) { this->terrain = terrain; };
+    this->assetLoader->load<std::shared_ptr<Terrain>>(path, readTerrain, uploadTerrain);
+}
+
+void Program::initUniformBuffers() {
+    this->frameUniformBuffer =
+        std::unique_ptr<UniformBuffer>(new UniformBuffer(FRAME_UNIFORM_BINDING, sizeof(FrameUniforms)));
+    this->streamBuffer = std::unique_ptr<StreamBuffer>(new StreamBuffer(STREAM_BUFFER_FRAME_SIZE));
+    this->objectUniformBuffer = std::unique_ptr<UniformRingBuffer>(
+        new UniformRingBuffer(OBJECT_UNIFORM_BINDING, sizeof(ObjectUniforms), *this->streamBuffer));
+    this->renderQueue = std::unique_ptr<RenderQueue>(new RenderQueue());
 }
 
 void Program::initCamera() {
@@ -206,14 +355,43 @@ void Program::mainLoop() {
     glm::vec3 heightMapPosition = glm::vec3(-100.0, -15.0, -100.0);
     glm::vec3 heightMapScale = glm::vec3(1.0f, 2.0f, 1.0f);
 
-    while (!glfwWindowShouldClose(window)) {
-        float currentFrame = glfwGetTime();
+    auto previousFrameStart = std::chrono::steady_clock::now();
+    while (this->isRunning()) {
+        profiler.beginFrame();
+        gpuProfiler.beginFrame();
+        PROFILE_SCOPE("Frame");
+        auto frameStart = std::chrono::steady_clock::now();
+        if (this->headless && this->loadedFrames > HEADLESS_WARMUP_FRAMES) {
+            // the previous frame was measured, it lasted until now
+            this->frameReport.addFrameTime(
+                std::chrono::duration<double, std::milli>(frameStart - previousFrameStart).count());
+        }
+        previousFrameStart = frameStart;
+        float currentFrame =
+            this->headless ? float(std::max(this->loadedFrames, 0)) / HEADLESS_FRAME_RATE : float(glfwGetTime());
         deltaTime = currentFrame - lastFrame;
         lastFrame = currentFrame;
 
-        this->handleInput();
+        int framebufferWidth, framebufferHeight;
+        if (this->headless) {
+            this->flyScriptedPath(currentFrame);
+            framebufferWidth = this->headless->width();
+            framebufferHeight = this->headless->height();
+        } else {
+            this->handleInput();
+            glfwGetFramebufferSize(this->window, &framebufferWidth, &framebufferHeight);
+        }
+        renderStats.reset();
+        this->gpuTimer->begin();
+        PROFILE_GPU_SCOPE("Frame");
+        {
+            // uploads assets and whatever else the worker threads finished for the render thread
+            PROFILE_GPU_SCOPE("Uploads");
+            this->threadPool->runRenderTasks(RENDER_TASK_BUDGET);
+        }
 
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        renderState.setPolygonMode(wireframe ? GL_LINE : GL_FILL);
 
         // simulation
         glm::vec3 forward = glm::vec3(0.0f, 0.0f, 1.0f);
@@ -227,41 +405,165 @@ void Program::mainLoop() {
         glm::vec3 dir = glm::rotate(directionVector, glm::radians(30.0f), left);
         glm::vec3 eye = this->spaceShipPosition - dir * 8.0f;
         glm::mat4 view = glm::lookAt(eye, this->spaceShipPosition, up);
+        Frustum frustum(this->projectionMatrix * view);
 
-        // draw space ship
-        glm::mat4 spaceShipModelMatrix = glm::translate(glm::mat4(1.0f), this->spaceShipPosition);
-        spaceShipModelMatrix = glm::scale(spaceShipModelMatrix, glm::vec3(0.001, 0.001, 0.001));
-        spaceShipModelMatrix *= glm::toMat4(this->spaceShipRotation);
-
-        glm::mat4 mvp = this->projectionMatrix * view * spaceShipModelMatrix;
-        this->spaceShipShaderProgram->use();
-        this->spaceShipShaderProgram->setUniform("mvp", mvp);
-        this->spaceShip->draw(wireframe);
-
-        // draw light
         glm::mat4 lightModel = glm::mat4(1.0f);
         lightModel = glm::scale(lightModel, glm::vec3(0.1, 0.1, 0.1));
         lightModel = glm::translate(lightModel, lightPosition);
-        mvp = this->projectionMatrix * view * lightModel;
-        this->lightShaderProgram->use();
-        this->lightShaderProgram->setUniform("mvp", mvp);
-        this->light->draw(wireframe);
 
-        // draw heightmap
+        // per frame uniforms shared by all programs
+        FrameUniforms frameUniforms;
+        frameUniforms.view = view;
+        frameUniforms.projection = this->projectionMatrix;
+        frameUniforms.viewProjection = this->projectionMatrix * view;
+        frameUniforms.cameraPosition = glm::vec4(eye, 1.0f);
+        frameUniforms.lightPosition = lightModel[3];
+        frameUniforms.lightColor = glm::vec4(1.0f);
+        this->frameUniformBuffer->update(&frameUniforms);
+
+        // visible objects submit draw packets and write their model matrices into the stream buffer, the packets are
+        // drawn sorted by state and distance
+        this->renderQueue->begin(eye);
+        this->streamBuffer->beginFrame();
+        this->objectUniformBuffer->beginFrame();
+        glm::mat4 viewProjection = frameUniforms.viewProjection;
+
+        // heightmap first, its chunks occlude everything else. Level of detail falls off with the distance to the
+        // camera, chunks are culled in terrain space.
         glm::mat4 heightMapModel = glm::mat4(1.0f);
         heightMapModel = glm::scale(heightMapModel, heightMapScale);
         heightMapModel = glm::translate(heightMapModel, heightMapPosition);
-        mvp = this->projectionMatrix * view * heightMapModel;
-        this->heightMapShaderProgram->use();
-        this->heightMapShaderProgram->setUniform("mvp", mvp);
-        this->heightMap->draw(wireframe);
+        glm::vec3 terrainEye = glm::vec3(glm::inverse(heightMapModel) * glm::vec4(eye, 1.0f));
+        if (this->terrain) {
+            PROFILE_SCOPE("Heightmap");
+            this->terrain->update(terrainEye, Frustum(viewProjection * heightMapModel), this->terrainSettings);
+        }
+        OcclusionCuller* occlusion = nullptr;
+        if (this->occlusionCulling && this->terrain) {
+            PROFILE_SCOPE("Occlusion");
+            this->occlusionCuller->begin(viewProjection);
+            this->terrain->addOccluders(*this->occlusionCuller, heightMapModel);
+            this->occlusionCuller->rasterize();
+            this->terrain->cullOccluded(*this->occlusionCuller, heightMapModel);
+            occlusion = this->occlusionCuller.get();
+        }
+
+        // space ship, a cube stands in for it while it is loading. The model matrices of the ship, the fleet and the
+        // light are instance transforms, the ship and the fleet share the dequantization in the Object block.
+        this->renderQueue->setPass("Ship");
+        glm::mat4 spaceShipModelMatrix = glm::translate(glm::mat4(1.0f), this->spaceShipPosition);
+        if (!this->spaceShip) {
+            glm::mat4 placeholderModel = spaceShipModelMatrix * glm::toMat4(this->spaceShipRotation);
+            placeholderModel = glm::scale(placeholderModel, glm::vec3(0.5f));
+            this->light->submit(*this->renderQueue, *this->lightShaderProgram,
+                                this->renderQueue->pushInstances(&placeholderModel, 1), this->spaceShipPosition);
+        }
+        size_t spaceShipBlock = DrawPacket::NO_OBJECT_BLOCK;
+        if (this->spaceShip) {
+            ObjectUniforms spaceShipUniforms = this->spaceShip->objectUniforms(glm::mat4(1.0f));
+            spaceShipBlock = this->objectUniformBuffer->push(&spaceShipUniforms);
+        }
+        spaceShipModelMatrix = glm::scale(spaceShipModelMatrix, glm::vec3(SPACESHIP_SCALE));
+        spaceShipModelMatrix *= glm::toMat4(this->spaceShipRotation);
+        if (this->spaceShip && isVisible(frustum, this->spaceShip->boundingSphere(), this->spaceShip->boundingBox(),
+                                         spaceShipModelMatrix, occlusion)) {
+            PROFILE_SCOPE("Ship");
+            this->spaceShip->submit(*this->renderQueue, *this->spaceShipShaderProgram, spaceShipBlock,
+                                    Frustum(viewProjection * spaceShipModelMatrix),
+                                    this->renderQueue->pushInstances(&spaceShipModelMatrix, 1),
+                                    this->spaceShipPosition);
+            float radius = this->spaceShip->boundingSphere().radius * SPACESHIP_SCALE;
+            float distance = glm::distance(eye, this->spaceShipPosition);
+            float size = TextureManager::screenSize(radius, distance, this->projectionMatrix, framebufferHeight);
+            this->spaceShip->requestTextures(*this->textureManager, size);
+        }
+
+        // fleet
+        if (this->fleet && this->fleet->size() != size_t(this->fleetSize)) {
+            this->fleet->resize(size_t(this->fleetSize));
+        }
+        if (this->fleet && this->fleet->size() > 0) {
+            PROFILE_SCOPE("Fleet");
+            this->renderQueue->setPass("Fleet");
+            glm::vec3 fleetCenter = this->spaceShipPosition + left * 20.0f;
+            this->fleet->update(fleetCenter, currentFrame, frustum, occlusion);
+            const std::vector<glm::mat4>& transforms = this->fleet->visibleTransforms();
+            // the closest ship decides the mip levels the fleet needs
+            float closest = 1e30f;
+            for (const auto& transform : transforms) {
+                closest = std::min(closest, glm::distance(eye, glm::vec3(transform[3])));
+            }
+            if (!transforms.empty()) {
+                float radius = this->spaceShip->boundingSphere().radius * SPACESHIP_SCALE;
+                float size = TextureManager::screenSize(radius, closest, this->projectionMatrix, framebufferHeight);
+                this->spaceShip->requestTextures(*this->textureManager, size);
+            }
+            GLuint firstShip = this->renderQueue->pushInstances(transforms.data(), transforms.size());
+            if (this->instancing) {
+                this->spaceShip->submitInstanced(*this->renderQueue, *this->spaceShipShaderProgram, spaceShipBlock,
+                                                 firstShip, transforms.size(), fleetCenter);
+            } else {
+                // a packet per ship and material, merged into multi draws by the queue
+                for (size_t i = 0; i < transforms.size(); i++) {
+                    this->spaceShip->submit(*this->renderQueue, *this->spaceShipShaderProgram, spaceShipBlock,
+                                            Frustum(viewProjection * transforms[i]), firstShip + GLuint(i),
+                                            glm::vec3(transforms[i][3]));
+                }
+            }
+        }
+
+        // light
+        this->renderQueue->setPass("Light");
+        if (isVisible(frustum, this->light->boundingSphere(), this->light->boundingBox(), lightModel, occlusion)) {
+            PROFILE_SCOPE("Light");
+            this->light->submit(*this->renderQueue, *this->lightShaderProgram,
+                                this->renderQueue->pushInstances(&lightModel, 1), glm::vec3(lightModel[3]));
+        }
+
+        // heightmap, updated and culled before the objects
+        if (this->terrain) {
+            PROFILE_SCOPE("Heightmap");
+            this->renderQueue->setPass("Heightmap");
+            this->terrain->submit(*this->renderQueue, *this->heightMapShaderProgram, *this->objectUniformBuffer,
+                                  heightMapModel);
+            this->heightMapShaderProgram->use();
+            this->heightMapShaderProgram->setUniform(TERRAIN_CAMERA_POSITION_UNIFORM, terrainEye);
+        }
+
+        this->objectUniformBuffer->flush();
+        this->renderQueue->sort();
+        this->renderQueue->setMultiDraw(this->multiDraw);
+        this->renderQueue->execute(*this->objectUniformBuffer, *this->streamBuffer);
+        if (this->drawBounds) {
+            PROFILE_SCOPE("Bounds");
+            PROFILE_GPU_SCOPE("Bounds");
+            if (this->spaceShip) {
+                this->debugDraw->box(this->spaceShip->boundingBox(), spaceShipModelMatrix, glm::vec3(0.0f, 1.0f, 1.0f));
+                if (this->fleet && this->fleet->size() > 0) {
+                    for (const auto& transform : this->fleet->visibleTransforms()) {
+                        this->debugDraw->box(this->spaceShip->boundingBox(), transform, glm::vec3(0.0f, 0.5f, 1.0f));
+                    }
+                }
+            }
+            this->debugDraw->box(this->light->boundingBox(), lightModel, glm::vec3(1.0f, 1.0f, 0.0f));
+            if (this->terrain) {
+                this->terrain->drawBounds(*this->debugDraw, heightMapModel);
+            }
+            this->debugDraw->draw(*this->streamBuffer);
+        }
+        this->streamBuffer->endFrame();
+        // streams in the mip levels requested while submitting, they are drawn from the next frame on
+        this->textureManager->update();
 
         if (drawGui) {
+            PROFILE_SCOPE("GUI");
+            PROFILE_GPU_SCOPE("GUI");
             // draw gui
             ImGui_ImplOpenGL3_NewFrame();
             ImGui_ImplGlfw_NewFrame();
             ImGui::NewFrame();
             ImGui::Checkbox("Wireframe", &wireframe);
+            ImGui::Checkbox("Bounds", &this->drawBounds);
             ImGui::SliderFloat("Camera X", &cameraPosition.x, -10.0f, 10.0f);
             ImGui::SliderFloat("Camera Y", &cameraPosition.y, -10.0f, 10.0f);
             ImGui::SliderFloat("Camera Z", &cameraPosition.z, -10.0f, 10.0f);
@@ -276,16 +578,162 @@ void Program::mainLoop() {
             ImGui::SliderFloat("Heightmap Scale X", &heightMapScale.x, -5.0f, 5.0f);
             ImGui::SliderFloat("Heightmap Scale Y", &heightMapScale.y, -5.0f, 5.0f);
             ImGui::SliderFloat("Heightmap Scale Z", &heightMapScale.z, -5.0f, 5.0f);
+            ImGui::Checkbox("Terrain LOD", &this->terrainSettings.levelOfDetail);
+            ImGui::SliderFloat("Terrain View Distance", &this->terrainSettings.viewDistance, 16.0f, 2048.0f);
+            ImGui::SliderFloat("Terrain LOD Distance", &this->terrainSettings.lodDistance, TERRAIN_MIN_LOD_DISTANCE,
+                               512.0f);
+            // typed in values are not clamped by the slider
+            this->terrainSettings.lodDistance = std::max(this->terrainSettings.lodDistance, TERRAIN_MIN_LOD_DISTANCE);
+            ImGui::SliderInt("Terrain Triangle Budget", &this->terrainSettings.triangleBudget, 1000, 1000000);
+            ImGui::Checkbox("Terrain Strips", &this->terrainSettings.triangleStrips);
+            if (this->terrain) {
+                ImGui::Text("Terrain: %u triangles/frame in %d chunks%s", this->terrain->triangleCount(),
+                            int(this->terrain->drawnChunkCount()),
+                            this->terrain->triangleBudgetExceeded() ? ", over budget" : "");
+                ImGui::Text("Terrain chunks: %d resident, %d pending, %d culled, %d occluded",
+                            int(this->terrain->residentChunkCount()), int(this->terrain->pendingChunkCount()),
+                            int(this->terrain->culledChunkCount()), int(this->terrain->occludedChunkCount()));
+            }
+            ImGui::Checkbox("Occlusion Culling", &this->occlusionCulling);
+            if (this->occlusionCulling) {
+                ImGui::Text("Occlusion: %d occluder triangles, %.0f us",
+                            int(this->occlusionCuller->occluderTriangleCount()), this->occlusionCuller->microseconds());
+            }
+            ImGui::Text("Objects: %u drawn, %u culled, %u occluded, %u submeshes culled", renderStats.drawnObjects,
+                        renderStats.culledObjects, renderStats.occludedObjects, renderStats.culledSubmeshes);
+            if (RenderQueue::multiDrawSupported()) {
+                ImGui::Checkbox("Multi Draw Indirect", &this->multiDraw);
+            }
+            ImGui::Text("Draw calls: %u for %u draws, texture binds: %u, packets: %d", renderStats.drawCalls,
+                        renderStats.drawCommands, renderStats.textureBinds, int(this->renderQueue->size()));
+            ImGui::Text("Mesh pools: %d meshes, %.1f of %.1f MB used",
+                        int(this->modelMeshes->meshCount() + this->objectMeshes->meshCount()),
+                        (this->modelMeshes->usedBytes() + this->objectMeshes->usedBytes()) / (1024.0f * 1024.0f),
+                        (this->modelMeshes->capacityBytes() + this->objectMeshes->capacityBytes()) /
+                            (1024.0f * 1024.0f));
+            ImGui::Text("Uniform uploads: %.1f KB/frame", renderStats.uniformBytes / 1024.0f);
+            ImGui::Text("Streamed: %.1f KB/frame with %s, %d stalls", renderStats.streamBytes / 1024.0f,
+                        this->streamBuffer->isPersistent() ? "persistent mapping" : "orphaning",
+                        int(this->streamBuffer->stallCount()));
+            ImGui::Text("State changes: %u issued, %u elided", renderStats.stateChanges,
+                        renderStats.elidedStateChanges);
+            ImGui::SliderInt("Fleet Size", &this->fleetSize, 0, 100000);
+            ImGui::Checkbox("Instancing", &this->instancing);
+            ImGui::Text("Instances: %u, CPU frame time: %.2f ms, GPU frame time: %.2f ms", renderStats.drawnInstances,
+                        this->cpuFrameTime, this->gpuFrameTime);
+            if (this->spaceShip && this->terrain) {
+                ImGui::Text("Vertex memory: space ship %.1f KB (%s), terrain %.1f MB",
+                            this->spaceShip->vertexBytes() / 1024.0f,
+                            vertexFormatName(this->spaceShip->vertexFormat()),
+                            this->terrain->residentBytes() / (1024.0f * 1024.0f));
+            }
+            ImGui::Text("Assets loading: %d", int(this->assetLoader->pendingCount()));
+            ImGui::Text("Textures: %d, %.1f of %.0f MB resident, %d levels queued, %d missing",
+                        int(this->textureManager->textureCount()),
+                        this->textureManager->residentBytes() / (1024.0f * 1024.0f),
+                        this->textureManager->budget() / (1024.0f * 1024.0f), int(this->textureManager->queueDepth()),
+                        int(this->textureManager->missingLevels()));
+            if (this->spaceShipTexture->isResident()) {
+                ImGui::Text("Space ship texture: level %d of %d resident, %.1f MB",
+                            this->spaceShipTexture->residentLevel(), this->spaceShipTexture->levelCount(),
+                            this->spaceShipTexture->residentBytes() / (1024.0f * 1024.0f));
+            }
+
+            drawProfilerPanel(profiler);
 
             ImGui::Render();
             ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+            // the GUI renderer binds its own program, VAO and texture
+            renderState.invalidate();
+        }
+
+        this->gpuTimer->end();
+        std::chrono::duration<float, std::milli> frameDuration = std::chrono::steady_clock::now() - frameStart;
+        this->cpuFrameTime += (frameDuration.count() - this->cpuFrameTime) * 0.05f;
+        std::vector<double> gpuTimes = this->gpuTimer->collect();
+        for (double gpuTime : gpuTimes) {
+            this->gpuFrameTime += (float(gpuTime) - this->gpuFrameTime) * 0.05f;
         }
 
-        glfwPollEvents();
-        glfwSwapBuffers(window);
+        if (this->headless) {
+            glFlush();
+            if (this->loadedFrames >= HEADLESS_WARMUP_FRAMES) {
+                this->frameReport.addCpuTime(frameDuration.count());
+                this->frameReport.addGpuTimes(gpuTimes);
+                if (occlusion) {
+                    this->occlusionMicroseconds += this->occlusionCuller->microseconds();
+                }
+                this->occludedObjects += renderStats.occludedObjects;
+            }
+            if (this->loadedFrames >= 0) {
+                this->loadedFrames++;
+            } else if (this->assetLoader->pendingCount() == 0) {
+                this->loadedFrames = 0;
+            }
+            if (this->loadedFrames == HEADLESS_WARMUP_FRAMES) {
+                // the next frame is the first one measured, the GPU times of the warm up are dropped
+                this->gpuTimer->collect(true);
+                if (!this->tracePath.empty()) {
+                    profiler.startCapture(size_t(this->headlessFrames), this->tracePath);
+                }
+            }
+        } else {
+            glfwPollEvents();
+            glfwSwapBuffers(window);
+        }
+
+        this->assetLoader->markFirstFrame();
+        if (!this->timelinePrinted && this->assetLoader->pendingCount() == 0) {
+            this->assetLoader->printTimeline(stdout);
+            this->timelinePrinted = true;
+        }
     }
 
-    glfwTerminate();
+    // the textures and queries have to be deleted while the context is still there, the profiler gets the scopes of
+    // the last frames first
+    this->textureManager.reset();
+    profiler.beginFrame();
+    gpuProfiler.release();
+    profiler.finishCapture();
+    if (this->headless) {
+        // the last frame lasts until the GPU finished it
+        this->frameReport.addGpuTimes(this->gpuTimer->collect(true));
+        this->frameReport.addFrameTime(
+            std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - previousFrameStart).count());
+        this->printHeadlessReport();
+    }
+    this->gpuTimer.reset();
+    if (!this->headless) {
+        glfwTerminate();
+    }
+}
+
+bool Program::isRunning() const {
+    if (this->headless) {
+        return this->loadedFrames < HEADLESS_WARMUP_FRAMES + this->headlessFrames;
+    }
+    return !glfwWindowShouldClose(this->window);
+}
+
+void Program::flyScriptedPath(float time) {
+    // a slow turn of about 18 s per circle with some banking, so the fleet and the terrain keep moving through the view
+    glm::quat yaw = glm::angleAxis(glm::radians(20.0f) * time, glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::quat roll = glm::angleAxis(glm::radians(15.0f) * std::sin(0.7f * time), glm::vec3(0.0f, 0.0f, 1.0f));
+    this->spaceShipRotation = yaw * roll;
+    this->speed = 1.0f;
+}
+
+void Program::printHeadlessReport() const {
+    print("Headless run at {}x{} on {}\n", this->headless->width(), this->headless->height(),
+          this->headless->renderer());
+    print("{} ships in the fleet, measured after the assets were loaded and {} warm up frames\n", this->fleetSize,
+          HEADLESS_WARMUP_FRAMES);
+    this->frameReport.print(stdout);
+    if (this->occlusionCulling && this->frameReport.frameCount() > 0) {
+        double frames = double(this->frameReport.frameCount());
+        print("Occlusion culling: {:.1f} us and {:.1f} objects occluded per frame\n",
+              this->occlusionMicroseconds / frames, this->occludedObjects / frames);
+    }
 }
 
 void Program::handleInput() {
@@ -9,54 +9,140 @@
 #include <glm/gtx/quaternion.hpp>
 
 #include <memory>
-
+#include <string>
+
+#include "asset_loader.h"
+#include "debug_draw.h"
+#include "fleet.h"
+#include "frame_timing.h"
+#include "headless_context.h"
+#include "mesh_pool.h"
 #include "model.h"
 #include "object.h"
+#include "occlusion_culler.h"
+#include "program_cache.h"
+#include "render_queue.h"
 #include "shader_program.h"
-#include "texture.h"
+#include "stream_buffer.h"
+#include "terrain.h"
+#include "texture_manager.h"
+#include "thread_pool.h"
+#include "uniform_buffer.h"
+#include "vertex_format.h"
+
+struct ProgramOptions {
+    // ships of the benchmark fleet flying next to the player
+    int fleetSize = 0;
+    // layout of the model vertices on the GPU
+    VertexFormat vertexFormat = VertexFormat::Snorm16;
+    // GPU memory for the mip levels of all textures
+    size_t textureBudget = size_t(256) * 1024 * 1024;
+    // renders this many frames along a scripted flight into an offscreen framebuffer without a window, prints a frame
+    // time report and exits. 0 opens a window.
+    int headlessFrames = 0;
+    // Chrome trace of the profiler scopes of the measured frames of a headless run
+    std::string tracePath;
+    // culls objects hidden behind the terrain on the CPU
+    bool occlusionCulling = true;
+};
 
 class Program {
 public:
-    void init();
+    void init(const ProgramOptions& options = ProgramOptions());
     void mainLoop();
 
 private:
     // methods
     void initGlfw();
+    void initHeadless();
     void initGlew();
     void initOpenGL();
     void initGui();
-    void loadModel();
+    // builds the shader programs needed from the first frame at once, from the program cache where possible
+    void initShaders();
+    void loadModel(VertexFormat vertexFormat);
+    void initFleet(int size);
     void initLight();
     void initHeightMap();
+    void initUniformBuffers();
     void initCamera();
 
     void handleInput();
+    // flies the space ship along a fixed path for headless runs, time in seconds since the assets were loaded
+    void flyScriptedPath(float time);
+    bool isRunning() const;
+    void printHeadlessReport() const;
 
     void mouseCursorPositionCallback(double xPosition, double yPosition);
     void mouseScrollCallback(double xOffset, double yOffset);
 
     // members
     GLFWwindow* window = nullptr;
+    // instead of the window in headless runs
+    std::unique_ptr<HeadlessContext> headless;
+    int headlessFrames = 0;
+    std::string tracePath;
+    // frames drawn since the assets were loaded, the first HEADLESS_WARMUP_FRAMES are not measured
+    int loadedFrames = -1;
+    FrameReport frameReport;
+    // occlusion culling time and occluded objects summed over the measured frames
+    double occlusionMicroseconds = 0.0;
+    unsigned long occludedObjects = 0;
+    std::unique_ptr<GpuFrameTimer> gpuTimer;
+
+    std::unique_ptr<ThreadPool> threadPool;
+    std::unique_ptr<AssetLoader> assetLoader;
+    std::unique_ptr<TextureManager> textureManager;
+    bool timelinePrinted = false;
 
     glm::mat4 projectionMatrix = glm::mat4(1.0f);
-
-    // spaceship
+    std::unique_ptr<UniformBuffer> frameUniformBuffer;
+    // object blocks, instance transforms and debug lines of the frame
+    std::unique_ptr<StreamBuffer> streamBuffer;
+    std::unique_ptr<UniformRingBuffer> objectUniformBuffer;
+    std::unique_ptr<RenderQueue> renderQueue;
+    // instanced packets of the same state are drawn with one multi draw if the driver supports it
+    bool multiDraw = true;
+
+    // vertices and indices of the models in the vertex format of the run and of the objects
+    std::unique_ptr<MeshPool> modelMeshes;
+    std::unique_ptr<MeshPool> objectMeshes;
+
+    std::unique_ptr<ProgramCache> programCache;
+    // permutations of the model shaders
+    std::unique_ptr<ProgramVariants> modelPrograms;
+
+    // spaceship and fleet, null until it is loaded
     std::shared_ptr<ShaderProgram> spaceShipShaderProgram;
     std::shared_ptr<Model> spaceShip;
+    TextureHandle spaceShipTexture;
 
     glm::quat spaceShipRotation = glm::quat();
     glm::vec3 spaceShipPosition = glm::vec3();
 
+    // benchmark fleet, created once the space ship is loaded
+    std::unique_ptr<Fleet> fleet;
+    int fleetSize = 0;
+    bool instancing = true;
+
     // light
     std::shared_ptr<ShaderProgram> lightShaderProgram;
     std::shared_ptr<Object> light;
 
     // heightmap
     std::shared_ptr<ShaderProgram> heightMapShaderProgram;
-    std::shared_ptr<Object> heightMap;
+    // null until the heightmap is loaded
+    std::shared_ptr<Terrain> terrain;
+    TerrainSettings terrainSettings;
+
+    // the drawn terrain chunks occlude the ship, the fleet, the light and the other chunks
+    std::unique_ptr<OcclusionCuller> occlusionCuller;
+    bool occlusionCulling = true;
 
     bool drawGui = false;
+    // bounding boxes of the ship, the light, the visible ships of the fleet and the drawn terrain chunks
+    std::unique_ptr<DebugDraw> debugDraw;
+    bool drawBounds = false;
 
     // movement
     float speed = 0;
@@ -64,6 +150,9 @@ private:
     // timing
     float lastFrame = 0.0f;
     float deltaTime = 0.0f;
+    // time spent on the CPU per frame without waiting for the swap, smoothed over the last frames
+    float cpuFrameTime = 0.0f;
+    float gpuFrameTime = 0.0f;
 
     // camera
     glm::vec3 cameraFront = glm::vec3(0.0f, 0.0f, -1.0f);
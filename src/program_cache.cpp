@@ -0,0 +1,229 @@
+#include "program_cache.h"
+
+#include "hash.h"
+#include "mapped_file.h"
+#include "profiler.h"
+#include "source_stamp.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <ostream>
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+#include <fmt/format.h>
+using namespace fmt;
+
+static const char PROGRAM_CACHE_MAGIC[4] = {'O', 'P', 'R', 'G'};
+
+// returns false if the directory does not exist and could not be created
+static bool makeDirectory(const std::string& path) {
+#ifdef _WIN32
+    int result = _mkdir(path.c_str());
+#else
+    int result = mkdir(path.c_str(), 0755);
+#endif
+    return result == 0 || errno == EEXIST;
+}
+
+static std::string glString(GLenum name) {
+    const GLubyte* string = glGetString(name);
+    return string ? reinterpret_cast<const char*>(string) : "";
+}
+
+// hashes the size first so the concatenation of the parts is unambiguous
+static uint64_t hashPart(const void* data, size_t size, uint64_t hash) {
+    uint64_t length = size;
+    hash = hashBytes(&length, sizeof(length), hash);
+    return hashBytes(data, size, hash);
+}
+
+static uint64_t hashPart(const std::string& part, uint64_t hash) {
+    return hashPart(part.data(), part.size(), hash);
+}
+
+ProgramCache::ProgramCache(const std::string& directory) : directory(directory) {
+    this->driver = glString(GL_VENDOR) + "\n" + glString(GL_RENDERER) + "\n" + glString(GL_VERSION);
+    GLint formatCount = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+    this->binariesSupported = formatCount > 0;
+#ifdef GL_ARB_parallel_shader_compile
+    if (GLEW_ARB_parallel_shader_compile) {
+        // as many compiler threads as the driver likes
+        glMaxShaderCompilerThreadsARB(0xFFFFFFFF);
+    }
+#endif
+}
+
+std::vector<std::shared_ptr<ShaderProgram>> ProgramCache::build(const std::vector<ProgramDescription>& descriptions) {
+    auto start = std::chrono::steady_clock::now();
+    struct Compilation {
+        size_t index;
+        uint64_t key;
+        Shader vertexShader;
+        Shader fragmentShader;
+        std::string vertexName;
+        std::string fragmentName;
+    };
+
+    std::vector<std::shared_ptr<ShaderProgram>> programs;
+    std::vector<Compilation> compilations;
+    // programs which are compiling, they only become visible to later calls once they linked
+    std::unordered_map<uint64_t, std::shared_ptr<ShaderProgram>> pendingPrograms;
+    for (size_t i = 0; i < descriptions.size(); i++) {
+        const ProgramDescription& description = descriptions[i];
+        ShaderSource vertexSource = Shader::preprocess(description.vertexPath, description.defines);
+        ShaderSource fragmentSource = Shader::preprocess(description.fragmentPath, description.defines);
+
+        uint64_t key = hashPart(&PROGRAM_CACHE_VERSION, sizeof(PROGRAM_CACHE_VERSION), FNV_OFFSET_BASIS);
+        key = hashPart(this->driver, key);
+        key = hashPart(vertexSource.text, key);
+        key = hashPart(fragmentSource.text, key);
+        for (const auto& attribute : description.attributeLocations) {
+            key = hashPart(attribute.first, key);
+            key = hashPart(&attribute.second, sizeof(attribute.second), key);
+        }
+        for (const auto& block : description.uniformBlockBindings) {
+            key = hashPart(block.first, key);
+            key = hashPart(&block.second, sizeof(block.second), key);
+        }
+
+        // built by an earlier call, or earlier in this one
+        auto built = this->programs.find(key);
+        if (built != this->programs.end()) {
+            programs.push_back(built->second);
+            continue;
+        }
+        auto pending = pendingPrograms.find(key);
+        if (pending != pendingPrograms.end()) {
+            programs.push_back(pending->second);
+            continue;
+        }
+        programs.push_back(std::make_shared<ShaderProgram>());
+        ShaderProgram& program = *programs.back();
+        if (this->binariesSupported && this->loadBinary(program, key)) {
+            for (const auto& block : description.uniformBlockBindings) {
+                program.setUniformBlockBinding(block.first, block.second);
+            }
+            this->programs[key] = programs.back();
+            this->cached++;
+            continue;
+        }
+        pendingPrograms[key] = programs.back();
+        // a program whose binary was rejected can still be linked from source
+        compilations.push_back(Compilation{i, key, Shader::compile(vertexSource.text, Shader::Type::Vertex),
+                                           Shader::compile(fragmentSource.text, Shader::Type::Fragment),
+                                           vertexSource.name(), fragmentSource.name()});
+        program.attachShader(compilations.back().vertexShader);
+        program.attachShader(compilations.back().fragmentShader);
+        for (const auto& attribute : description.attributeLocations) {
+            program.setAttribLocation(attribute.first, attribute.second);
+        }
+        if (this->binariesSupported) {
+            glProgramParameteri(program.id(), GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        }
+        program.startLink();
+    }
+
+    // the first status query waits for the compilation of that program only, the others keep compiling meanwhile
+    for (auto& compilation : compilations) {
+        ShaderProgram& program = *programs[compilation.index];
+        compilation.vertexShader.checkCompileStatus(compilation.vertexName);
+        compilation.fragmentShader.checkCompileStatus(compilation.fragmentName);
+        program.finishLink();
+        for (const auto& block : descriptions[compilation.index].uniformBlockBindings) {
+            program.setUniformBlockBinding(block.first, block.second);
+        }
+        this->programs[compilation.key] = programs[compilation.index];
+        this->compiled++;
+        if (this->binariesSupported) {
+            this->storeBinary(program, compilation.key);
+        }
+    }
+
+    this->buildMilliseconds +=
+        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return programs;
+}
+
+std::string ProgramCache::pathFor(uint64_t key) const {
+    return format("{}/{:016x}.program", this->directory, key);
+}
+
+bool ProgramCache::loadBinary(ShaderProgram& program, uint64_t key) {
+    std::string path = this->pathFor(key);
+    SourceStamp stamp;
+    if (!stampSource(path, stamp) || stamp.size < sizeof(ProgramCacheHeader)) {
+        return false;
+    }
+    MappedFile file = MappedFile::open(path);
+    const ProgramCacheHeader* header = reinterpret_cast<const ProgramCacheHeader*>(file.data());
+    if (memcmp(header->magic, PROGRAM_CACHE_MAGIC, sizeof(PROGRAM_CACHE_MAGIC)) != 0 ||
+        header->version != PROGRAM_CACHE_VERSION || header->key != key ||
+        sizeof(ProgramCacheHeader) + uint64_t(header->binarySize) > file.size()) {
+        return false;
+    }
+    if (!program.loadBinary(header->binaryFormat, file.data() + sizeof(ProgramCacheHeader), header->binarySize)) {
+        // usually a driver update which kept the version string, the binary is replaced after compiling
+        this->rejected++;
+        return false;
+    }
+    return true;
+}
+
+void ProgramCache::storeBinary(const ShaderProgram& program, uint64_t key) {
+    GLenum binaryFormat = 0;
+    std::vector<char> binary = program.binary(binaryFormat);
+    if (binary.empty()) {
+        return;
+    }
+
+    ProgramCacheHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, PROGRAM_CACHE_MAGIC, sizeof(PROGRAM_CACHE_MAGIC));
+    header.version = PROGRAM_CACHE_VERSION;
+    header.key = key;
+    header.binaryFormat = binaryFormat;
+    header.binarySize = static_cast<uint32_t>(binary.size());
+
+    // not being able to store a binary only costs startup time on the next run
+    std::string path = this->pathFor(key);
+    if (!makeDirectory(this->directory)) {
+        print(stderr, "Warning: failed to create the program cache directory {}\n", this->directory);
+        return;
+    }
+    bool written = writeCookedFile(path, [&](std::ostream& out) {
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(binary.data(), std::streamsize(binary.size()));
+    });
+    if (!written) {
+        print(stderr, "Warning: failed to write program cache {}\n", path);
+    }
+}
+
+ProgramVariants::ProgramVariants(ProgramCache& cache, const ProgramDescription& description)
+    : cache(cache), description(description) {
+}
+
+std::shared_ptr<ShaderProgram> ProgramVariants::get(std::vector<std::string> defines) {
+    std::sort(defines.begin(), defines.end());
+    defines.erase(std::unique(defines.begin(), defines.end()), defines.end());
+    auto variant = this->variants.find(defines);
+    if (variant != this->variants.end()) {
+        return variant->second;
+    }
+
+    PROFILE_SCOPE("Build program variant");
+    ProgramDescription description = this->description;
+    description.defines.insert(description.defines.end(), defines.begin(), defines.end());
+    std::shared_ptr<ShaderProgram> program = this->cache.build({description}).front();
+    this->variants[defines] = program;
+    return program;
+}
@@ -0,0 +1,104 @@
+#ifndef PROGRAM_CACHE_H
+#define PROGRAM_CACHE_H
+
+#include "shader_program.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// bump whenever the layout of the header or the key changes
+const uint32_t PROGRAM_CACHE_VERSION = 2;
+
+struct ProgramCacheHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t key;
+    uint32_t binaryFormat;
+    uint32_t binarySize;
+};
+
+// everything a program is built from, the cache key is derived from all of it
+struct ProgramDescription {
+    std::string vertexPath;
+    std::string fragmentPath;
+    // "NAME" or "NAME value", defined right after the #version line of both shaders
+    std::vector<std::string> defines;
+    // bound before linking
+    std::vector<std::pair<std::string, unsigned int>> attributeLocations;
+    // set after linking or loading the binary, blocks the program does not use are skipped
+    std::vector<std::pair<std::string, unsigned int>> uniformBlockBindings;
+};
+
+// builds shader programs from the binaries glGetProgramBinary returned in an earlier run, one file per program in the
+// cache directory. The key hashes the preprocessed sources, so the included files and defines count, and the attribute
+// locations and uniform block bindings together with the vendor, renderer and version of the driver. Programs without a
+// binary, or whose binary the driver rejects, are compiled from source and their binary is stored for the next run.
+// Descriptions with the same key share one program for the lifetime of the cache. The context has to be current.
+class ProgramCache {
+public:
+    explicit ProgramCache(const std::string& directory);
+
+    // programs in the order of their descriptions. Every program is compiled before any result is checked, so drivers
+    // which compile on their own threads build them in parallel. Throws if a program fails to compile or link.
+    std::vector<std::shared_ptr<ShaderProgram>> build(const std::vector<ProgramDescription>& descriptions);
+
+    // totals of all calls to build
+    size_t cachedCount() const {
+        return this->cached;
+    }
+    size_t compiledCount() const {
+        return this->compiled;
+    }
+    // binaries the driver did not accept, they are compiled instead
+    size_t rejectedCount() const {
+        return this->rejected;
+    }
+    double milliseconds() const {
+        return this->buildMilliseconds;
+    }
+
+private:
+    std::string pathFor(uint64_t key) const;
+    bool loadBinary(ShaderProgram& program, uint64_t key);
+    void storeBinary(const ShaderProgram& program, uint64_t key);
+
+    std::string directory;
+    // every program built so far by its key
+    std::unordered_map<uint64_t, std::shared_ptr<ShaderProgram>> programs;
+    // vendor, renderer and version, a binary is only valid for the driver which created it
+    std::string driver;
+    bool binariesSupported = false;
+
+    size_t cached = 0;
+    size_t compiled = 0;
+    size_t rejected = 0;
+    double buildMilliseconds = 0.0;
+};
+
+// the permutations of one program, selected by defines in addition to those of its description. A permutation is only
+// built the first time it is asked for, so a feature like instancing costs no startup time until it is drawn. Defines
+// are sorted and repeats dropped, the same set in any order gives the same program.
+class ProgramVariants {
+public:
+    ProgramVariants(ProgramCache& cache, const ProgramDescription& description);
+
+    // builds the permutation on the first call, throws if it fails to compile or link
+    std::shared_ptr<ShaderProgram> get(std::vector<std::string> defines = std::vector<std::string>());
+    // permutations built so far
+    size_t size() const {
+        return this->variants.size();
+    }
+
+private:
+    ProgramCache& cache;
+    ProgramDescription description;
+    std::map<std::vector<std::string>, std::shared_ptr<ShaderProgram>> variants;
+};
+
+#endif // !PROGRAM_CACHE_H
@@ -0,0 +1,49 @@
+#ifndef RADIX_SORT_H
+#define RADIX_SORT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// stable least significant digit radix sort of items with a uint64_t member "key", one byte per pass. The histograms
+// of all passes are built in a single sweep and passes where every key has the same byte are skipped, so keys with
+// few distinct high bits sort in fewer passes. Returns items or scratch, whichever holds the sorted result.
+template <typename T>
+T* radixSort(T* items, T* scratch, size_t count) {
+    const int passes = sizeof(uint64_t);
+    size_t histograms[passes][256];
+    std::memset(histograms, 0, sizeof(histograms));
+    for (size_t i = 0; i < count; i++) {
+        uint64_t key = items[i].key;
+        for (int pass = 0; pass < passes; pass++) {
+            histograms[pass][(key >> (pass * 8)) & 0xFF]++;
+        }
+    }
+
+    T* source = items;
+    T* destination = scratch;
+    for (int pass = 0; pass < passes; pass++) {
+        size_t* histogram = histograms[pass];
+        if (count == 0 || histogram[(source[0].key >> (pass * 8)) & 0xFF] == count) {
+            continue;
+        }
+
+        // bucket sizes to bucket offsets
+        size_t offset = 0;
+        for (int bucket = 0; bucket < 256; bucket++) {
+            size_t size = histogram[bucket];
+            histogram[bucket] = offset;
+            offset += size;
+        }
+        for (size_t i = 0; i < count; i++) {
+            destination[histogram[(source[i].key >> (pass * 8)) & 0xFF]++] = source[i];
+        }
+
+        T* swap = source;
+        source = destination;
+        destination = swap;
+    }
+    return source;
+}
+
+#endif // !RADIX_SORT_H
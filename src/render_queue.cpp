@@ -0,0 +1,197 @@
+#include "render_queue.h"
+
+#include "gpu_profiler.h"
+#include "profiler.h"
+#include "radix_sort.h"
+#include "render_state.h"
+#include "render_stats.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include <glm/geometric.hpp>
+#include <glm/vec4.hpp>
+
+// layout of the commands read by glMultiDrawElementsIndirect
+struct DrawElementsIndirectCommand {
+    GLuint count;
+    GLuint instanceCount;
+    GLuint firstIndex;
+    GLint baseVertex;
+    GLuint baseInstance;
+};
+
+// coarse distance bits of the sort key, see renderKey
+const uint64_t COARSE_DISTANCE_MASK = uint64_t(0xFF) << 52;
+
+// packets which can be drawn by the same multi draw
+static bool sameState(const DrawPacket& a, const DrawPacket& b) {
+    return a.program == b.program && a.texture == b.texture && a.vertexArray == b.vertexArray && a.mode == b.mode &&
+           a.indexType == b.indexType && a.objectBlock == b.objectBlock && a.pass == b.pass;
+}
+
+bool RenderQueue::multiDrawSupported() {
+    return GLEW_ARB_multi_draw_indirect && GLEW_ARB_base_instance;
+}
+
+void RenderQueue::begin(glm::vec3 cameraPosition) {
+    this->arena.reset();
+    this->cameraPosition = cameraPosition;
+    this->pass = nullptr;
+    this->items = nullptr;
+    this->itemCount = 0;
+    this->itemCapacity = 0;
+    this->sorted = nullptr;
+    this->instances.clear();
+    this->instancedPackets = 0;
+}
+
+void RenderQueue::submit(const DrawPacket& packet, glm::vec3 position, unsigned int layer) {
+    if (this->itemCount == this->itemCapacity) {
+        // the old array is left in the arena, doubling keeps the waste below the final size
+        size_t capacity = std::max<size_t>(this->itemCapacity * 2, 1024);
+        Item* items = this->arena.allocate<Item>(capacity);
+        if (this->itemCount > 0) {
+            std::memcpy(items, this->items, sizeof(Item) * this->itemCount);
+        }
+        this->items = items;
+        this->itemCapacity = capacity;
+    }
+
+    DrawPacket* copy = this->arena.allocate<DrawPacket>();
+    *copy = packet;
+    copy->pass = this->pass;
+    float distance = glm::length(position - this->cameraPosition);
+    GLuint program = packet.program ? packet.program->id() : 0;
+    uint64_t key = renderKey(layer, distance, program, packet.texture);
+    if (packet.instanceCount > 0) {
+        key &= ~COARSE_DISTANCE_MASK;
+        this->instancedPackets++;
+    }
+    this->items[this->itemCount++] = Item{key, copy};
+}
+
+GLuint RenderQueue::pushInstances(const glm::mat4* transforms, size_t count) {
+    GLuint first = GLuint(this->instances.size());
+    this->instances.insert(this->instances.end(), transforms, transforms + count);
+    return first;
+}
+
+void RenderQueue::sort() {
+    PROFILE_SCOPE("Sort");
+    Item* scratch = this->arena.allocate<Item>(this->itemCount);
+    this->sorted = radixSort(this->items, scratch, this->itemCount);
+}
+
+void RenderQueue::execute(UniformRingBuffer& objects, StreamBuffer& stream) {
+    PROFILE_SCOPE("Execute");
+    const Item* items = this->sorted ? this->sorted : this->items;
+    bool multiDraw = this->multiDraw && multiDrawSupported();
+    bool baseInstance = GLEW_ARB_base_instance;
+
+    // all instance transforms in one allocation, so every vertex array has to point at them only once
+    StreamAllocation instances = StreamAllocation();
+    if (!this->instances.empty()) {
+        instances = stream.allocate(sizeof(glm::mat4) * this->instances.size(), sizeof(glm::mat4));
+        std::memcpy(instances.data, this->instances.data(), sizeof(glm::mat4) * this->instances.size());
+    }
+    // a command per instanced packet in the order they are drawn, so every run is a range of the commands
+    StreamAllocation commands = StreamAllocation();
+    if (multiDraw && this->instancedPackets > 0) {
+        commands = stream.allocate(sizeof(DrawElementsIndirectCommand) * this->instancedPackets, sizeof(GLuint));
+        DrawElementsIndirectCommand* command = reinterpret_cast<DrawElementsIndirectCommand*>(commands.data);
+        for (size_t i = 0; i < this->itemCount; i++) {
+            const DrawPacket& packet = *items[i].packet;
+            if (packet.instanceCount > 0) {
+                *command++ = DrawElementsIndirectCommand{GLuint(packet.indexCount), GLuint(packet.instanceCount),
+                                                         GLuint(packet.indexOffset), packet.baseVertex,
+                                                         packet.firstInstance};
+            }
+        }
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commands.buffer);
+    }
+    stream.flush();
+
+    const char* pass = nullptr;
+    bool profiling = false;
+    size_t commandIndex = 0;
+    this->instancedVertexArrays.clear();
+    for (size_t i = 0; i < this->itemCount;) {
+        const DrawPacket& packet = *items[i].packet;
+        if (packet.pass != pass) {
+            if (profiling) {
+                gpuProfiler.endScope();
+            }
+            pass = packet.pass;
+            profiling = pass && gpuProfiler.beginScope(pass);
+        }
+        packet.program->use();
+        if (packet.texture != 0) {
+            renderState.bindTexture(0, packet.texture);
+        }
+        renderState.bindVertexArray(packet.vertexArray);
+        if (packet.objectBlock != DrawPacket::NO_OBJECT_BLOCK) {
+            objects.bind(packet.objectBlock);
+        }
+
+        renderState.setPrimitiveRestart(packet.mode == GL_TRIANGLE_STRIP);
+
+        size_t indexSize = packet.indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t);
+        void* offset = (void*)(packet.indexOffset * indexSize);
+        if (packet.instanceCount == 0) {
+            glDrawElementsBaseVertex(packet.mode, packet.indexCount, packet.indexType, offset, packet.baseVertex);
+            renderStats.drawCalls++;
+            renderStats.drawCommands++;
+            i++;
+            continue;
+        }
+
+        // with base instances the attribute points at the first transform and the draws select theirs
+        if (baseInstance && std::find(this->instancedVertexArrays.begin(), this->instancedVertexArrays.end(),
+                                      packet.vertexArray) == this->instancedVertexArrays.end()) {
+            setInstanceAttributes(instances, 0);
+            this->instancedVertexArrays.push_back(packet.vertexArray);
+        }
+        if (multiDraw) {
+            size_t end = i + 1;
+            while (end < this->itemCount && items[end].packet->instanceCount > 0 &&
+                   sameState(packet, *items[end].packet)) {
+                end++;
+            }
+            glMultiDrawElementsIndirect(packet.mode, packet.indexType,
+                                        (void*)(commands.offset + sizeof(DrawElementsIndirectCommand) * commandIndex),
+                                        GLsizei(end - i), 0);
+            commandIndex += end - i;
+            renderStats.drawCalls++;
+            renderStats.drawCommands += unsigned(end - i);
+            i = end;
+            continue;
+        }
+        if (baseInstance) {
+            glDrawElementsInstancedBaseVertexBaseInstance(packet.mode, packet.indexCount, packet.indexType, offset,
+                                                          packet.instanceCount, packet.baseVertex,
+                                                          packet.firstInstance);
+        } else {
+            setInstanceAttributes(instances, packet.firstInstance);
+            glDrawElementsInstancedBaseVertex(packet.mode, packet.indexCount, packet.indexType, offset,
+                                              packet.instanceCount, packet.baseVertex);
+        }
+        renderStats.drawCalls++;
+        renderStats.drawCommands++;
+        i++;
+    }
+    if (profiling) {
+        gpuProfiler.endScope();
+    }
+}
+
+void RenderQueue::setInstanceAttributes(const StreamAllocation& instances, GLuint firstInstance) {
+    glBindBuffer(GL_ARRAY_BUFFER, instances.buffer);
+    size_t offset = instances.offset + sizeof(glm::mat4) * firstInstance;
+    for (GLuint column = 0; column < 4; column++) {
+        glEnableVertexAttribArray(INSTANCE_MODEL_LOCATION + column);
+        glVertexAttribPointer(INSTANCE_MODEL_LOCATION + column, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4),
+                              (void*)(offset + sizeof(glm::vec4) * column));
+        glVertexAttribDivisor(INSTANCE_MODEL_LOCATION + column, 1);
+    }
+}
@@ -0,0 +1,129 @@
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+#include "frame_arena.h"
+#include "shader_program.h"
+#include "stream_buffer.h"
+#include "uniform_buffer.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include <GL/glew.h>
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+
+// first of the four attribute locations of the instance_model matrix, which instanced packets read from the instance
+// transforms of the queue
+const GLuint INSTANCE_MODEL_LOCATION = 3;
+
+// everything needed to issue one indexed draw call
+struct DrawPacket {
+    // no block is bound for packets whose program does not read the Object block
+    static const size_t NO_OBJECT_BLOCK = ~size_t(0);
+
+    ShaderProgram* program = nullptr;
+    // 2D texture bound to unit 0, 0 for none
+    GLuint texture = 0;
+    GLuint vertexArray = 0;
+    // strips are drawn with primitive restart enabled
+    GLenum mode = GL_TRIANGLES;
+    // GL_UNSIGNED_INT or GL_UNSIGNED_SHORT
+    GLenum indexType = GL_UNSIGNED_INT;
+    // in indices of indexType
+    size_t indexOffset = 0;
+    GLsizei indexCount = 0;
+    // added to every index, e.g. the first vertex of a mesh in a mesh pool
+    GLint baseVertex = 0;
+    // 0 draws without instancing
+    GLsizei instanceCount = 0;
+    // index of the model matrix of the first instance in the transforms pushed to the queue
+    GLuint firstInstance = 0;
+    // block in the object uniform ring buffer, holds the model matrix
+    size_t objectBlock = NO_OBJECT_BLOCK;
+    // set by the queue, see RenderQueue::setPass
+    const char* pass = nullptr;
+};
+
+// sort key, from the most significant bit:
+//  4 bits layer, lower layers are drawn first
+//  8 bits coarse distance to the camera, logarithmic so nearby objects are drawn first
+// 10 bits program
+// 18 bits texture
+// 24 bits fine distance to the camera
+// Within a distance bucket packets are grouped by program and texture, across buckets they are drawn front to back,
+// which lets the depth test reject hidden fragments of e.g. the terrain behind the ship.
+inline uint64_t renderKey(unsigned int layer, float distance, GLuint program, GLuint texture) {
+    distance = distance > 0.0f ? distance : 0.0f;
+    // non negative floats sort like their bit patterns
+    uint32_t bits;
+    static_assert(sizeof(bits) == sizeof(distance), "float has to be 32 bits");
+    std::memcpy(&bits, &distance, sizeof(bits));
+    // exponent and top two mantissa bits, four buckets per doubling of the distance starting at 1
+    uint64_t coarse = bits >> 21;
+    coarse = coarse > 0x1FC + 0xFF ? 0xFF : (coarse > 0x1FC ? coarse - 0x1FC : 0);
+    return (uint64_t(layer & 0xF) << 60) | (coarse << 52) | (uint64_t(program & 0x3FF) << 42) |
+           (uint64_t(texture & 0x3FFFF) << 24) | uint64_t(bits >> 8);
+}
+
+// draw packets collected during a frame, sorted by their key and then executed in order. Instanced packets leave the
+// coarse distance out of their key, so the packets of one program and texture end up next to each other, still front
+// to back. Runs of them which share all state but the indices and instances are drawn with one
+// glMultiDrawElementsIndirect, with a command per packet, or one draw call per packet without the extension.
+class RenderQueue {
+public:
+    // GL_ARB_multi_draw_indirect and GL_ARB_base_instance, which makes the multi draw honor firstInstance
+    static bool multiDrawSupported();
+
+    // camera position in world space, the packet distances are measured from it
+    void begin(glm::vec3 cameraPosition);
+    // position is the center of the packet in world space
+    void submit(const DrawPacket& packet, glm::vec3 position, unsigned int layer = 0);
+    // model matrices for instanced packets, returns the index of the first one
+    GLuint pushInstances(const glm::mat4* transforms, size_t count);
+    // name of the pass submitting the following packets. Sorting interleaves the passes, execute measures the GPU time
+    // of each run of packets of one pass so the profiler still shows the time per pass.
+    void setPass(const char* name) {
+        this->pass = name;
+    }
+    void sort();
+    // false draws every packet with its own call even if multi draws are supported, e.g. to compare the two
+    void setMultiDraw(bool enabled) {
+        this->multiDraw = enabled;
+    }
+    // binds the object block of every packet from objects, which has to be flushed already. The instance transforms
+    // and the indirect commands are written to stream.
+    void execute(UniformRingBuffer& objects, StreamBuffer& stream);
+
+    size_t size() const {
+        return this->itemCount;
+    }
+
+private:
+    struct Item {
+        uint64_t key;
+        const DrawPacket* packet;
+    };
+
+    // points the instance_model attribute of the bound vertex array at the instance transforms from firstInstance on
+    static void setInstanceAttributes(const StreamAllocation& instances, GLuint firstInstance);
+
+    FrameArena arena;
+    glm::vec3 cameraPosition = glm::vec3();
+    const char* pass = nullptr;
+    bool multiDraw = true;
+    std::vector<glm::mat4> instances;
+    size_t instancedPackets = 0;
+    // vertex arrays pointed at the instance transforms during execute
+    std::vector<GLuint> instancedVertexArrays;
+    // grow in the arena, sorted holds the result of sort
+    Item* items = nullptr;
+    size_t itemCount = 0;
+    size_t itemCapacity = 0;
+    Item* sorted = nullptr;
+};
+
+#endif // !RENDER_QUEUE_H
@@ -0,0 +1,113 @@
+#include "render_state.h"
+
+#include "render_stats.h"
+
+RenderState renderState;
+
+RenderState::RenderState() {
+    this->invalidate();
+}
+
+bool RenderState::change(GLuint& cached, GLuint value) {
+    if (cached == value) {
+        renderStats.elidedStateChanges++;
+        return false;
+    }
+    cached = value;
+    renderStats.stateChanges++;
+    return true;
+}
+
+void RenderState::useProgram(GLuint program) {
+    if (this->change(this->program, program)) {
+        glUseProgram(program);
+    }
+}
+
+void RenderState::bindVertexArray(GLuint vertexArray) {
+    if (this->change(this->vertexArray, vertexArray)) {
+        glBindVertexArray(vertexArray);
+    }
+}
+
+void RenderState::bindTexture(unsigned int unit, GLuint texture) {
+    if (!this->change(this->textures[unit], texture)) {
+        return;
+    }
+    // switching the active unit is part of the bind, it is not counted on its own
+    if (this->activeUnit != unit) {
+        glActiveTexture(GL_TEXTURE0 + unit);
+        this->activeUnit = unit;
+    }
+    glBindTexture(GL_TEXTURE_2D, texture);
+    renderStats.textureBinds++;
+}
+
+void RenderState::setDepthTest(bool enabled) {
+    if (this->change(this->depthTest, enabled ? GL_TRUE : GL_FALSE)) {
+        if (enabled) {
+            glEnable(GL_DEPTH_TEST);
+        } else {
+            glDisable(GL_DEPTH_TEST);
+        }
+    }
+}
+
+void RenderState::setDepthFunction(GLenum function) {
+    if (this->change(this->depthFunction, function)) {
+        glDepthFunc(function);
+    }
+}
+
+void RenderState::setPolygonMode(GLenum mode) {
+    if (this->change(this->polygonMode, mode)) {
+        glPolygonMode(GL_FRONT_AND_BACK, mode);
+    }
+}
+
+void RenderState::setPrimitiveRestart(bool enabled) {
+    if (this->change(this->primitiveRestart, enabled ? GL_TRUE : GL_FALSE)) {
+        if (enabled) {
+            glEnable(GL_PRIMITIVE_RESTART);
+        } else {
+            glDisable(GL_PRIMITIVE_RESTART);
+        }
+    }
+}
+
+void RenderState::deleteVertexArray(GLuint vertexArray) {
+    glDeleteVertexArrays(1, &vertexArray);
+    if (this->vertexArray == vertexArray) {
+        this->vertexArray = 0;
+    }
+}
+
+void RenderState::deleteTexture(GLuint texture) {
+    glDeleteTextures(1, &texture);
+    for (auto& bound : this->textures) {
+        if (bound == texture) {
+            bound = 0;
+        }
+    }
+}
+
+void RenderState::deleteProgram(GLuint program) {
+    glDeleteProgram(program);
+    // a program in use is only flagged for deletion and stays current
+    if (this->program == program) {
+        this->program = UNKNOWN;
+    }
+}
+
+void RenderState::invalidate() {
+    this->program = UNKNOWN;
+    this->vertexArray = UNKNOWN;
+    this->activeUnit = UNKNOWN;
+    for (auto& texture : this->textures) {
+        texture = UNKNOWN;
+    }
+    this->depthTest = UNKNOWN;
+    this->depthFunction = UNKNOWN;
+    this->polygonMode = UNKNOWN;
+    this->primitiveRestart = UNKNOWN;
+}
@@ -0,0 +1,55 @@
+#ifndef RENDER_STATE_H
+#define RENDER_STATE_H
+
+#include <GL/glew.h>
+
+// separates the strips of an index buffer while GL_PRIMITIVE_RESTART is enabled, set once at startup. Fits into 16 bit
+// indices, so 32 bit index buffers must not reference vertex 0xFFFF while restart is enabled.
+const GLuint PRIMITIVE_RESTART_INDEX = 0xFFFF;
+
+// shadows the bound GL objects and fixed function state so redundant calls are skipped. All state changes on the
+// render thread have to go through it, otherwise invalidate has to be called afterwards.
+class RenderState {
+public:
+    static const unsigned int TEXTURE_UNITS = 16;
+
+    RenderState();
+
+    void useProgram(GLuint program);
+    void bindVertexArray(GLuint vertexArray);
+    // binds a GL_TEXTURE_2D texture
+    void bindTexture(unsigned int unit, GLuint texture);
+    void setDepthTest(bool enabled);
+    void setDepthFunction(GLenum function);
+    // GL_FILL or GL_LINE for front and back faces
+    void setPolygonMode(GLenum mode);
+    void setPrimitiveRestart(bool enabled);
+
+    // GL unbinds deleted objects and may hand out their names again, so the cache has to forget them
+    void deleteVertexArray(GLuint vertexArray);
+    void deleteTexture(GLuint texture);
+    void deleteProgram(GLuint program);
+
+    // forgets everything, e.g. after the GUI renderer changed state behind the cache's back
+    void invalidate();
+
+private:
+    // GL object names are never ~0, so it marks state that has to be set on the next call
+    static const GLuint UNKNOWN = ~GLuint(0);
+
+    // counts an issued call, returns false if it can be elided
+    bool change(GLuint& cached, GLuint value);
+
+    GLuint program;
+    GLuint vertexArray;
+    GLuint activeUnit;
+    GLuint textures[TEXTURE_UNITS];
+    GLuint depthTest;
+    GLuint depthFunction;
+    GLuint polygonMode;
+    GLuint primitiveRestart;
+};
+
+extern RenderState renderState;
+
+#endif // !RENDER_STATE_H
@@ -0,0 +1,32 @@
+#ifndef RENDER_STATS_H
+#define RENDER_STATS_H
+
+// counters of the current frame, reset at the start of every frame
+struct RenderStats {
+    unsigned int drawnObjects = 0;
+    unsigned int culledObjects = 0;
+    // inside the frustum but hidden behind the occluders
+    unsigned int occludedObjects = 0;
+    unsigned int culledSubmeshes = 0;
+    unsigned int drawnInstances = 0;
+    // GL draw calls issued, a multi draw counts once
+    unsigned int drawCalls = 0;
+    // draws requested by the draw packets, one per packet
+    unsigned int drawCommands = 0;
+    unsigned int textureBinds = 0;
+    // GL state changes issued and skipped by the render state cache
+    unsigned int stateChanges = 0;
+    unsigned int elidedStateChanges = 0;
+    // bytes uploaded to uniform buffers
+    unsigned int uniformBytes = 0;
+    // bytes allocated from stream buffers, uniform blocks, instance transforms, GUI vertices and debug lines
+    unsigned int streamBytes = 0;
+
+    void reset() {
+        *this = RenderStats();
+    }
+};
+
+extern RenderStats renderStats;
+
+#endif // !RENDER_STATS_H
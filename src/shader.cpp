@@ -5,13 +5,126 @@
 #include <fmt/format.h>
 using namespace fmt;
 
+#include <algorithm>
 #include <fstream>
 #include <sstream>
 #include <stdexcept>
 #include <string>
 #include <vector>
 
-Shader Shader::loadFromFile(const std::string& path, Type shaderType) {
+// include directives nest at most this deep
+const int MAX_INCLUDE_DEPTH = 16;
+
+std::string ShaderSource::name() const {
+    if (this->files.size() < 2) {
+        return this->files.empty() ? std::string() : this->files.front();
+    }
+    std::string name = this->files.front() + " (";
+    for (size_t i = 1; i < this->files.size(); i++) {
+        name += format("{}{}: {}", i > 1 ? ", " : "", i, this->files[i]);
+    }
+    return name + ")";
+}
+
+Shader Shader::loadFromFile(const std::string& path, Type shaderType, const std::vector<std::string>& defines) {
+    ShaderSource source = Shader::preprocess(path, defines);
+    Shader shader = Shader::compile(source.text, shaderType);
+    shader.checkCompileStatus(source.name());
+    return shader;
+}
+
+std::string Shader::readSource(const std::string& path) {
+    std::ifstream in(path.c_str(), std::ios::in);
+    if (!in) {
+        throw std::runtime_error(format("Failed to read shader file {}", path));
+    }
+    return std::string((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+}
+
+static std::string directoryOf(const std::string& path) {
+    size_t separator = path.find_last_of("/\\");
+    return separator == std::string::npos ? std::string() : path.substr(0, separator + 1);
+}
+
+// the first word of a preprocessor directive, empty for other lines
+static std::string directiveOf(const std::string& line) {
+    size_t start = line.find_first_not_of(" \t");
+    if (start == std::string::npos || line[start] != '#') {
+        return std::string();
+    }
+    start = line.find_first_not_of(" \t", start + 1);
+    if (start == std::string::npos) {
+        return std::string();
+    }
+    size_t end = line.find_first_of(" \t\r", start);
+    return line.substr(start, end == std::string::npos ? std::string::npos : end - start);
+}
+
+// appends path to body with its includes expanded, source numbers are indices into source.files
+static void expandIncludes(const std::string& path, ShaderSource& source, std::string& body, std::string& version,
+                           std::vector<std::string>& includeStack) {
+    if (std::find(includeStack.begin(), includeStack.end(), path) != includeStack.end()) {
+        throw std::runtime_error(format("Shader file {} includes itself", path));
+    }
+    if (includeStack.size() >= size_t(MAX_INCLUDE_DEPTH)) {
+        throw std::runtime_error(format("Includes nested too deep in shader file {}", path));
+    }
+    // include once, every file declares its uniform blocks and functions only once
+    if (std::find(source.files.begin(), source.files.end(), path) != source.files.end()) {
+        return;
+    }
+    size_t number = source.files.size();
+    source.files.push_back(path);
+    includeStack.push_back(path);
+    if (number > 0) {
+        body += format("#line 1 {}\n", number);
+    }
+
+    std::istringstream in(Shader::readSource(path));
+    std::string line;
+    for (int lineNumber = 1; std::getline(in, line); lineNumber++) {
+        std::string directive = directiveOf(line);
+        if (directive == "version") {
+            if (number > 0 || !version.empty()) {
+                throw std::runtime_error(format("{}({}): #version in an included file", path, lineNumber));
+            }
+            // moved to the top together with the defines, an empty line keeps the line numbers
+            version = line;
+            body += "\n";
+        } else if (directive == "include") {
+            size_t open = line.find('"');
+            size_t close = open == std::string::npos ? open : line.find('"', open + 1);
+            if (close == std::string::npos) {
+                throw std::runtime_error(format("{}({}): expected #include \"file\"", path, lineNumber));
+            }
+            std::string includePath = directoryOf(path) + line.substr(open + 1, close - open - 1);
+            expandIncludes(includePath, source, body, version, includeStack);
+            body += format("#line {} {}\n", lineNumber + 1, number);
+        } else {
+            body += line;
+            body += '\n';
+        }
+    }
+    includeStack.pop_back();
+}
+
+ShaderSource Shader::preprocess(const std::string& path, const std::vector<std::string>& defines) {
+    ShaderSource source;
+    std::string body;
+    std::string version;
+    std::vector<std::string> includeStack;
+    expandIncludes(path, source, body, version, includeStack);
+
+    source.text = (version.empty() ? std::string(DEFAULT_SHADER_VERSION) : version) + "\n";
+    for (const auto& define : defines) {
+        source.text += "#define " + define + "\n";
+    }
+    source.text += "#line 1 0\n";
+    source.text += body;
+    return source;
+}
+
+Shader Shader::compile(const std::string& source, Type shaderType) {
     Shader shader;
     if (shaderType == Type::Fragment) {
         shader.handle = glCreateShader(GL_FRAGMENT_SHADER);
@@ -21,24 +134,20 @@ Shader Shader::loadFromFile(const std::string& path, Type shaderType) {
         throw std::runtime_error("Unknown shader type");
     }
 
-    std::ifstream in(path.c_str(), std::ios::in);
-    if (!in) {
-        throw std::runtime_error(format("Failed to read shader file {}", path));
-    }
-
-    std::string source((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
     const char* csource = source.c_str();
-
     glShaderSource(shader.handle, 1, &csource, nullptr);
     glCompileShader(shader.handle);
+    return shader;
+}
+
+void Shader::checkCompileStatus(const std::string& name) const {
     int params = -1;
-    glGetShaderiv(shader.handle, GL_COMPILE_STATUS, &params);
+    glGetShaderiv(this->handle, GL_COMPILE_STATUS, &params);
     if (params != GL_TRUE) {
         GLint logLength;
-        glGetShaderiv(shader.handle, GL_INFO_LOG_LENGTH, &logLength);
+        glGetShaderiv(this->handle, GL_INFO_LOG_LENGTH, &logLength);
         std::vector<char> error(logLength);
-        glGetShaderInfoLog(shader.handle, logLength, nullptr, &error[0]);
-        throw std::runtime_error(std::string(error.begin(), error.end()));
+        glGetShaderInfoLog(this->handle, logLength, nullptr, &error[0]);
+        throw std::runtime_error(format("{}: {}", name, std::string(error.begin(), error.end())));
     }
-    return shader;
 }
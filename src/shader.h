@@ -2,9 +2,20 @@
 #define SHADER_H
 
 #include <string>
+#include <vector>
 
 #include <GL/glew.h>
 
+// a shader after preprocessing
+struct ShaderSource {
+    std::string text;
+    // the shader and the files it includes, numbered as in the #line directives of text
+    std::vector<std::string> files;
+
+    // the shader followed by the numbers of the included files, compile errors name files by these numbers
+    std::string name() const;
+};
+
 class Shader {
     friend class ShaderProgram;
 
@@ -14,7 +25,21 @@ private:
 
 public:
     enum class Type { Vertex, Fragment };
-    static Shader loadFromFile(const std::string& path, Type shaderType);
+    static Shader loadFromFile(const std::string& path, Type shaderType,
+                               const std::vector<std::string>& defines = std::vector<std::string>());
+    static std::string readSource(const std::string& path);
+    // resolves #include "file" relative to the including file, every file is included once. Without a #version line
+    // DEFAULT_SHADER_VERSION is used, defines ("NAME" or "NAME value") follow the #version line. Throws if a file is
+    // missing or includes itself.
+    static ShaderSource preprocess(const std::string& path,
+                                   const std::vector<std::string>& defines = std::vector<std::string>());
+    // starts compiling source without waiting for the result, so the driver can compile several shaders in parallel
+    static Shader compile(const std::string& source, Type shaderType);
+    // waits for the compilation, throws with the info log prefixed by name if it failed
+    void checkCompileStatus(const std::string& name) const;
 };
 
+// for shaders without a #version line
+const char* const DEFAULT_SHADER_VERSION = "#version 410";
+
 #endif
@@ -1,11 +1,78 @@
 #include "shader_program.h"
 
+#include "render_state.h"
+
+#include <algorithm>
 #include <stdexcept>
 #include <string>
 #include <vector>
 
 #include <glm/gtc/type_ptr.hpp>
 
+#include <fmt/format.h>
+using namespace fmt;
+
+// reads the active uniforms or attributes of a linked program
+static std::vector<ShaderProgram::Variable> reflect(GLuint program, GLenum countQuery, GLenum lengthQuery,
+                                                    bool uniforms) {
+    GLint count = 0;
+    GLint maxLength = 0;
+    glGetProgramiv(program, countQuery, &count);
+    glGetProgramiv(program, lengthQuery, &maxLength);
+
+    std::vector<ShaderProgram::Variable> variables;
+    std::vector<char> name(std::max(maxLength, 1));
+    for (GLint i = 0; i < count; i++) {
+        ShaderProgram::Variable variable;
+        GLsizei length = 0;
+        if (uniforms) {
+            glGetActiveUniform(program, GLuint(i), GLsizei(name.size()), &length, &variable.size, &variable.type,
+                               name.data());
+        } else {
+            glGetActiveAttrib(program, GLuint(i), GLsizei(name.size()), &length, &variable.size, &variable.type,
+                              name.data());
+        }
+        variable.name.assign(name.data(), size_t(length));
+        // built in variables like gl_VertexID have no location
+        if (variable.name.compare(0, 3, "gl_") == 0) {
+            continue;
+        }
+        variable.location = uniforms ? glGetUniformLocation(program, variable.name.c_str())
+                                     : glGetAttribLocation(program, variable.name.c_str());
+        // arrays are reported as name[0], they are looked up by their plain name
+        size_t bracket = variable.name.find('[');
+        if (bracket != std::string::npos) {
+            variable.name.erase(bracket);
+        }
+        // members of uniform blocks have no location and are not set through the program
+        if (variable.location < 0) {
+            continue;
+        }
+        variable.hash = hashString(variable.name.c_str());
+        variables.push_back(variable);
+    }
+
+    std::sort(variables.begin(), variables.end(),
+              [](const ShaderProgram::Variable& a, const ShaderProgram::Variable& b) { return a.hash < b.hash; });
+    for (size_t i = 1; i < variables.size(); i++) {
+        if (variables[i].hash == variables[i - 1].hash) {
+            throw std::runtime_error(
+                format("Hash collision between {} and {}", variables[i - 1].name, variables[i].name));
+        }
+    }
+    return variables;
+}
+
+static const ShaderProgram::Variable* find(const std::vector<ShaderProgram::Variable>& variables, uint64_t hash) {
+    auto it = std::lower_bound(
+        variables.begin(), variables.end(), hash,
+        [](const ShaderProgram::Variable& variable, uint64_t hash) { return variable.hash < hash; });
+    if (it == variables.end() || it->hash != hash) {
+        return nullptr;
+    }
+    return &*it;
+}
+
 ShaderProgram::ShaderProgram() {
     this->handle = glCreateProgram();
 }
@@ -19,7 +86,15 @@ void ShaderProgram::setAttribLocation(const std::string& attribute, unsigned int
 }
 
 void ShaderProgram::link() {
+    this->startLink();
+    this->finishLink();
+}
+
+void ShaderProgram::startLink() {
     glLinkProgram(this->handle);
+}
+
+void ShaderProgram::finishLink() {
     int params = -1;
     glGetProgramiv(this->handle, GL_LINK_STATUS, &params);
     if (params != GL_TRUE) {
@@ -29,13 +104,129 @@ void ShaderProgram::link() {
         glGetProgramInfoLog(this->handle, logLength, nullptr, &error[0]);
         throw std::runtime_error(std::string(error.begin(), error.end()));
     }
+
+    this->activeUniforms = reflect(this->handle, GL_ACTIVE_UNIFORMS, GL_ACTIVE_UNIFORM_MAX_LENGTH, true);
+    this->activeAttributes = reflect(this->handle, GL_ACTIVE_ATTRIBUTES, GL_ACTIVE_ATTRIBUTE_MAX_LENGTH, false);
+}
+
+bool ShaderProgram::loadBinary(GLenum binaryFormat, const void* data, size_t size) {
+    glProgramBinary(this->handle, binaryFormat, data, GLsizei(size));
+    int params = -1;
+    glGetProgramiv(this->handle, GL_LINK_STATUS, &params);
+    if (params != GL_TRUE) {
+        return false;
+    }
+    this->activeUniforms = reflect(this->handle, GL_ACTIVE_UNIFORMS, GL_ACTIVE_UNIFORM_MAX_LENGTH, true);
+    this->activeAttributes = reflect(this->handle, GL_ACTIVE_ATTRIBUTES, GL_ACTIVE_ATTRIBUTE_MAX_LENGTH, false);
+    return true;
+}
+
+std::vector<char> ShaderProgram::binary(GLenum& binaryFormat) const {
+    GLint length = 0;
+    glGetProgramiv(this->handle, GL_PROGRAM_BINARY_LENGTH, &length);
+    std::vector<char> data(size_t(std::max(length, 0)));
+    if (length > 0) {
+        GLsizei written = 0;
+        glGetProgramBinary(this->handle, length, &written, &binaryFormat, data.data());
+        data.resize(size_t(written));
+    }
+    return data;
+}
+
+void ShaderProgram::setUniformBlockBinding(const std::string& block, GLuint binding) {
+    GLuint index = glGetUniformBlockIndex(this->handle, block.c_str());
+    if (index != GL_INVALID_INDEX) {
+        glUniformBlockBinding(this->handle, index, binding);
+    }
 }
 
 void ShaderProgram::use() {
-    glUseProgram(this->handle);
+    renderState.useProgram(this->handle);
+}
+
+GLint ShaderProgram::uniformLocation(UniformId uniform) const {
+    const Variable* variable = find(this->activeUniforms, uniform.hash);
+    return variable ? variable->location : -1;
+}
+
+GLint ShaderProgram::attributeLocation(const std::string& attribute) const {
+    const Variable* variable = find(this->activeAttributes, hashString(attribute.c_str()));
+    return variable ? variable->location : -1;
+}
+
+void ShaderProgram::setUniform(UniformId uniform, float data) {
+    glUniform1f(this->uniformLocation(uniform), data);
+}
+
+void ShaderProgram::setUniform(UniformId uniform, int data) {
+    glUniform1i(this->uniformLocation(uniform), data);
+}
+
+void ShaderProgram::setUniform(UniformId uniform, unsigned int data) {
+    glUniform1ui(this->uniformLocation(uniform), data);
+}
+
+void ShaderProgram::setUniform(UniformId uniform, bool data) {
+    glUniform1i(this->uniformLocation(uniform), data ? 1 : 0);
+}
+
+void ShaderProgram::setUniform(UniformId uniform, const glm::vec2& data) {
+    glUniform2fv(this->uniformLocation(uniform), 1, glm::value_ptr(data));
+}
+
+void ShaderProgram::setUniform(UniformId uniform, const glm::vec3& data) {
+    glUniform3fv(this->uniformLocation(uniform), 1, glm::value_ptr(data));
+}
+
+void ShaderProgram::setUniform(UniformId uniform, const glm::vec4& data) {
+    glUniform4fv(this->uniformLocation(uniform), 1, glm::value_ptr(data));
+}
+
+void ShaderProgram::setUniform(UniformId uniform, const glm::ivec2& data) {
+    glUniform2iv(this->uniformLocation(uniform), 1, glm::value_ptr(data));
+}
+
+void ShaderProgram::setUniform(UniformId uniform, const glm::ivec3& data) {
+    glUniform3iv(this->uniformLocation(uniform), 1, glm::value_ptr(data));
+}
+
+void ShaderProgram::setUniform(UniformId uniform, const glm::ivec4& data) {
+    glUniform4iv(this->uniformLocation(uniform), 1, glm::value_ptr(data));
+}
+
+void ShaderProgram::setUniform(UniformId uniform, const glm::uvec2& data) {
+    glUniform2uiv(this->uniformLocation(uniform), 1, glm::value_ptr(data));
+}
+
+void ShaderProgram::setUniform(UniformId uniform, const glm::uvec3& data) {
+    glUniform3uiv(this->uniformLocation(uniform), 1, glm::value_ptr(data));
+}
+
+void ShaderProgram::setUniform(UniformId uniform, const glm::uvec4& data) {
+    glUniform4uiv(this->uniformLocation(uniform), 1, glm::value_ptr(data));
+}
+
+void ShaderProgram::setUniform(UniformId uniform, const glm::mat2& data) {
+    glUniformMatrix2fv(this->uniformLocation(uniform), 1, GL_FALSE, glm::value_ptr(data));
+}
+
+void ShaderProgram::setUniform(UniformId uniform, const glm::mat3& data) {
+    glUniformMatrix3fv(this->uniformLocation(uniform), 1, GL_FALSE, glm::value_ptr(data));
+}
+
+void ShaderProgram::setUniform(UniformId uniform, const glm::mat4& data) {
+    glUniformMatrix4fv(this->uniformLocation(uniform), 1, GL_FALSE, glm::value_ptr(data));
+}
+
+void ShaderProgram::setUniform(UniformId uniform, const float* data, size_t count) {
+    glUniform1fv(this->uniformLocation(uniform), GLsizei(count), data);
+}
+
+void ShaderProgram::setUniform(UniformId uniform, const glm::vec4* data, size_t count) {
+    glUniform4fv(this->uniformLocation(uniform), GLsizei(count), reinterpret_cast<const GLfloat*>(data));
 }
 
-void ShaderProgram::setUniform(const std::string& uniform, glm::mat4 data) {
-    int location = glGetUniformLocation(this->handle, uniform.c_str());
-    glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(data));
+void ShaderProgram::setUniform(UniformId uniform, const glm::mat4* data, size_t count) {
+    glUniformMatrix4fv(this->uniformLocation(uniform), GLsizei(count), GL_FALSE,
+                       reinterpret_cast<const GLfloat*>(data));
 }
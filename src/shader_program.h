@@ -1,25 +1,98 @@
 #ifndef SHADER_PROGRAM_H
 #define SHADER_PROGRAM_H
 
+#include "hash.h"
 #include "shader.h"
 
+#include <cstdint>
 #include <string>
+#include <vector>
 
 #include <GL/glew.h>
 
+#include <glm/mat2x2.hpp>
+#include <glm/mat3x3.hpp>
 #include <glm/mat4x4.hpp>
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+
+// name of a uniform hashed at compile time, e.g. constexpr UniformId MVP("mvp");
+struct UniformId {
+    uint64_t hash;
+
+    constexpr explicit UniformId(const char* name) : hash(hashString(name)) {
+    }
+};
 
 class ShaderProgram {
 public:
+    // an active uniform or attribute found by reflection after linking
+    struct Variable {
+        std::string name;
+        uint64_t hash;
+        GLint location;
+        GLenum type;
+        GLint size;
+    };
+
     ShaderProgram();
     void attachShader(Shader shader);
     void setAttribLocation(const std::string& attribute, unsigned int location);
-    void setUniform(const std::string& uniform, glm::mat4 data);
+    // after linking, programs without the block ignore it
+    void setUniformBlockBinding(const std::string& block, GLuint binding);
+    // links the program and reflects its active uniforms and attributes
     void link();
+    // link split in two, between them the driver may link in the background while other programs are compiled
+    void startLink();
+    void finishLink();
+    // loads a binary returned by binary instead of linking, returns false if the driver rejects it, e.g. after a
+    // driver update. The program can be linked from source then.
+    bool loadBinary(GLenum binaryFormat, const void* data, size_t size);
+    // empty if the driver does not provide one, see GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+    std::vector<char> binary(GLenum& binaryFormat) const;
     void use();
+    GLuint id() const {
+        return this->handle;
+    }
+
+    // -1 if the program has no such active uniform, setting it is then a no-op like in OpenGL
+    GLint uniformLocation(UniformId uniform) const;
+    GLint attributeLocation(const std::string& attribute) const;
+    const std::vector<Variable>& uniforms() const {
+        return this->activeUniforms;
+    }
+    const std::vector<Variable>& attributes() const {
+        return this->activeAttributes;
+    }
+
+    // the program has to be in use, samplers are set to their texture unit with the int overload
+    void setUniform(UniformId uniform, float data);
+    void setUniform(UniformId uniform, int data);
+    void setUniform(UniformId uniform, unsigned int data);
+    void setUniform(UniformId uniform, bool data);
+    void setUniform(UniformId uniform, const glm::vec2& data);
+    void setUniform(UniformId uniform, const glm::vec3& data);
+    void setUniform(UniformId uniform, const glm::vec4& data);
+    void setUniform(UniformId uniform, const glm::ivec2& data);
+    void setUniform(UniformId uniform, const glm::ivec3& data);
+    void setUniform(UniformId uniform, const glm::ivec4& data);
+    void setUniform(UniformId uniform, const glm::uvec2& data);
+    void setUniform(UniformId uniform, const glm::uvec3& data);
+    void setUniform(UniformId uniform, const glm::uvec4& data);
+    void setUniform(UniformId uniform, const glm::mat2& data);
+    void setUniform(UniformId uniform, const glm::mat3& data);
+    void setUniform(UniformId uniform, const glm::mat4& data);
+    // uniform arrays
+    void setUniform(UniformId uniform, const float* data, size_t count);
+    void setUniform(UniformId uniform, const glm::vec4* data, size_t count);
+    void setUniform(UniformId uniform, const glm::mat4* data, size_t count);
 
 private:
     GLuint handle;
+    // sorted by hash, a handful of entries so a binary search beats a hash map
+    std::vector<Variable> activeUniforms;
+    std::vector<Variable> activeAttributes;
 };
 
 #endif
@@ -0,0 +1,89 @@
+#include "source_stamp.h"
+
+#include "hash.h"
+#include "mapped_file.h"
+
+#include <cstdio>
+#include <fstream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#endif
+#include <sys/stat.h>
+
+#include <fmt/format.h>
+using namespace fmt;
+
+bool stampSource(const std::string& path, SourceStamp& stamp) {
+    struct stat status;
+    if (stat(path.c_str(), &status) != 0) {
+        return false;
+    }
+    stamp.size = static_cast<uint64_t>(status.st_size);
+    stamp.modificationTime = static_cast<int64_t>(status.st_mtime);
+    return true;
+}
+
+uint64_t hashFile(const std::string& path) {
+    MappedFile file = MappedFile::open(path);
+    return hashBytes(file.data(), file.size());
+}
+
+bool writeCookedFile(const std::string& path, const std::function<void(std::ostream& out)>& write) {
+    std::string temporaryPath = path + ".tmp";
+    {
+        std::ofstream out(temporaryPath.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+        try {
+            if (out) {
+                write(out);
+            }
+        } catch (...) {
+            out.close();
+            std::remove(temporaryPath.c_str());
+            throw;
+        }
+        if (!out) {
+            out.close();
+            std::remove(temporaryPath.c_str());
+            return false;
+        }
+    }
+#ifdef _WIN32
+    // rename does not replace an existing file on Windows
+    bool replaced = MoveFileExA(temporaryPath.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+    bool replaced = std::rename(temporaryPath.c_str(), path.c_str()) == 0;
+#endif
+    if (!replaced) {
+        std::remove(temporaryPath.c_str());
+    }
+    return replaced;
+}
+
+bool isCookedFrom(const std::string& sourcePath, const SourceStamp& stamp, uint64_t hash, const std::string& cookedPath,
+                  uint64_t stampOffset) {
+    SourceStamp sourceStamp;
+    if (!stampSource(sourcePath, sourceStamp)) {
+        return true;
+    }
+    if (sourceStamp.size == stamp.size && sourceStamp.modificationTime == stamp.modificationTime) {
+        return true;
+    }
+    // the modification time also changes on a fresh checkout, only the content hash is authoritative
+    if (sourceStamp.size != stamp.size || hashFile(sourcePath) != hash) {
+        return false;
+    }
+
+    // the cooked file may be mapped, only the stamp is written in place
+    std::fstream cooked(cookedPath.c_str(), std::ios::in | std::ios::out | std::ios::binary);
+    cooked.seekp(static_cast<std::streamoff>(stampOffset));
+    cooked.write(reinterpret_cast<const char*>(&sourceStamp.size), sizeof(sourceStamp.size));
+    cooked.write(reinterpret_cast<const char*>(&sourceStamp.modificationTime), sizeof(sourceStamp.modificationTime));
+    if (!cooked) {
+        print(stderr, "Warning: Failed to update the source stamp of {}, {} is hashed on every start\n", cookedPath,
+              sourcePath);
+    }
+    return true;
+}
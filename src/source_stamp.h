@@ -0,0 +1,29 @@
+#ifndef SOURCE_STAMP_H
+#define SOURCE_STAMP_H
+
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <string>
+
+// size and modification time of a file, cooked assets store the stamp of their source to detect when it changed
+struct SourceStamp {
+    uint64_t size = 0;
+    int64_t modificationTime = 0;
+};
+
+// returns false if the file does not exist
+bool stampSource(const std::string& path, SourceStamp& stamp);
+uint64_t hashFile(const std::string& path);
+// writes a cooked file into a temporary file which then replaces path, so an interrupted write never leaves a
+// partially written file behind. Returns false if writing or replacing failed. Exceptions thrown by write are passed
+// on after the temporary file was removed.
+bool writeCookedFile(const std::string& path, const std::function<void(std::ostream& out)>& write);
+// true if the cooked file is still current for its source, stamp and hash are what the cooked file stores about the
+// source. The stamp is stored at stampOffset of the cooked file, the size followed by the modification time. A cooked
+// file can be shipped without its source, so a missing source counts as current. If only the modification time
+// changed the content hash decides, a matching source is stamped again so it is not hashed on the next start.
+bool isCookedFrom(const std::string& sourcePath, const SourceStamp& stamp, uint64_t hash, const std::string& cookedPath,
+                  uint64_t stampOffset);
+
+#endif // !SOURCE_STAMP_H
@@ -0,0 +1,3 @@
+// implementation of stb_image, linked into every executable that loads images
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
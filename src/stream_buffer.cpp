@@ -0,0 +1,143 @@
+#include "stream_buffer.h"
+
+#include "render_stats.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include <fmt/format.h>
+using namespace fmt;
+
+// regions are this many bytes apart so every allocation alignment of OpenGL is satisfied at their start
+const size_t REGION_ALIGNMENT = 256;
+
+// a fence which is not signaled within this time is waited for again, the wait only ends early if the GPU is lost
+const GLuint64 FENCE_TIMEOUT = 1000000000; // 1 s
+
+StreamBuffer::StreamBuffer(size_t frameSize, bool persistent)
+    : persistent(persistent && GLEW_ARB_buffer_storage) {
+    this->create(frameSize);
+}
+
+StreamBuffer::~StreamBuffer() {
+    for (GLsync fence : this->fences) {
+        if (fence) {
+            glDeleteSync(fence);
+        }
+    }
+    glDeleteBuffers(GLsizei(this->retired.size()), this->retired.data());
+    // deleting a buffer unmaps it
+    glDeleteBuffers(1, &this->handle);
+}
+
+void StreamBuffer::create(size_t frameSize) {
+    this->capacity = (std::max(frameSize, size_t(1)) + REGION_ALIGNMENT - 1) / REGION_ALIGNMENT * REGION_ALIGNMENT;
+    glGenBuffers(1, &this->handle);
+    // GL_COPY_WRITE_BUFFER leaves the vertex array and the other bindings untouched
+    glBindBuffer(GL_COPY_WRITE_BUFFER, this->handle);
+    if (this->persistent) {
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_COPY_WRITE_BUFFER, this->capacity * FRAMES_IN_FLIGHT, nullptr, flags);
+        this->mapping = static_cast<unsigned char*>(
+            glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, this->capacity * FRAMES_IN_FLIGHT, flags));
+        if (this->mapping) {
+            return;
+        }
+        // the storage is immutable, the orphaning path needs a new buffer
+        print(stderr, "Warning: failed to map the stream buffer persistently, orphaning it every frame instead\n");
+        glDeleteBuffers(1, &this->handle);
+        this->persistent = false;
+        glGenBuffers(1, &this->handle);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, this->handle);
+    }
+    this->staging.resize(this->capacity);
+}
+
+void StreamBuffer::beginFrame() {
+    // the draws of the last frame are issued, the driver keeps the storage alive until they are done
+    glDeleteBuffers(GLsizei(this->retired.size()), this->retired.data());
+    this->retired.clear();
+    this->cursor = 0;
+    this->flushed = 0;
+    this->allocatedBytes = 0;
+    if (!this->persistent) {
+        return;
+    }
+
+    this->region = (this->region + 1) % FRAMES_IN_FLIGHT;
+    GLsync& fence = this->fences[this->region];
+    if (!fence) {
+        return;
+    }
+    GLenum result = glClientWaitSync(fence, 0, 0);
+    if (result == GL_TIMEOUT_EXPIRED) {
+        this->stalls++;
+        do {
+            result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, FENCE_TIMEOUT);
+        } while (result == GL_TIMEOUT_EXPIRED);
+    }
+    if (result == GL_WAIT_FAILED) {
+        throw std::runtime_error("Failed to wait for the stream buffer fence");
+    }
+    glDeleteSync(fence);
+    fence = nullptr;
+}
+
+StreamAllocation StreamBuffer::allocate(size_t size, size_t alignment) {
+    size_t regionStart = this->persistent ? this->region * this->capacity : 0;
+    size_t offset = (regionStart + this->cursor + alignment - 1) / alignment * alignment;
+    if (offset + size > regionStart + this->capacity) {
+        size_t frameSize = std::max(this->capacity * 2, this->cursor + size + alignment);
+        if (this->persistent) {
+            // earlier allocations of the frame stay in the old buffer, the new one starts with a full region
+            this->retired.push_back(this->handle);
+            for (GLsync& fence : this->fences) {
+                if (fence) {
+                    glDeleteSync(fence);
+                    fence = nullptr;
+                }
+            }
+            this->create(frameSize);
+            this->region = 0;
+            this->cursor = 0;
+            regionStart = 0;
+            offset = 0;
+        } else {
+            // the staged allocations keep their offsets, flush uploads the whole frame into the larger storage
+            this->capacity = (frameSize + REGION_ALIGNMENT - 1) / REGION_ALIGNMENT * REGION_ALIGNMENT;
+            this->staging.resize(this->capacity);
+            this->flushed = 0;
+        }
+    }
+
+    this->cursor = offset + size - regionStart;
+    this->allocatedBytes += size;
+    renderStats.streamBytes += unsigned(size);
+    unsigned char* data = this->persistent ? this->mapping + offset : this->staging.data() + offset;
+    return StreamAllocation{data, this->handle, offset};
+}
+
+void StreamBuffer::flush() {
+    if (this->persistent || this->cursor == this->flushed) {
+        return;
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, this->handle);
+    if (this->flushed == 0) {
+        // the frames in flight keep reading the old storage
+        glBufferData(GL_COPY_WRITE_BUFFER, this->capacity, nullptr, GL_STREAM_DRAW);
+    }
+    glBufferSubData(GL_COPY_WRITE_BUFFER, this->flushed, this->cursor - this->flushed,
+                    this->staging.data() + this->flushed);
+    this->flushed = this->cursor;
+}
+
+void StreamBuffer::endFrame() {
+    if (!this->persistent) {
+        return;
+    }
+    GLsync& fence = this->fences[this->region];
+    if (fence) {
+        glDeleteSync(fence);
+    }
+    fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
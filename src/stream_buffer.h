@@ -0,0 +1,80 @@
+#ifndef STREAM_BUFFER_H
+#define STREAM_BUFFER_H
+
+#include <cstddef>
+#include <vector>
+
+#include <GL/glew.h>
+
+// frames the GPU may still be reading from while the CPU writes the next one
+const size_t FRAMES_IN_FLIGHT = 3;
+
+// space for data of the current frame in a stream buffer
+struct StreamAllocation {
+    // the data has to be written here before the next allocation
+    unsigned char* data;
+    // the buffer changes between allocations when it grows
+    GLuint buffer;
+    size_t offset;
+};
+
+// data the CPU writes every frame for the GPU to read once, e.g. GUI vertices, uniform blocks or instance transforms.
+// With GL_ARB_buffer_storage the buffer holds one region per frame in flight and stays mapped persistently and
+// coherently, allocations point straight into the mapping. A fence at the end of each frame tells when the GPU is done
+// with a region, so beginFrame only waits if the GPU falls FRAMES_IN_FLIGHT frames behind. Plain OpenGL 4.1 has no
+// persistent mapping, there allocations are staged in CPU memory and the first flush of a frame orphans the storage,
+// the driver hands out fresh memory instead of waiting for the frames still reading the old one. Render thread only.
+class StreamBuffer {
+public:
+    // frameSize is the initial capacity of a frame, it doubles whenever a frame needs more. persistent false forces
+    // the orphaning path, e.g. to compare the two.
+    explicit StreamBuffer(size_t frameSize, bool persistent = true);
+    ~StreamBuffer();
+    StreamBuffer(const StreamBuffer&) = delete;
+    StreamBuffer& operator=(const StreamBuffer&) = delete;
+
+    // waits for the GPU to finish the frame which used the next region before
+    void beginFrame();
+    // alignment does not have to be a power of two, e.g. the size of a vertex so its offset divides into an index
+    StreamAllocation allocate(size_t size, size_t alignment);
+    // has to be called after writing and before the draws reading the data, only the orphaning path uploads anything
+    void flush();
+    // fences the commands issued this frame, after the last draw reading the data of the frame
+    void endFrame();
+
+    bool isPersistent() const {
+        return this->persistent;
+    }
+    // bytes allocated since beginFrame
+    size_t frameBytes() const {
+        return this->allocatedBytes;
+    }
+    // frames whose beginFrame had to wait for the GPU
+    size_t stallCount() const {
+        return this->stalls;
+    }
+
+private:
+    void create(size_t frameSize);
+
+    bool persistent;
+    GLuint handle = 0;
+    // bytes per frame
+    size_t capacity = 0;
+    // persistent: all regions mapped at once, the fence of the last frame which used each region
+    unsigned char* mapping = nullptr;
+    GLsync fences[FRAMES_IN_FLIGHT] = {};
+    size_t region = 0;
+    // orphaning: the allocations of the frame until they are uploaded
+    std::vector<unsigned char> staging;
+    size_t flushed = 0;
+
+    // offset of the next allocation in the region of the frame
+    size_t cursor = 0;
+    size_t allocatedBytes = 0;
+    // replaced by a larger buffer during this frame, draws of the frame may still use them
+    std::vector<GLuint> retired;
+    size_t stalls = 0;
+};
+
+#endif // !STREAM_BUFFER_H
@@ -0,0 +1,488 @@
+#include "terrain.h"
+
+#include <algorithm>
+#include <cmath>
+#include <set>
+#include <utility>
+
+#include "profiler.h"
+#include "render_state.h"
+#include "render_stats.h"
+
+#include <glm/common.hpp>
+#include <glm/geometric.hpp>
+#include <glm/vec4.hpp>
+
+static_assert(TERRAIN_RESTART_INDEX == PRIMITIVE_RESTART_INDEX, "terrain strips are drawn with primitive restart");
+
+// chunks which have not been selected for this many frames are released, this keeps chunks on the border of a
+// level from being streamed in and out every frame
+const unsigned long EVICTION_FRAMES = 120;
+// upper limit of chunks being generated at the same time
+const size_t MAX_PENDING_CHUNKS = 16;
+// fraction of a level's distance range after which vertices start morphing towards the next coarser level
+const float MORPH_START = 0.7f;
+// lodDistance is scaled by this factor until the selection fits into the triangle budget
+const float BUDGET_REDUCTION = 0.8f;
+const int MAX_BUDGET_ITERATIONS = 10;
+
+static int level(const std::tuple<int, int, int>& key) {
+    return std::get<0>(key);
+}
+
+Terrain::Terrain(std::shared_ptr<const HeightMap> heightMap, ThreadPool& threadPool)
+    : threadPool(threadPool), shared(std::make_shared<SharedState>()) {
+    this->mapWidth = heightMap->width();
+    this->mapHeight = heightMap->height();
+
+    // halve the number of chunks per level until a single chunk covers the whole map
+    glm::ivec2 chunks((this->mapWidth - 2) / TERRAIN_CHUNK_SIZE + 1, (this->mapHeight - 2) / TERRAIN_CHUNK_SIZE + 1);
+    this->levelChunks.push_back(chunks);
+    while (chunks.x > 1 || chunks.y > 1) {
+        chunks = glm::ivec2((chunks.x + 1) / 2, (chunks.y + 1) / 2);
+        this->levelChunks.push_back(chunks);
+    }
+    this->rootLevel = int(this->levelChunks.size()) - 1;
+
+    this->computeElevationRanges(*heightMap);
+    this->shared->heightMap = std::move(heightMap);
+}
+
+void Terrain::computeElevationRanges(const HeightMap& heightMap) {
+    this->elevationRanges.resize(this->levelChunks.size());
+
+    glm::ivec2 chunks = this->levelChunks[0];
+    auto& finest = this->elevationRanges[0];
+    finest.assign(chunks.x * chunks.y, glm::vec2(1e30f, -1e30f));
+    for (int z = 0; z < this->mapHeight; z++) {
+        for (int x = 0; x < this->mapWidth; x++) {
+            float elevation = heightMap.elevation(x, z);
+            // samples on a chunk border belong to both chunks
+            int firstX = x % TERRAIN_CHUNK_SIZE == 0 && x > 0 ? x / TERRAIN_CHUNK_SIZE - 1 : x / TERRAIN_CHUNK_SIZE;
+            int firstZ = z % TERRAIN_CHUNK_SIZE == 0 && z > 0 ? z / TERRAIN_CHUNK_SIZE - 1 : z / TERRAIN_CHUNK_SIZE;
+            int lastX = std::min(x / TERRAIN_CHUNK_SIZE, chunks.x - 1);
+            int lastZ = std::min(z / TERRAIN_CHUNK_SIZE, chunks.y - 1);
+            for (int chunkZ = firstZ; chunkZ <= lastZ; chunkZ++) {
+                for (int chunkX = firstX; chunkX <= lastX; chunkX++) {
+                    glm::vec2& range = finest[chunkX + chunkZ * chunks.x];
+                    range.x = std::min(range.x, elevation);
+                    range.y = std::max(range.y, elevation);
+                }
+            }
+        }
+    }
+
+    for (size_t level = 1; level < this->levelChunks.size(); level++) {
+        glm::ivec2 children = this->levelChunks[level - 1];
+        glm::ivec2 parents = this->levelChunks[level];
+        auto& ranges = this->elevationRanges[level];
+        ranges.assign(parents.x * parents.y, glm::vec2(1e30f, -1e30f));
+        for (int z = 0; z < children.y; z++) {
+            for (int x = 0; x < children.x; x++) {
+                glm::vec2 child = this->elevationRanges[level - 1][x + z * children.x];
+                glm::vec2& range = ranges[x / 2 + z / 2 * parents.x];
+                range.x = std::min(range.x, child.x);
+                range.y = std::max(range.y, child.y);
+            }
+        }
+    }
+}
+
+Terrain::ChunkGrid Terrain::chunkGrid(ChunkKey key, int mapWidth, int mapHeight) {
+    ChunkGrid grid;
+    grid.stride = 1 << std::get<0>(key);
+    grid.x0 = std::get<1>(key) * TERRAIN_CHUNK_SIZE * grid.stride;
+    grid.z0 = std::get<2>(key) * TERRAIN_CHUNK_SIZE * grid.stride;
+    // chunks on the far border of the map can be smaller
+    grid.columns = std::min(TERRAIN_CHUNK_SIZE, (mapWidth - 1 - grid.x0 + grid.stride - 1) / grid.stride) + 1;
+    grid.rows = std::min(TERRAIN_CHUNK_SIZE, (mapHeight - 1 - grid.z0 + grid.stride - 1) / grid.stride) + 1;
+    return grid;
+}
+
+Terrain::ChunkMesh Terrain::generateChunk(const HeightMap& heightMap, ChunkKey key) {
+    ChunkMesh chunk;
+    chunk.key = key;
+    ChunkGrid grid = chunkGrid(key, heightMap.width(), heightMap.height());
+    generateTerrainMesh(heightMap, grid.x0, grid.z0, grid.stride, grid.columns, grid.rows, chunk.mesh);
+    generateTerrainOccluder(heightMap, grid.x0, grid.z0, grid.stride, grid.columns, grid.rows,
+                            TERRAIN_OCCLUDER_CELL_SIZE, chunk.occluder);
+    return chunk;
+}
+
+void Terrain::update(glm::vec3 cameraPosition, const Frustum& frustum, const TerrainSettings& settings) {
+    this->frame++;
+
+    // switching the index mode only rebinds the index buffers of the resident chunks
+    if (settings.triangleStrips != this->strips) {
+        this->strips = settings.triangleStrips;
+        for (auto& chunk : this->chunks) {
+            if (chunk.second.resident) {
+                renderState.bindVertexArray(chunk.second.vao);
+                this->bindIndexBuffer(chunk.first);
+            }
+        }
+    }
+
+    // upload chunks finished by the workers
+    std::vector<ChunkMesh> completed;
+    {
+        std::lock_guard<std::mutex> lock(this->shared->mutex);
+        completed.swap(this->shared->completed);
+    }
+    for (auto& chunkMesh : completed) {
+        auto chunk = this->chunks.find(chunkMesh.key);
+        if (chunk == this->chunks.end() || chunk->second.resident) {
+            continue; // evicted while it was generated
+        }
+        this->upload(chunk->second, chunkMesh.key, chunkMesh.mesh);
+        chunk->second.occluder = std::move(chunkMesh.occluder);
+    }
+
+    // select chunks, reduce the level of detail until the selection fits into the budget
+    std::vector<ChunkKey> selection;
+    float lodDistance = std::max(settings.lodDistance, TERRAIN_MIN_LOD_DISTANCE);
+    this->budgetExceeded = false;
+    for (int iteration = 0; iteration < MAX_BUDGET_ITERATIONS; iteration++) {
+        selection.clear();
+        for (int z = 0; z < this->levelChunks[this->rootLevel].y; z++) {
+            for (int x = 0; x < this->levelChunks[this->rootLevel].x; x++) {
+                this->select(ChunkKey(this->rootLevel, x, z), cameraPosition, settings, lodDistance, selection);
+            }
+        }
+        unsigned int triangles = 0;
+        for (const auto& key : selection) {
+            triangles += this->chunkTriangles(key);
+        }
+        if (!settings.levelOfDetail || triangles <= unsigned(settings.triangleBudget)) {
+            break;
+        }
+        // a shorter distance would leave cracks, the selection stays over the budget
+        if (lodDistance <= TERRAIN_MIN_LOD_DISTANCE || iteration == MAX_BUDGET_ITERATIONS - 1) {
+            this->budgetExceeded = true;
+            break;
+        }
+        lodDistance = std::max(lodDistance * BUDGET_REDUCTION, TERRAIN_MIN_LOD_DISTANCE);
+    }
+    this->selectedLodDistance = lodDistance;
+    this->morphing = settings.levelOfDetail;
+
+    for (const auto& key : selection) {
+        this->chunks[key].lastSelected = this->frame;
+    }
+    // the root chunks are the fallback for everything else and are never released
+    for (int z = 0; z < this->levelChunks[this->rootLevel].y; z++) {
+        for (int x = 0; x < this->levelChunks[this->rootLevel].x; x++) {
+            this->chunks[ChunkKey(this->rootLevel, x, z)].lastSelected = this->frame;
+        }
+    }
+
+    // release chunks which have not been needed for a while
+    for (auto chunk = this->chunks.begin(); chunk != this->chunks.end();) {
+        if (this->frame - chunk->second.lastSelected > EVICTION_FRAMES) {
+            this->release(chunk->second);
+            chunk = this->chunks.erase(chunk);
+        } else {
+            ++chunk;
+        }
+    }
+
+    // streaming does not depend on the view direction, only drawing does
+    this->request(cameraPosition);
+    this->buildDrawList(selection);
+    this->cullDrawList(frustum);
+}
+
+void Terrain::select(ChunkKey key, glm::vec3 cameraPosition, const TerrainSettings& settings, float lodDistance,
+                     std::vector<ChunkKey>& selection) const {
+    float distance = this->distanceToChunk(cameraPosition, key);
+    if (distance > settings.viewDistance) {
+        return;
+    }
+
+    // in continuous level of detail mode a chunk is split once the camera is within the range of the next finer level
+    int chunkLevel = level(key);
+    bool subdivide =
+        chunkLevel > 0 && (!settings.levelOfDetail || distance < lodDistance * float(1 << (chunkLevel - 1)));
+    if (!subdivide) {
+        selection.push_back(key);
+        return;
+    }
+
+    glm::ivec2 children = this->levelChunks[chunkLevel - 1];
+    for (int z = std::get<2>(key) * 2; z < std::min(std::get<2>(key) * 2 + 2, children.y); z++) {
+        for (int x = std::get<1>(key) * 2; x < std::min(std::get<1>(key) * 2 + 2, children.x); x++) {
+            this->select(ChunkKey(chunkLevel - 1, x, z), cameraPosition, settings, lodDistance, selection);
+        }
+    }
+}
+
+unsigned int Terrain::chunkTriangles(ChunkKey key) const {
+    ChunkGrid grid = chunkGrid(key, this->mapWidth, this->mapHeight);
+    return unsigned((grid.columns - 1) * (grid.rows - 1) * 2);
+}
+
+void Terrain::buildDrawList(const std::vector<ChunkKey>& selection) {
+    // selected chunks which are not resident yet are replaced by their closest resident ancestor,
+    // which then also replaces all other selected chunks below it
+    std::set<ChunkKey> fallbacks;
+    for (const auto& key : selection) {
+        if (this->isResident(key)) {
+            continue;
+        }
+        for (int ancestor = level(key) + 1; ancestor <= this->rootLevel; ancestor++) {
+            int shift = ancestor - level(key);
+            ChunkKey ancestorKey(ancestor, std::get<1>(key) >> shift, std::get<2>(key) >> shift);
+            if (this->isResident(ancestorKey)) {
+                fallbacks.insert(ancestorKey);
+                break;
+            }
+        }
+    }
+
+    this->drawList.assign(fallbacks.begin(), fallbacks.end());
+    for (const auto& key : selection) {
+        if (!this->isResident(key)) {
+            continue;
+        }
+        bool replaced = false;
+        for (int ancestor = level(key) + 1; ancestor <= this->rootLevel && !replaced; ancestor++) {
+            int shift = ancestor - level(key);
+            replaced = fallbacks.count(ChunkKey(ancestor, std::get<1>(key) >> shift, std::get<2>(key) >> shift)) > 0;
+        }
+        if (!replaced) {
+            this->drawList.push_back(key);
+        }
+    }
+}
+
+void Terrain::cullDrawList(const Frustum& frustum) {
+    this->drawListBounds.clear();
+    for (const auto& key : this->drawList) {
+        this->drawListBounds.add(this->chunkBounds(key));
+    }
+    this->drawListVisibility.resize(this->drawList.size());
+    frustum.intersects(this->drawListBounds, this->drawListVisibility.data());
+
+    size_t visible = 0;
+    this->drawnTriangles = 0;
+    for (size_t i = 0; i < this->drawList.size(); i++) {
+        if (this->drawListVisibility[i]) {
+            this->drawnTriangles += this->chunkTriangles(this->drawList[i]);
+            this->drawList[visible++] = this->drawList[i];
+        }
+    }
+    this->culledChunks = this->drawList.size() - visible;
+    this->occludedChunks = 0;
+    this->drawList.resize(visible);
+
+    renderStats.drawnObjects += visible;
+    renderStats.culledObjects += this->culledChunks;
+}
+
+void Terrain::addOccluders(OcclusionCuller& culler, const glm::mat4& model) const {
+    for (const auto& key : this->drawList) {
+        const std::vector<glm::vec3>& occluder = this->chunks.at(key).occluder;
+        culler.addOccluders(occluder.data(), occluder.size(), model);
+    }
+}
+
+void Terrain::cullOccluded(OcclusionCuller& culler, const glm::mat4& model) {
+    // a chunk's own occluder lies inside its bounds, so it never hides the chunk itself
+    this->drawListBounds.clear();
+    for (const auto& key : this->drawList) {
+        this->drawListBounds.add(this->chunkBounds(key));
+    }
+    this->drawListVisibility.assign(this->drawList.size(), 1);
+    culler.cull(this->drawListBounds, model, this->drawListVisibility.data());
+
+    size_t visible = 0;
+    this->drawnTriangles = 0;
+    for (size_t i = 0; i < this->drawList.size(); i++) {
+        if (this->drawListVisibility[i]) {
+            this->drawnTriangles += this->chunkTriangles(this->drawList[i]);
+            this->drawList[visible++] = this->drawList[i];
+        }
+    }
+    this->occludedChunks = this->drawList.size() - visible;
+    this->drawList.resize(visible);
+    // counted as drawn by cullDrawList, the culler counts them as occluded
+    renderStats.drawnObjects -= unsigned(this->occludedChunks);
+}
+
+void Terrain::request(glm::vec3 cameraPosition) {
+    size_t pending = this->pendingChunkCount();
+    if (pending >= MAX_PENDING_CHUNKS) {
+        return;
+    }
+
+    // coarse chunks first since they are the fallback for the finer ones, then closest first
+    std::vector<std::pair<std::pair<int, float>, ChunkKey>> missing;
+    for (const auto& chunk : this->chunks) {
+        if (!chunk.second.resident && !chunk.second.cancelled) {
+            missing.emplace_back(
+                std::make_pair(-level(chunk.first), this->distanceToChunk(cameraPosition, chunk.first)), chunk.first);
+        }
+    }
+    std::sort(missing.begin(), missing.end());
+
+    for (size_t i = 0; i < missing.size() && pending < MAX_PENDING_CHUNKS; i++, pending++) {
+        ChunkKey key = missing[i].second;
+        Chunk& chunk = this->chunks[key];
+        chunk.cancelled = std::make_shared<std::atomic<bool>>(false);
+
+        std::shared_ptr<SharedState> shared = this->shared;
+        std::shared_ptr<std::atomic<bool>> cancelled = chunk.cancelled;
+        this->threadPool.submit([shared, cancelled, key] {
+            if (*cancelled) {
+                return;
+            }
+            PROFILE_SCOPE("Terrain chunk");
+            ChunkMesh mesh = generateChunk(*shared->heightMap, key);
+            std::lock_guard<std::mutex> lock(shared->mutex);
+            shared->completed.push_back(std::move(mesh));
+        });
+    }
+}
+
+void Terrain::upload(Chunk& chunk, ChunkKey key, const TerrainMesh& mesh) {
+    glGenVertexArrays(1, &chunk.vao);
+    renderState.bindVertexArray(chunk.vao);
+
+    glGenBuffers(1, &chunk.vbo);
+    glBindBuffer(GL_ARRAY_BUFFER, chunk.vbo);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(TerrainVertex) * mesh.vertices.size(), mesh.vertices.data(),
+                 GL_STATIC_DRAW);
+    // height and morph height as raw samples, scaled in the vertex shader
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 2, GL_UNSIGNED_SHORT, GL_FALSE, sizeof(TerrainVertex), nullptr);
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, sizeof(TerrainVertex), (void*)offsetof(TerrainVertex, normal));
+
+    this->bindIndexBuffer(key);
+
+    chunk.bytes = sizeof(TerrainVertex) * mesh.vertices.size();
+    chunk.resident = true;
+}
+
+void Terrain::bindIndexBuffer(ChunkKey key) {
+    ChunkGrid grid = chunkGrid(key, this->mapWidth, this->mapHeight);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->indexBuffer(this->strips, grid.columns, grid.rows).buffer);
+}
+
+const Terrain::IndexBuffer& Terrain::indexBuffer(bool strips, int columns, int rows) {
+    IndexBuffer& indices = this->indexBuffers[IndexBufferKey(strips, columns, rows)];
+    if (indices.buffer != 0) {
+        return indices;
+    }
+
+    // filled through GL_ARRAY_BUFFER, binding GL_ELEMENT_ARRAY_BUFFER would change the bound vertex array
+    glGenBuffers(1, &indices.buffer);
+    glBindBuffer(GL_ARRAY_BUFFER, indices.buffer);
+    if (strips) {
+        std::vector<uint16_t> strip;
+        generateTerrainStrips(columns, rows, strip);
+        indices.count = GLsizei(strip.size());
+        indices.bytes = sizeof(uint16_t) * strip.size();
+        glBufferData(GL_ARRAY_BUFFER, indices.bytes, strip.data(), GL_STATIC_DRAW);
+    } else {
+        std::vector<unsigned int> triangles;
+        generateTerrainTriangles(columns, rows, triangles);
+        indices.count = GLsizei(triangles.size());
+        indices.bytes = sizeof(unsigned int) * triangles.size();
+        glBufferData(GL_ARRAY_BUFFER, indices.bytes, triangles.data(), GL_STATIC_DRAW);
+    }
+    return indices;
+}
+
+void Terrain::release(Chunk& chunk) {
+    if (!chunk.resident) {
+        if (chunk.cancelled) {
+            *chunk.cancelled = true;
+        }
+        return;
+    }
+    renderState.deleteVertexArray(chunk.vao);
+    glDeleteBuffers(1, &chunk.vbo);
+    chunk.resident = false;
+}
+
+void Terrain::submit(RenderQueue& queue, ShaderProgram& program, UniformRingBuffer& objects,
+                     const glm::mat4& model) {
+    ObjectUniforms uniforms;
+    uniforms.model = model;
+    uniforms.parameters[2] =
+        glm::vec4(float(this->mapWidth - 1), float(this->mapHeight - 1), HEIGHTMAP_ELEVATION_SCALE, 0.0f);
+    DrawPacket packet;
+    packet.program = &program;
+    packet.mode = this->strips ? GL_TRIANGLE_STRIP : GL_TRIANGLES;
+    packet.indexType = this->strips ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+    for (const auto& key : this->drawList) {
+        const Chunk& chunk = this->chunks.at(key);
+        ChunkGrid grid = chunkGrid(key, this->mapWidth, this->mapHeight);
+        uniforms.parameters[0] = glm::vec4(this->morphRange(level(key)), float(grid.columns), float(grid.stride));
+        uniforms.parameters[1] = glm::vec4(float(grid.x0), float(grid.z0), 0.0f, 0.0f);
+        packet.vertexArray = chunk.vao;
+        packet.indexCount = this->indexBuffers.at(IndexBufferKey(this->strips, grid.columns, grid.rows)).count;
+        packet.objectBlock = objects.push(&uniforms);
+        glm::vec3 center = glm::vec3(model * glm::vec4(this->chunkBounds(key).center(), 1.0f));
+        queue.submit(packet, center);
+    }
+}
+
+void Terrain::drawBounds(DebugDraw& debugDraw, const glm::mat4& model) const {
+    for (const auto& key : this->drawList) {
+        float coarseness = this->rootLevel > 0 ? float(level(key)) / float(this->rootLevel) : 0.0f;
+        debugDraw.box(this->chunkBounds(key), model, glm::vec3(coarseness, 1.0f - coarseness, 0.0f));
+    }
+}
+
+glm::vec2 Terrain::morphRange(int chunkLevel) const {
+    if (!this->morphing || chunkLevel == this->rootLevel) {
+        return glm::vec2(1e30f, 2e30f); // there is no coarser level to morph to
+    }
+    float start = chunkLevel == 0 ? 0.0f : this->selectedLodDistance * float(1 << (chunkLevel - 1));
+    float end = this->selectedLodDistance * float(1 << chunkLevel);
+    return glm::vec2(start + (end - start) * MORPH_START, end);
+}
+
+bool Terrain::isResident(ChunkKey key) const {
+    auto chunk = this->chunks.find(key);
+    return chunk != this->chunks.end() && chunk->second.resident;
+}
+
+size_t Terrain::residentChunkCount() const {
+    return std::count_if(this->chunks.begin(), this->chunks.end(),
+                         [](const std::pair<const ChunkKey, Chunk>& chunk) { return chunk.second.resident; });
+}
+
+size_t Terrain::residentBytes() const {
+    size_t bytes = 0;
+    for (const auto& chunk : this->chunks) {
+        bytes += chunk.second.resident ? chunk.second.bytes : 0;
+    }
+    for (const auto& indices : this->indexBuffers) {
+        bytes += indices.second.bytes;
+    }
+    return bytes;
+}
+
+size_t Terrain::pendingChunkCount() const {
+    return std::count_if(this->chunks.begin(), this->chunks.end(), [](const std::pair<const ChunkKey, Chunk>& chunk) {
+        return !chunk.second.resident && chunk.second.cancelled;
+    });
+}
+
+BoundingBox Terrain::chunkBounds(ChunkKey key) const {
+    int size = TERRAIN_CHUNK_SIZE << level(key);
+    glm::vec2 elevation = this->elevationRanges[level(key)][std::get<1>(key) + std::get<2>(key) *
+                                                                                   this->levelChunks[level(key)].x];
+    return BoundingBox(glm::vec3(std::get<1>(key) * size, elevation.x, std::get<2>(key) * size),
+                       glm::vec3(std::min((std::get<1>(key) + 1) * size, this->mapWidth - 1), elevation.y,
+                                 std::min((std::get<2>(key) + 1) * size, this->mapHeight - 1)));
+}
+
+float Terrain::distanceToChunk(glm::vec3 position, ChunkKey key) const {
+    BoundingBox bounds = this->chunkBounds(key);
+    glm::vec3 closest = glm::clamp(position, bounds.minimum, bounds.maximum);
+    return glm::distance(position, closest);
+}
@@ -0,0 +1,180 @@
+#ifndef TERRAIN_H
+#define TERRAIN_H
+
+#include "bounds.h"
+#include "debug_draw.h"
+#include "frustum.h"
+#include "heightmap.h"
+#include "occlusion_culler.h"
+#include "render_queue.h"
+#include "shader_program.h"
+#include "terrain_mesh.h"
+#include "thread_pool.h"
+#include "uniform_buffer.h"
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <tuple>
+#include <vector>
+
+#include <GL/glew.h>
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+
+// quads along the edge of one terrain chunk, independent of its level of detail
+const int TERRAIN_CHUNK_SIZE = 32;
+// smallest lodDistance at which neighbouring selected chunks differ by at most one level, CDLOD leaves cracks below
+// 2 * sqrt(2) * TERRAIN_CHUNK_SIZE (rounded up here)
+const float TERRAIN_MIN_LOD_DISTANCE = 2.0f * 1.4142136f * float(TERRAIN_CHUNK_SIZE);
+// quads along the edge of one cell of the occluder of a chunk, 4x4 cells per chunk
+const int TERRAIN_OCCLUDER_CELL_SIZE = 8;
+
+struct TerrainSettings {
+    // continuous level of detail, when disabled the whole terrain is drawn at full resolution
+    bool levelOfDetail = true;
+    // chunks further away than this are neither streamed in nor drawn
+    float viewDistance = 512.0f;
+    // distance up to which full resolution chunks are used, doubles with each coarser level. At least
+    // TERRAIN_MIN_LOD_DISTANCE.
+    float lodDistance = 96.0f;
+    // lodDistance is reduced until the selected chunks fit into this budget, but not below TERRAIN_MIN_LOD_DISTANCE
+    int triangleBudget = 100000;
+    // 16 bit triangle strips with primitive restart instead of 32 bit triangle lists
+    bool triangleStrips = true;
+};
+
+// heightmap split into a quadtree of chunks (CDLOD). Every chunk has the same number of vertices, a chunk on level n
+// covers 2^n times the area of a full resolution chunk. Chunks are selected by their distance to the camera,
+// generated on worker threads and uploaded by the render thread. Only resident chunks are drawn, if a chunk is not
+// ready yet its closest resident ancestor is drawn instead. The vertices of a chunk do not store x and z, so all chunks
+// with the same number of vertices share one index buffer.
+class Terrain {
+public:
+    Terrain(std::shared_ptr<const HeightMap> heightMap, ThreadPool& threadPool);
+
+    // camera position and frustum are in terrain space, selects the chunks to draw and streams them in and out
+    void update(glm::vec3 cameraPosition, const Frustum& frustum, const TerrainSettings& settings);
+    // pushes one object block per chunk with model, the chunk's morph range and the grid its vertices lie on
+    void submit(RenderQueue& queue, ShaderProgram& program, UniformRingBuffer& objects, const glm::mat4& model);
+    // bounds of the chunks drawn this frame, green on the finest level turning red towards the coarsest
+    void drawBounds(DebugDraw& debugDraw, const glm::mat4& model) const;
+    // conservative occluders of the chunks drawn this frame, generated with the chunks
+    void addOccluders(OcclusionCuller& culler, const glm::mat4& model) const;
+    // removes the chunks hidden behind the occluders from the chunks drawn this frame
+    void cullOccluded(OcclusionCuller& culler, const glm::mat4& model);
+
+    size_t residentChunkCount() const;
+    size_t pendingChunkCount() const;
+    size_t drawnChunkCount() const {
+        return this->drawList.size();
+    }
+    size_t culledChunkCount() const {
+        return this->culledChunks;
+    }
+    size_t occludedChunkCount() const {
+        return this->occludedChunks;
+    }
+    unsigned int triangleCount() const {
+        return this->drawnTriangles;
+    }
+    // the selection needs more triangles than the budget even at TERRAIN_MIN_LOD_DISTANCE
+    bool triangleBudgetExceeded() const {
+        return this->budgetExceeded;
+    }
+    // vertex buffers of the resident chunks and the shared index buffers
+    size_t residentBytes() const;
+
+private:
+    // level, x, z
+    typedef std::tuple<int, int, int> ChunkKey;
+
+    struct ChunkMesh {
+        ChunkKey key;
+        TerrainMesh mesh;
+        std::vector<glm::vec3> occluder;
+    };
+
+    // first sample, samples between vertices and vertices along x and z of a chunk
+    struct ChunkGrid {
+        int x0;
+        int z0;
+        int stride;
+        int columns;
+        int rows;
+    };
+
+    struct Chunk {
+        bool resident = false;
+        unsigned long lastSelected = 0;
+        std::shared_ptr<std::atomic<bool>> cancelled;
+        GLuint vao = 0;
+        GLuint vbo = 0;
+        size_t bytes = 0;
+        // three positions per triangle in terrain space
+        std::vector<glm::vec3> occluder;
+    };
+
+    struct IndexBuffer {
+        GLuint buffer = 0;
+        GLsizei count = 0;
+        size_t bytes = 0;
+    };
+    // strips, columns, rows
+    typedef std::tuple<bool, int, int> IndexBufferKey;
+
+    // owned jointly with the generation jobs, so a job finishing after the terrain is gone does no harm
+    struct SharedState {
+        std::shared_ptr<const HeightMap> heightMap;
+        std::mutex mutex;
+        std::vector<ChunkMesh> completed;
+    };
+
+    static ChunkGrid chunkGrid(ChunkKey key, int mapWidth, int mapHeight);
+    static ChunkMesh generateChunk(const HeightMap& heightMap, ChunkKey key);
+    void computeElevationRanges(const HeightMap& heightMap);
+    void select(ChunkKey key, glm::vec3 cameraPosition, const TerrainSettings& settings, float lodDistance,
+                std::vector<ChunkKey>& selection) const;
+    unsigned int chunkTriangles(ChunkKey key) const;
+    void buildDrawList(const std::vector<ChunkKey>& selection);
+    void cullDrawList(const Frustum& frustum);
+    void request(glm::vec3 cameraPosition);
+    void upload(Chunk& chunk, ChunkKey key, const TerrainMesh& mesh);
+    // binds the shared index buffer of the current mode to the vertex array of the chunk, which has to be bound
+    void bindIndexBuffer(ChunkKey key);
+    const IndexBuffer& indexBuffer(bool strips, int columns, int rows);
+    void release(Chunk& chunk);
+    bool isResident(ChunkKey key) const;
+    BoundingBox chunkBounds(ChunkKey key) const;
+    float distanceToChunk(glm::vec3 position, ChunkKey key) const;
+    glm::vec2 morphRange(int level) const;
+
+    ThreadPool& threadPool;
+    std::shared_ptr<SharedState> shared;
+    std::map<ChunkKey, Chunk> chunks;
+    std::map<IndexBufferKey, IndexBuffer> indexBuffers;
+    bool strips = true;
+    int mapWidth = 0;
+    int mapHeight = 0;
+    int rootLevel = 0;
+    // number of chunks along x and z on each level
+    std::vector<glm::ivec2> levelChunks;
+    // minimum and maximum elevation of each chunk on each level, used for the bounds before a chunk is resident
+    std::vector<std::vector<glm::vec2>> elevationRanges;
+
+    unsigned long frame = 0;
+    float selectedLodDistance = 0.0f;
+    bool budgetExceeded = false;
+    bool morphing = true;
+    std::vector<ChunkKey> drawList;
+    unsigned int drawnTriangles = 0;
+    size_t culledChunks = 0;
+    size_t occludedChunks = 0;
+    BoundingBoxList drawListBounds;
+    std::vector<unsigned char> drawListVisibility;
+};
+
+#endif // !TERRAIN_H
@@ -0,0 +1,181 @@
+#include "terrain_mesh.h"
+
+#include "mesh_optimizer.h"
+
+#include <algorithm>
+#include <cmath>
+
+// quads per band of the index order, two rows of band vertices fit into the simulated post transform cache
+const int TERRAIN_INDEX_BAND = VERTEX_CACHE_SIZE / 2 - 1;
+
+// elevations of the samples around one row of vertices for the normals. The rows are gathered from the heightmap
+// first, all arithmetic then runs over plain float arrays the compiler can vectorize.
+struct RowSamples {
+    std::vector<float> left, right;
+    std::vector<float> upCenter, downCenter;
+
+    explicit RowSamples(int columns) : left(columns), right(columns), upCenter(columns), downCenter(columns) {
+    }
+};
+
+void generateTerrainMesh(const HeightMap& heightMap, int x0, int z0, int stride, int columns, int rows,
+                         TerrainMesh& mesh) {
+    // exact size, every element is written below
+    mesh.vertices.resize(size_t(columns) * rows);
+
+    int lastColumn = heightMap.width() - 1;
+    int lastRow = heightMap.height() - 1;
+    std::vector<int> x(columns), xLeft(columns), xRight(columns);
+    for (int column = 0; column < columns; column++) {
+        x[column] = std::min(x0 + column * stride, lastColumn);
+        xLeft[column] = std::max(x[column] - stride, 0);
+        xRight[column] = std::min(x[column] + stride, lastColumn);
+    }
+
+    RowSamples samples(columns);
+    std::vector<int16_t> normalX(columns), normalZ(columns);
+    const float scale = HEIGHTMAP_ELEVATION_SCALE;
+    const float spacing = 2.0f * stride;
+    TerrainVertex* vertex = mesh.vertices.data();
+    for (int row = 0; row < rows; row++) {
+        int z = std::min(z0 + row * stride, lastRow);
+        const uint16_t* up = heightMap.row(z - stride);
+        const uint16_t* middle = heightMap.row(z);
+        const uint16_t* down = heightMap.row(z + stride);
+        for (int column = 0; column < columns; column++) {
+            samples.left[column] = middle[xLeft[column]] * scale;
+            samples.right[column] = middle[xRight[column]] * scale;
+            samples.upCenter[column] = up[x[column]] * scale;
+            samples.downCenter[column] = down[x[column]] * scale;
+        }
+
+        // normal (left - right, 2 * stride, up - down) projected onto the octahedron with y as its pole. Terrain
+        // normals always point up, so the lower half never has to be folded over.
+        for (int column = 0; column < columns; column++) {
+            float dx = samples.left[column] - samples.right[column];
+            float dz = samples.upCenter[column] - samples.downCenter[column];
+            float inverseLength = 32767.0f / (std::abs(dx) + spacing + std::abs(dz));
+            float x = dx * inverseLength;
+            float z = dz * inverseLength;
+            normalX[column] = int16_t(x + (x < 0.0f ? -0.5f : 0.5f));
+            normalZ[column] = int16_t(z + (z < 0.0f ? -0.5f : 0.5f));
+        }
+
+        // on the next coarser level only every second vertex exists, the others lie on its edges
+        bool oddRow = row % 2 == 1;
+        for (int column = 0; column < columns; column++, vertex++) {
+            bool oddColumn = column % 2 == 1;
+            unsigned int morph;
+            if (oddColumn && oddRow) {
+                // on the diagonal from the lower left to the upper right corner of the coarse quad
+                morph = (unsigned(down[xLeft[column]]) + up[xRight[column]] + 1) / 2;
+            } else if (oddColumn) {
+                morph = (unsigned(middle[xLeft[column]]) + middle[xRight[column]] + 1) / 2;
+            } else if (oddRow) {
+                morph = (unsigned(up[x[column]]) + down[x[column]] + 1) / 2;
+            } else {
+                morph = middle[x[column]];
+            }
+            vertex->height = middle[x[column]];
+            vertex->morphHeight = uint16_t(morph);
+            vertex->normal[0] = normalX[column];
+            vertex->normal[1] = normalZ[column];
+        }
+    }
+}
+
+void generateTerrainOccluder(const HeightMap& heightMap, int x0, int z0, int stride, int columns, int rows,
+                             int cellSize, std::vector<glm::vec3>& triangles) {
+    int lastColumn = heightMap.width() - 1;
+    int lastRow = heightMap.height() - 1;
+    int cellColumns = (columns - 2) / cellSize + 1;
+    int cellRows = (rows - 2) / cellSize + 1;
+
+    // lowest vertex of each cell, vertices on the border between two cells belong to both
+    std::vector<float> lowest(size_t(cellColumns) * cellRows, 1e30f);
+    for (int row = 0; row < rows; row++) {
+        int z = std::min(z0 + row * stride, lastRow);
+        int firstZ = row % cellSize == 0 && row > 0 ? row / cellSize - 1 : row / cellSize;
+        int lastZ = std::min(row / cellSize, cellRows - 1);
+        for (int column = 0; column < columns; column++) {
+            float elevation = heightMap.elevation(std::min(x0 + column * stride, lastColumn), z);
+            int firstX = column % cellSize == 0 && column > 0 ? column / cellSize - 1 : column / cellSize;
+            int lastX = std::min(column / cellSize, cellColumns - 1);
+            for (int cellZ = firstZ; cellZ <= lastZ; cellZ++) {
+                for (int cellX = firstX; cellX <= lastX; cellX++) {
+                    float& cell = lowest[cellX + cellZ * cellColumns];
+                    cell = std::min(cell, elevation);
+                }
+            }
+        }
+    }
+
+    // corners at the lowest of the cells around them, clamped to the edge of the map like the vertices
+    std::vector<glm::vec3> corners(size_t(cellColumns + 1) * (cellRows + 1));
+    for (int cornerZ = 0; cornerZ <= cellRows; cornerZ++) {
+        int z = std::min(z0 + std::min(cornerZ * cellSize, rows - 1) * stride, lastRow);
+        for (int cornerX = 0; cornerX <= cellColumns; cornerX++) {
+            int x = std::min(x0 + std::min(cornerX * cellSize, columns - 1) * stride, lastColumn);
+            float elevation = 1e30f;
+            for (int cellZ = std::max(cornerZ - 1, 0); cellZ <= std::min(cornerZ, cellRows - 1); cellZ++) {
+                for (int cellX = std::max(cornerX - 1, 0); cellX <= std::min(cornerX, cellColumns - 1); cellX++) {
+                    elevation = std::min(elevation, lowest[cellX + cellZ * cellColumns]);
+                }
+            }
+            corners[cornerX + cornerZ * (cellColumns + 1)] = glm::vec3(float(x), elevation, float(z));
+        }
+    }
+
+    for (int cellZ = 0; cellZ < cellRows; cellZ++) {
+        for (int cellX = 0; cellX < cellColumns; cellX++) {
+            const glm::vec3* top = &corners[cellX + cellZ * (cellColumns + 1)];
+            const glm::vec3* bottom = top + cellColumns + 1;
+            triangles.insert(triangles.end(), {top[0], bottom[0], top[1], bottom[0], bottom[1], top[1]});
+        }
+    }
+}
+
+void generateTerrainTriangles(int columns, int rows, std::vector<unsigned int>& indices) {
+    indices.resize(size_t(columns - 1) * (rows - 1) * 6);
+
+    // quads are emitted in vertical bands narrow enough that the vertices shared with the previous row of the band are
+    // still in the post transform cache, full rows would miss every vertex twice
+    unsigned int* index = indices.data();
+    for (int band = 0; band < columns - 1; band += TERRAIN_INDEX_BAND) {
+        int bandEnd = std::min(band + TERRAIN_INDEX_BAND, columns - 1);
+        for (int row = 0; row < rows - 1; row++) {
+            for (int column = band; column < bandEnd; column++) {
+                unsigned int topLeft = column + row * columns;
+                unsigned int bottomLeft = column + (row + 1) * columns;
+                // upper left triangle
+                index[0] = topLeft;
+                index[1] = bottomLeft;
+                index[2] = topLeft + 1;
+                // lower right triangle
+                index[3] = bottomLeft;
+                index[4] = bottomLeft + 1;
+                index[5] = topLeft + 1;
+                index += 6;
+            }
+        }
+    }
+}
+
+void generateTerrainStrips(int columns, int rows, std::vector<uint16_t>& indices) {
+    indices.clear();
+
+    // same band order as generateTerrainTriangles, one strip zig-zagging between two rows of vertices per row of a
+    // band. GL flips every second triangle of a strip, so all triangles keep the winding of the triangle lists.
+    for (int band = 0; band < columns - 1; band += TERRAIN_INDEX_BAND) {
+        int bandEnd = std::min(band + TERRAIN_INDEX_BAND, columns - 1);
+        for (int row = 0; row < rows - 1; row++) {
+            if (!indices.empty()) {
+                indices.push_back(TERRAIN_RESTART_INDEX);
+            }
+            for (int column = band; column <= bandEnd; column++) {
+                indices.push_back(uint16_t(column + row * columns));
+                indices.push_back(uint16_t(column + (row + 1) * columns));
+            }
+        }
+    }
+}
@@ -0,0 +1,51 @@
+#ifndef TERRAIN_MESH_H
+#define TERRAIN_MESH_H
+
+#include "heightmap.h"
+
+#include <cstdint>
+#include <vector>
+
+#include <glm/vec3.hpp>
+
+// 8 bytes instead of 28 for float position, morph height and normal. x and z are not stored, the vertex shader
+// derives them from gl_VertexID and the grid of the patch (x0, z0, stride and columns).
+struct TerrainVertex {
+    // heightmap samples, multiplied by HEIGHTMAP_ELEVATION_SCALE in the vertex shader
+    uint16_t height;
+    // elevation of this vertex on the mesh of the next coarser level, the vertex shader morphs towards it
+    uint16_t morphHeight;
+    // smooth normal from the central differences of the neighboring vertices, x and z of its octahedral encoding with
+    // y as the pole
+    int16_t normal[2];
+};
+
+// separates the strips generated by generateTerrainStrips
+const uint16_t TERRAIN_RESTART_INDEX = 0xFFFF;
+
+// vertices of a rectangular patch of a heightmap. The indices only depend on the number of vertices, so they are
+// generated separately and shared by all patches of the same size.
+struct TerrainMesh {
+    std::vector<TerrainVertex> vertices;
+};
+
+// columns x rows vertices starting at sample x0, z0 with stride samples between neighboring vertices, vertex i lies
+// at column i % columns and row i / columns. Positions outside the map are clamped to its edge. The storage of mesh
+// is reused, so generating many patches into the same mesh does not allocate.
+void generateTerrainMesh(const HeightMap& heightMap, int x0, int z0, int stride, int columns, int rows,
+                         TerrainMesh& mesh);
+
+// conservative occluder of the same patch as generateTerrainMesh with two triangles per cell of cellSize x cellSize
+// quads, appended to triangles as three positions each. A corner of a cell lies at the lowest vertex of the cells
+// around it, so the occluder stays below the patch, also while it morphs, since the morph heights of a vertex are
+// averages of vertices of its cell. Cells on the far border of the patch can be smaller.
+void generateTerrainOccluder(const HeightMap& heightMap, int x0, int z0, int stride, int columns, int rows,
+                             int cellSize, std::vector<glm::vec3>& triangles);
+
+// two triangles per quad of a columns x rows patch, 24 bytes per quad
+void generateTerrainTriangles(int columns, int rows, std::vector<unsigned int>& indices);
+// one triangle strip per row of a band of quads, separated by TERRAIN_RESTART_INDEX. About 5 bytes per quad, the patch
+// must have fewer than 0xFFFF vertices.
+void generateTerrainStrips(int columns, int rows, std::vector<uint16_t>& indices);
+
+#endif // !TERRAIN_MESH_H
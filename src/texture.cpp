@@ -1,5 +1,7 @@
 #include "texture.h"
 
+#include "render_state.h"
+
 #include <stb_image.h>
 
 #include <fmt/format.h>
@@ -7,17 +9,73 @@ using namespace fmt;
 
 #include <stdexcept>
 
-Texture Texture::loadFromFile(const std::string& path) {
-    Texture texture;
+bool isTextureFormatSupported(TextureFormat format) {
+    switch (format) {
+    case TextureFormat::Rgba8:
+        return true;
+    case TextureFormat::Bc1:
+    case TextureFormat::Bc3:
+        return GLEW_EXT_texture_compression_s3tc;
+    case TextureFormat::Bc7:
+        return GLEW_ARB_texture_compression_bptc;
+    }
+    return false;
+}
+
+void uploadTextureLevel(TextureFormat format, int level, int width, int height, const unsigned char* pixels,
+                        size_t size) {
+    if (isCompressed(format)) {
+        glCompressedTexImage2D(GL_TEXTURE_2D, level, textureInternalFormat(format), width, height, 0, GLsizei(size),
+                               pixels);
+    } else {
+        glTexImage2D(GL_TEXTURE_2D, level, GLint(textureInternalFormat(format)), width, height, 0, GL_RGBA,
+                     GL_UNSIGNED_BYTE, pixels);
+    }
+}
+
+TextureImage TextureImage::loadFromFile(const std::string& path) {
+    TextureImage image;
+    std::shared_ptr<const TextureCache> cache = TextureCache::open(TextureCache::pathFor(path), path);
+    if (cache && isTextureFormatSupported(cache->textureFormat())) {
+        image.width = cache->width();
+        image.height = cache->height();
+        image.channels = cache->textureFormat() == TextureFormat::Bc1 ? 3 : 4;
+        image.cache = std::move(cache);
+        return image;
+    }
 
-    int width, height, nrChannels;
-    unsigned char* data = stbi_load(path.c_str(), &width, &height, &nrChannels, 0);
+    unsigned char* data = stbi_load(path.c_str(), &image.width, &image.height, &image.channels, 0);
     if (!data) {
         throw std::runtime_error(format("Failed to load texture {}", path));
     }
+    image.pixels.assign(data, data + size_t(image.width) * image.height * image.channels);
+    stbi_image_free(data);
+    return image;
+}
+
+TextureImage TextureImage::solidColor(unsigned char red, unsigned char green, unsigned char blue) {
+    TextureImage image;
+    image.width = 1;
+    image.height = 1;
+    image.channels = 4;
+    image.pixels = {red, green, blue, 255};
+    return image;
+}
+
+Texture Texture::loadFromFile(const std::string& path) {
+    return fromImage(TextureImage::loadFromFile(path));
+}
+
+Texture Texture::fromImage(const TextureImage& image) {
+    static const GLenum FORMATS[] = {GL_RED, GL_RG, GL_RGB, GL_RGBA};
+    if (!image.cache && (image.channels < 1 || image.channels > 4)) {
+        throw std::runtime_error(format("Textures with {} channels are not supported", image.channels));
+    }
+    GLenum pixelFormat = FORMATS[image.channels - 1];
 
+    Texture texture;
     glGenTextures(1, &texture.handle);
-    glBindTexture(GL_TEXTURE_2D, texture.handle);
+    renderState.bindTexture(0, texture.handle);
 
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
@@ -25,14 +83,26 @@ Texture Texture::loadFromFile(const std::string& path) {
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
     glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAX_ANISOTROPY, 16.0f);
 
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-    glGenerateMipmap(GL_TEXTURE_2D);
+    if (image.cache) {
+        const TextureCache& cache = *image.cache;
+        for (size_t level = 0; level < cache.levelCount(); level++) {
+            uploadTextureLevel(cache.textureFormat(), int(level), cache.levelWidth(level), cache.levelHeight(level),
+                               cache.levelData(level), cache.levelSize(level));
+        }
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, GLint(cache.levelCount()) - 1);
+        texture.bytes = cache.dataSize();
+        return texture;
+    }
 
-    stbi_image_free(data);
+    glTexImage2D(GL_TEXTURE_2D, 0, pixelFormat, image.width, image.height, 0, pixelFormat, GL_UNSIGNED_BYTE,
+                 image.pixels.data());
+    glGenerateMipmap(GL_TEXTURE_2D);
+    // a full mip chain adds a third
+    texture.bytes = size_t(image.width) * image.height * 4 * 4 / 3;
 
     return texture;
 }
 
-void Texture::bind() {
-    glBindTexture(GL_TEXTURE_2D, this->handle);
+void Texture::bind(unsigned int unit) const {
+    renderState.bindTexture(unit, this->handle);
 }
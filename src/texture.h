@@ -1,19 +1,55 @@
 #ifndef TEXTURE_H
 #define TEXTURE_H
 
+#include "texture_cache.h"
+
 #include <GL/glew.h>
 
+#include <memory>
 #include <string>
+#include <vector>
+
+// decoded 8 bit image or a cooked texture, does not need an OpenGL context so it can be loaded on any thread
+struct TextureImage {
+    int width = 0;
+    int height = 0;
+    // 1 to 4
+    int channels = 0;
+    std::vector<unsigned char> pixels;
+    // cooked mip levels, pixels is empty if set
+    std::shared_ptr<const TextureCache> cache;
+
+    // maps the cooked texture next to path if it is current and the driver supports its format, decodes path otherwise
+    static TextureImage loadFromFile(const std::string& path);
+    // 1x1 RGBA image, e.g. for placeholders
+    static TextureImage solidColor(unsigned char red, unsigned char green, unsigned char blue);
+};
+
+// uploads one level of the bound GL_TEXTURE_2D, pixels are RGBA for Rgba8
+void uploadTextureLevel(TextureFormat format, int level, int width, int height, const unsigned char* pixels,
+                        size_t size);
+// the S3TC extension is available on practically every desktop driver, BPTC is core since OpenGL 4.2
+bool isTextureFormatSupported(TextureFormat format);
 
 class Texture {
 public:
     static Texture loadFromFile(const std::string& path);
+    // uploads the cooked levels of image as they are or uploads its pixels and generates the mipmaps on the GPU
+    static Texture fromImage(const TextureImage& image);
 
-    void bind();
+    void bind(unsigned int unit = 0) const;
+    GLuint id() const {
+        return this->handle;
+    }
+    // memory of all levels on the GPU, uncompressed textures are counted with 4 bytes per pixel like drivers store them
+    size_t byteSize() const {
+        return this->bytes;
+    }
 
 private:
     Texture() = default;
     GLuint handle = 0;
+    size_t bytes = 0;
 };
 
 #endif // !TEXTURE_H
@@ -0,0 +1,199 @@
+#include "texture_cache.h"
+
+#include "source_stamp.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <ostream>
+#include <stdexcept>
+#include <utility>
+
+#include <GL/glew.h>
+
+#include <fmt/format.h>
+using namespace fmt;
+
+static const unsigned char KTX_IDENTIFIER[12] = {0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB, '\r', '\n', 0x1A, '\n'};
+static const uint32_t KTX_ENDIANNESS = 0x04030201;
+static const char TEXTURE_CACHE_SOURCE_KEY[] = "opengl.source";
+// larger than any GPU supports, keeps the sizes of the levels of a corrupt header far from overflowing
+static const uint32_t KTX_MAX_DIMENSION = 65536;
+
+static_assert(sizeof(KtxHeader) == 64, "KTX header has to be 64 bytes");
+static_assert(sizeof(TextureCacheSource) == 32, "TextureCacheSource layout changed, bump TEXTURE_CACHE_VERSION");
+
+static uint32_t alignKtx(uint32_t size) {
+    return (size + 3) / 4 * 4;
+}
+
+// floor(log2(max(width, height))) + 1, the full mip chain down to 1x1
+static uint32_t maxMipmapLevels(uint32_t width, uint32_t height) {
+    uint32_t levels = 1;
+    for (uint32_t size = std::max(width, height); size > 1; size >>= 1) {
+        levels++;
+    }
+    return levels;
+}
+
+std::string TextureCache::pathFor(const std::string& sourcePath) {
+    return sourcePath + ".ktx";
+}
+
+std::unique_ptr<TextureCache> TextureCache::open(const std::string& cachePath, const std::string& sourcePath) {
+    SourceStamp cacheStamp;
+    if (!stampSource(cachePath, cacheStamp) || cacheStamp.size < sizeof(KtxHeader)) {
+        return nullptr;
+    }
+
+    std::unique_ptr<TextureCache> cache(new TextureCache(MappedFile::open(cachePath)));
+    const KtxHeader* header = cache->header;
+    if (memcmp(header->identifier, KTX_IDENTIFIER, sizeof(KTX_IDENTIFIER)) != 0 ||
+        header->endianness != KTX_ENDIANNESS || header->pixelDepth != 0 || header->numberOfArrayElements != 0 ||
+        header->numberOfFaces != 1 || header->pixelWidth == 0 || header->pixelHeight == 0 ||
+        header->pixelWidth > KTX_MAX_DIMENSION || header->pixelHeight > KTX_MAX_DIMENSION ||
+        header->numberOfMipmapLevels == 0 ||
+        header->numberOfMipmapLevels > maxMipmapLevels(header->pixelWidth, header->pixelHeight) ||
+        !textureFormatFromInternal(header->glInternalFormat, cache->cachedFormat)) {
+        return nullptr;
+    }
+
+    // the key/value data has to start with the source written by write
+    const unsigned char* data = cache->file.data();
+    uint64_t fileSize = cache->file.size();
+    uint64_t keyValueOffset = sizeof(KtxHeader);
+    uint64_t levelOffset = keyValueOffset + header->bytesOfKeyValueData;
+    uint32_t pairSize = 0;
+    if (levelOffset > fileSize || header->bytesOfKeyValueData < sizeof(uint32_t)) {
+        return nullptr;
+    }
+    memcpy(&pairSize, data + keyValueOffset, sizeof(pairSize));
+    if (pairSize != sizeof(TEXTURE_CACHE_SOURCE_KEY) + sizeof(TextureCacheSource) ||
+        keyValueOffset + sizeof(uint32_t) + pairSize > levelOffset ||
+        memcmp(data + keyValueOffset + sizeof(uint32_t), TEXTURE_CACHE_SOURCE_KEY, sizeof(TEXTURE_CACHE_SOURCE_KEY)) !=
+            0) {
+        return nullptr;
+    }
+    TextureCacheSource source;
+    memcpy(&source, data + keyValueOffset + sizeof(uint32_t) + sizeof(TEXTURE_CACHE_SOURCE_KEY), sizeof(source));
+    if (source.version != TEXTURE_CACHE_VERSION) {
+        return nullptr;
+    }
+
+    // every level is its size followed by its data
+    for (uint32_t level = 0; level < header->numberOfMipmapLevels; level++) {
+        uint32_t imageSize = 0;
+        if (levelOffset + sizeof(uint32_t) > fileSize) {
+            return nullptr;
+        }
+        memcpy(&imageSize, data + levelOffset, sizeof(imageSize));
+        cache->levels.push_back(levelOffset + sizeof(uint32_t));
+        if (imageSize != cache->levelSize(level) || levelOffset + sizeof(uint32_t) + imageSize > fileSize) {
+            return nullptr;
+        }
+        levelOffset += sizeof(uint32_t) + alignKtx(imageSize);
+    }
+
+    SourceStamp stamp;
+    stamp.size = source.sourceSize;
+    stamp.modificationTime = source.sourceModificationTime;
+    uint64_t stampOffset = keyValueOffset + sizeof(uint32_t) + sizeof(TEXTURE_CACHE_SOURCE_KEY) +
+                           offsetof(TextureCacheSource, sourceSize);
+    if (!isCookedFrom(sourcePath, stamp, source.sourceHash, cachePath, stampOffset)) {
+        return nullptr;
+    }
+    return cache;
+}
+
+void TextureCache::write(const std::string& cachePath, const std::string& sourcePath, TextureFormat textureFormat,
+                         const std::vector<TextureLevel>& levels) {
+    SourceStamp sourceStamp;
+    if (!stampSource(sourcePath, sourceStamp)) {
+        throw std::runtime_error(format("Failed to read source of texture cache {}", sourcePath));
+    }
+    if (levels.empty()) {
+        throw std::runtime_error(format("Texture cache {} needs at least one level", cachePath));
+    }
+
+    KtxHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.identifier, KTX_IDENTIFIER, sizeof(KTX_IDENTIFIER));
+    header.endianness = KTX_ENDIANNESS;
+    // compressed formats have no type and format
+    header.glType = isCompressed(textureFormat) ? 0 : GL_UNSIGNED_BYTE;
+    header.glTypeSize = 1;
+    header.glFormat = isCompressed(textureFormat) ? 0 : GL_RGBA;
+    header.glInternalFormat = textureInternalFormat(textureFormat);
+    header.glBaseInternalFormat = textureFormat == TextureFormat::Bc1 ? GL_RGB : GL_RGBA;
+    header.pixelWidth = static_cast<uint32_t>(levels[0].width);
+    header.pixelHeight = static_cast<uint32_t>(levels[0].height);
+    header.numberOfFaces = 1;
+    header.numberOfMipmapLevels = static_cast<uint32_t>(levels.size());
+
+    TextureCacheSource source;
+    memset(&source, 0, sizeof(source));
+    source.version = TEXTURE_CACHE_VERSION;
+    source.sourceSize = sourceStamp.size;
+    source.sourceModificationTime = sourceStamp.modificationTime;
+    source.sourceHash = hashFile(sourcePath);
+    uint32_t pairSize = sizeof(TEXTURE_CACHE_SOURCE_KEY) + sizeof(TextureCacheSource);
+    header.bytesOfKeyValueData = alignKtx(sizeof(uint32_t) + pairSize);
+
+    bool written = writeCookedFile(cachePath, [&](std::ostream& out) {
+        static const char padding[4] = {};
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(&pairSize), sizeof(pairSize));
+        out.write(TEXTURE_CACHE_SOURCE_KEY, sizeof(TEXTURE_CACHE_SOURCE_KEY));
+        out.write(reinterpret_cast<const char*>(&source), sizeof(source));
+        out.write(padding, header.bytesOfKeyValueData - sizeof(uint32_t) - pairSize);
+        for (const auto& level : levels) {
+            uint32_t imageSize = static_cast<uint32_t>(level.pixels.size());
+            if (imageSize != textureLevelSize(textureFormat, level.width, level.height)) {
+                throw std::runtime_error(format("Level of {}x{} pixels is not encoded as {}", level.width,
+                                                level.height, textureFormatName(textureFormat)));
+            }
+            out.write(reinterpret_cast<const char*>(&imageSize), sizeof(imageSize));
+            out.write(reinterpret_cast<const char*>(level.pixels.data()), imageSize);
+            out.write(padding, alignKtx(imageSize) - imageSize);
+        }
+    });
+    if (!written) {
+        throw std::runtime_error(format("Failed to write texture cache {}", cachePath));
+    }
+}
+
+TextureCache::TextureCache(MappedFile file) : file(std::move(file)) {
+    this->header = reinterpret_cast<const KtxHeader*>(this->file.data());
+}
+
+int TextureCache::width() const {
+    return int(this->header->pixelWidth);
+}
+
+int TextureCache::height() const {
+    return int(this->header->pixelHeight);
+}
+
+int TextureCache::levelWidth(size_t level) const {
+    return std::max(1, this->width() >> level);
+}
+
+int TextureCache::levelHeight(size_t level) const {
+    return std::max(1, this->height() >> level);
+}
+
+const unsigned char* TextureCache::levelData(size_t level) const {
+    return this->file.data() + this->levels[level];
+}
+
+size_t TextureCache::levelSize(size_t level) const {
+    return textureLevelSize(this->cachedFormat, this->levelWidth(level), this->levelHeight(level));
+}
+
+size_t TextureCache::dataSize() const {
+    size_t size = 0;
+    for (size_t level = 0; level < this->levels.size(); level++) {
+        size += this->levelSize(level);
+    }
+    return size;
+}
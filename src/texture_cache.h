@@ -0,0 +1,78 @@
+#ifndef TEXTURE_CACHE_H
+#define TEXTURE_CACHE_H
+
+#include "mapped_file.h"
+#include "texture_format.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// bump whenever cooking produces different data
+const uint32_t TEXTURE_CACHE_VERSION = 1;
+
+// KTX 1.1 header, all fields are in the byte order given by endianness
+struct KtxHeader {
+    unsigned char identifier[12];
+    uint32_t endianness;
+    uint32_t glType;
+    uint32_t glTypeSize;
+    uint32_t glFormat;
+    uint32_t glInternalFormat;
+    uint32_t glBaseInternalFormat;
+    uint32_t pixelWidth;
+    uint32_t pixelHeight;
+    uint32_t pixelDepth;
+    uint32_t numberOfArrayElements;
+    uint32_t numberOfFaces;
+    uint32_t numberOfMipmapLevels;
+    uint32_t bytesOfKeyValueData;
+};
+
+// value of the key/value pair naming the source the texture was cooked from
+struct TextureCacheSource {
+    uint32_t version;
+    uint32_t padding;
+    uint64_t sourceSize;
+    int64_t sourceModificationTime;
+    uint64_t sourceHash;
+};
+
+// memory mapped KTX file of a cooked texture with all of its mip levels, which are uploaded as they are stored
+class TextureCache {
+public:
+    static std::string pathFor(const std::string& sourcePath);
+
+    // returns nullptr if there is no cache file, if it is outdated or not in a format written by write
+    static std::unique_ptr<TextureCache> open(const std::string& cachePath, const std::string& sourcePath);
+    // levels have to be encoded in textureFormat, from the full size level down to 1x1
+    static void write(const std::string& cachePath, const std::string& sourcePath, TextureFormat textureFormat,
+                      const std::vector<TextureLevel>& levels);
+
+    TextureFormat textureFormat() const {
+        return this->cachedFormat;
+    }
+    int width() const;
+    int height() const;
+    size_t levelCount() const {
+        return this->levels.size();
+    }
+    int levelWidth(size_t level) const;
+    int levelHeight(size_t level) const;
+    const unsigned char* levelData(size_t level) const;
+    size_t levelSize(size_t level) const;
+    // all levels, what the texture occupies on the GPU
+    size_t dataSize() const;
+
+private:
+    explicit TextureCache(MappedFile file);
+
+    MappedFile file;
+    const KtxHeader* header = nullptr;
+    TextureFormat cachedFormat = TextureFormat::Rgba8;
+    // offset of the data of each level
+    std::vector<uint64_t> levels;
+};
+
+#endif // !TEXTURE_CACHE_H
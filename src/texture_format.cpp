@@ -0,0 +1,511 @@
+#include "texture_format.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+#include <GL/glew.h>
+
+#include <fmt/format.h>
+using namespace fmt;
+
+#ifndef GL_COMPRESSED_RGBA_BPTC_UNORM
+#define GL_COMPRESSED_RGBA_BPTC_UNORM 0x8E8C
+#endif
+
+const TextureFormat TEXTURE_FORMATS[] = {TextureFormat::Rgba8, TextureFormat::Bc1, TextureFormat::Bc3,
+                                         TextureFormat::Bc7};
+
+// interpolation weights of BC7 4 bit indices, out of 64
+const int BC7_WEIGHTS[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+const char* textureFormatName(TextureFormat format) {
+    switch (format) {
+    case TextureFormat::Rgba8:
+        return "rgba8";
+    case TextureFormat::Bc1:
+        return "bc1";
+    case TextureFormat::Bc3:
+        return "bc3";
+    case TextureFormat::Bc7:
+        return "bc7";
+    }
+    return "unknown";
+}
+
+TextureFormat parseTextureFormat(const std::string& name) {
+    for (TextureFormat format : TEXTURE_FORMATS) {
+        if (name == textureFormatName(format)) {
+            return format;
+        }
+    }
+    throw std::runtime_error(format("Unknown texture format {}, expected rgba8, bc1, bc3 or bc7", name));
+}
+
+unsigned int textureInternalFormat(TextureFormat format) {
+    switch (format) {
+    case TextureFormat::Rgba8:
+        return GL_RGBA8;
+    case TextureFormat::Bc1:
+        return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+    case TextureFormat::Bc3:
+        return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+    case TextureFormat::Bc7:
+        return GL_COMPRESSED_RGBA_BPTC_UNORM;
+    }
+    return 0;
+}
+
+bool textureFormatFromInternal(unsigned int internalFormat, TextureFormat& format) {
+    for (TextureFormat candidate : TEXTURE_FORMATS) {
+        if (textureInternalFormat(candidate) == internalFormat) {
+            format = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool isCompressed(TextureFormat format) {
+    return format != TextureFormat::Rgba8;
+}
+
+static size_t blockSize(TextureFormat format) {
+    return format == TextureFormat::Bc1 ? 8 : 16;
+}
+
+size_t textureLevelSize(TextureFormat format, int width, int height) {
+    if (!isCompressed(format)) {
+        return size_t(width) * height * 4;
+    }
+    return size_t((width + 3) / 4) * ((height + 3) / 4) * blockSize(format);
+}
+
+std::vector<TextureLevel> generateMipmaps(const unsigned char* rgba, int width, int height) {
+    std::vector<TextureLevel> levels(1);
+    levels[0].width = width;
+    levels[0].height = height;
+    levels[0].pixels.assign(rgba, rgba + size_t(width) * height * 4);
+
+    while (levels.back().width > 1 || levels.back().height > 1) {
+        const TextureLevel& source = levels.back();
+        TextureLevel level;
+        level.width = std::max(1, source.width / 2);
+        level.height = std::max(1, source.height / 2);
+        level.pixels.resize(size_t(level.width) * level.height * 4);
+        for (int y = 0; y < level.height; y++) {
+            // odd sizes drop the last row or column, 1 pixel wide levels average the same pixel twice
+            int y0 = std::min(y * 2, source.height - 1);
+            int y1 = std::min(y * 2 + 1, source.height - 1);
+            for (int x = 0; x < level.width; x++) {
+                int x0 = std::min(x * 2, source.width - 1);
+                int x1 = std::min(x * 2 + 1, source.width - 1);
+                const unsigned char* p00 = &source.pixels[(size_t(y0) * source.width + x0) * 4];
+                const unsigned char* p01 = &source.pixels[(size_t(y0) * source.width + x1) * 4];
+                const unsigned char* p10 = &source.pixels[(size_t(y1) * source.width + x0) * 4];
+                const unsigned char* p11 = &source.pixels[(size_t(y1) * source.width + x1) * 4];
+                unsigned char* target = &level.pixels[(size_t(y) * level.width + x) * 4];
+                for (int c = 0; c < 4; c++) {
+                    target[c] = static_cast<unsigned char>((p00[c] + p01[c] + p10[c] + p11[c] + 2) / 4);
+                }
+            }
+        }
+        levels.push_back(std::move(level));
+    }
+    return levels;
+}
+
+TextureFormat chooseTextureFormat(const unsigned char* rgba, int width, int height) {
+    size_t pixels = size_t(width) * height;
+    for (size_t i = 0; i < pixels; i++) {
+        if (rgba[i * 4 + 3] != 255) {
+            return TextureFormat::Bc3;
+        }
+    }
+    return TextureFormat::Bc1;
+}
+
+size_t textureBlockRows(const TextureLevel& level) {
+    return size_t((level.height + 3) / 4);
+}
+
+// 4x4 pixels of a level as floats, pixels outside of the level repeat the last row or column
+struct Block {
+    float pixels[16][4];
+};
+
+static Block fetchBlock(const TextureLevel& level, int blockX, int blockY) {
+    Block block;
+    for (int y = 0; y < 4; y++) {
+        int sourceY = std::min(blockY * 4 + y, level.height - 1);
+        for (int x = 0; x < 4; x++) {
+            int sourceX = std::min(blockX * 4 + x, level.width - 1);
+            const unsigned char* pixel = &level.pixels[(size_t(sourceY) * level.width + sourceX) * 4];
+            for (int c = 0; c < 4; c++) {
+                block.pixels[y * 4 + x][c] = pixel[c];
+            }
+        }
+    }
+    return block;
+}
+
+// principal axis of the first channels of the pixels by power iteration, returns the mean in mean
+static void principalAxis(const Block& block, int channels, float mean[4], float axis[4]) {
+    for (int c = 0; c < 4; c++) {
+        mean[c] = 0.0f;
+        axis[c] = 0.0f;
+    }
+    float minimum[4] = {255.0f, 255.0f, 255.0f, 255.0f};
+    float maximum[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+    for (const auto& pixel : block.pixels) {
+        for (int c = 0; c < channels; c++) {
+            mean[c] += pixel[c] / 16.0f;
+            minimum[c] = std::min(minimum[c], pixel[c]);
+            maximum[c] = std::max(maximum[c], pixel[c]);
+        }
+    }
+    float covariance[4][4] = {};
+    for (const auto& pixel : block.pixels) {
+        for (int i = 0; i < channels; i++) {
+            for (int j = 0; j < channels; j++) {
+                covariance[i][j] += (pixel[i] - mean[i]) * (pixel[j] - mean[j]);
+            }
+        }
+    }
+
+    // the diagonal of the bounding box is a good start and keeps the axis for blocks of a single color
+    for (int c = 0; c < channels; c++) {
+        axis[c] = maximum[c] - minimum[c];
+    }
+    for (int iteration = 0; iteration < 8; iteration++) {
+        float next[4] = {};
+        float length = 0.0f;
+        for (int i = 0; i < channels; i++) {
+            for (int j = 0; j < channels; j++) {
+                next[i] += covariance[i][j] * axis[j];
+            }
+            length = std::max(length, std::abs(next[i]));
+        }
+        if (length < 1e-6f) {
+            break;
+        }
+        for (int c = 0; c < channels; c++) {
+            axis[c] = next[c] / length;
+        }
+    }
+    float length = 0.0f;
+    for (int c = 0; c < channels; c++) {
+        length += axis[c] * axis[c];
+    }
+    length = std::sqrt(length);
+    for (int c = 0; c < channels; c++) {
+        axis[c] = length > 0.0f ? axis[c] / length : 0.0f;
+    }
+}
+
+// endpoints at the extremes of the projection of the pixels onto the principal axis
+static void fitEndpoints(const Block& block, int channels, float first[4], float second[4]) {
+    float mean[4];
+    float axis[4];
+    principalAxis(block, channels, mean, axis);
+    float minimum = 0.0f;
+    float maximum = 0.0f;
+    for (const auto& pixel : block.pixels) {
+        float t = 0.0f;
+        for (int c = 0; c < channels; c++) {
+            t += (pixel[c] - mean[c]) * axis[c];
+        }
+        minimum = std::min(minimum, t);
+        maximum = std::max(maximum, t);
+    }
+    for (int c = 0; c < 4; c++) {
+        first[c] = c < channels ? std::min(255.0f, std::max(0.0f, mean[c] + axis[c] * maximum)) : 255.0f;
+        second[c] = c < channels ? std::min(255.0f, std::max(0.0f, mean[c] + axis[c] * minimum)) : 255.0f;
+    }
+}
+
+static float squaredError(const float* a, const float* b, int channels) {
+    float error = 0.0f;
+    for (int c = 0; c < channels; c++) {
+        error += (a[c] - b[c]) * (a[c] - b[c]);
+    }
+    return error;
+}
+
+static uint16_t packRgb565(const float color[4]) {
+    int red = int(std::round(color[0] * 31.0f / 255.0f));
+    int green = int(std::round(color[1] * 63.0f / 255.0f));
+    int blue = int(std::round(color[2] * 31.0f / 255.0f));
+    return static_cast<uint16_t>((red << 11) | (green << 5) | blue);
+}
+
+static void unpackRgb565(uint16_t packed, float color[4]) {
+    int red = (packed >> 11) & 31;
+    int green = (packed >> 5) & 63;
+    int blue = packed & 31;
+    color[0] = float((red << 3) | (red >> 2));
+    color[1] = float((green << 2) | (green >> 4));
+    color[2] = float((blue << 3) | (blue >> 2));
+    color[3] = 255.0f;
+}
+
+// picks the closest of the four colors of two 565 endpoints for every pixel, returns the total error
+static float selectBc1Indices(const Block& block, uint16_t color0, uint16_t color1, uint32_t& indices) {
+    float palette[4][4];
+    unpackRgb565(color0, palette[0]);
+    unpackRgb565(color1, palette[1]);
+    for (int c = 0; c < 3; c++) {
+        palette[2][c] = (2.0f * palette[0][c] + palette[1][c]) / 3.0f;
+        palette[3][c] = (palette[0][c] + 2.0f * palette[1][c]) / 3.0f;
+    }
+    indices = 0;
+    float total = 0.0f;
+    for (int i = 0; i < 16; i++) {
+        int best = 0;
+        float bestError = squaredError(block.pixels[i], palette[0], 3);
+        for (int index = 1; index < 4; index++) {
+            float error = squaredError(block.pixels[i], palette[index], 3);
+            if (error < bestError) {
+                best = index;
+                bestError = error;
+            }
+        }
+        indices |= uint32_t(best) << (i * 2);
+        total += bestError;
+    }
+    return total;
+}
+
+// four color mode needs color0 > color1, equal endpoints use index 0 for every pixel which is valid in both modes
+static float encodeBc1Endpoints(const Block& block, const float first[4], const float second[4], uint16_t& color0,
+                                uint16_t& color1, uint32_t& indices) {
+    color0 = packRgb565(first);
+    color1 = packRgb565(second);
+    if (color0 < color1) {
+        std::swap(color0, color1);
+    }
+    if (color0 == color1) {
+        indices = 0;
+        float palette[4];
+        unpackRgb565(color0, palette);
+        float total = 0.0f;
+        for (const auto& pixel : block.pixels) {
+            total += squaredError(pixel, palette, 3);
+        }
+        return total;
+    }
+    return selectBc1Indices(block, color0, color1, indices);
+}
+
+// BC1 color block, endpoints along the principal axis refined once by least squares on the chosen indices
+static void encodeBc1(const Block& block, unsigned char* output) {
+    float first[4];
+    float second[4];
+    fitEndpoints(block, 3, first, second);
+    uint16_t color0;
+    uint16_t color1;
+    uint32_t indices;
+    float error = encodeBc1Endpoints(block, first, second, color0, color1, indices);
+
+    if (error > 0.0f && color0 != color1) {
+        // weight of color0 for each index
+        static const float WEIGHTS[4] = {1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f};
+        float aa = 0.0f;
+        float ab = 0.0f;
+        float bb = 0.0f;
+        float ax[3] = {};
+        float bx[3] = {};
+        for (int i = 0; i < 16; i++) {
+            float a = WEIGHTS[(indices >> (i * 2)) & 3];
+            float b = 1.0f - a;
+            aa += a * a;
+            ab += a * b;
+            bb += b * b;
+            for (int c = 0; c < 3; c++) {
+                ax[c] += a * block.pixels[i][c];
+                bx[c] += b * block.pixels[i][c];
+            }
+        }
+        float determinant = aa * bb - ab * ab;
+        if (std::abs(determinant) > 1e-6f) {
+            float refinedFirst[4] = {0.0f, 0.0f, 0.0f, 255.0f};
+            float refinedSecond[4] = {0.0f, 0.0f, 0.0f, 255.0f};
+            for (int c = 0; c < 3; c++) {
+                refinedFirst[c] = std::min(255.0f, std::max(0.0f, (ax[c] * bb - bx[c] * ab) / determinant));
+                refinedSecond[c] = std::min(255.0f, std::max(0.0f, (bx[c] * aa - ax[c] * ab) / determinant));
+            }
+            uint16_t refinedColor0;
+            uint16_t refinedColor1;
+            uint32_t refinedIndices;
+            float refinedError =
+                encodeBc1Endpoints(block, refinedFirst, refinedSecond, refinedColor0, refinedColor1, refinedIndices);
+            if (refinedError < error) {
+                color0 = refinedColor0;
+                color1 = refinedColor1;
+                indices = refinedIndices;
+            }
+        }
+    }
+
+    output[0] = static_cast<unsigned char>(color0 & 0xFF);
+    output[1] = static_cast<unsigned char>(color0 >> 8);
+    output[2] = static_cast<unsigned char>(color1 & 0xFF);
+    output[3] = static_cast<unsigned char>(color1 >> 8);
+    for (int i = 0; i < 4; i++) {
+        output[4 + i] = static_cast<unsigned char>(indices >> (i * 8));
+    }
+}
+
+// BC4 block of the alpha channel in the 8 value mode, alpha0 is the maximum and alpha1 the minimum
+static void encodeBc3Alpha(const Block& block, unsigned char* output) {
+    float minimum = 255.0f;
+    float maximum = 0.0f;
+    for (const auto& pixel : block.pixels) {
+        minimum = std::min(minimum, pixel[3]);
+        maximum = std::max(maximum, pixel[3]);
+    }
+    int alpha0 = int(maximum);
+    int alpha1 = int(minimum);
+    uint64_t bits = uint64_t(alpha0) | (uint64_t(alpha1) << 8);
+    if (alpha0 > alpha1) {
+        for (int i = 0; i < 16; i++) {
+            // 0 at alpha0 to 7 at alpha1, index 0 and 1 are the endpoints and 2 to 7 the values in between
+            int step = int(std::round((alpha0 - block.pixels[i][3]) * 7.0f / float(alpha0 - alpha1)));
+            int index = step == 0 ? 0 : (step == 7 ? 1 : step + 1);
+            bits |= uint64_t(index) << (16 + i * 3);
+        }
+    }
+    for (int i = 0; i < 8; i++) {
+        output[i] = static_cast<unsigned char>(bits >> (i * 8));
+    }
+}
+
+// writes fields into a 128 bit block starting at the lowest bit
+struct BitWriter {
+    unsigned char* output;
+    int position = 0;
+
+    void write(uint32_t value, int bits) {
+        for (int i = 0; i < bits; i++, this->position++) {
+            if ((value >> i) & 1) {
+                this->output[this->position / 8] |= static_cast<unsigned char>(1 << (this->position % 8));
+            }
+        }
+    }
+};
+
+// BC7 mode 6, one subset of RGBA endpoints with 7 bits per channel plus a shared bit per endpoint and 4 bit indices.
+// All four combinations of the shared bits are tried.
+static void encodeBc7(const Block& block, unsigned char* output) {
+    float first[4];
+    float second[4];
+    fitEndpoints(block, 4, first, second);
+
+    float bestError = 1e30f;
+    int bestEndpoints[2][4] = {};
+    int bestBits[2] = {};
+    int bestIndices[16] = {};
+    for (int bitCombination = 0; bitCombination < 4; bitCombination++) {
+        int bits[2] = {bitCombination & 1, bitCombination >> 1};
+        int endpoints[2][4];
+        float colors[2][4];
+        for (int c = 0; c < 4; c++) {
+            const float* sources[2] = {first, second};
+            for (int e = 0; e < 2; e++) {
+                int value = int(std::round((sources[e][c] - bits[e]) / 2.0f));
+                endpoints[e][c] = std::min(127, std::max(0, value));
+                colors[e][c] = float((endpoints[e][c] << 1) | bits[e]);
+            }
+        }
+
+        float palette[16][4];
+        for (int index = 0; index < 16; index++) {
+            for (int c = 0; c < 4; c++) {
+                int weight = BC7_WEIGHTS[index];
+                palette[index][c] = float(((64 - weight) * int(colors[0][c]) + weight * int(colors[1][c]) + 32) >> 6);
+            }
+        }
+        float total = 0.0f;
+        int indices[16];
+        for (int i = 0; i < 16; i++) {
+            int best = 0;
+            float bestPixelError = squaredError(block.pixels[i], palette[0], 4);
+            for (int index = 1; index < 16; index++) {
+                float error = squaredError(block.pixels[i], palette[index], 4);
+                if (error < bestPixelError) {
+                    best = index;
+                    bestPixelError = error;
+                }
+            }
+            indices[i] = best;
+            total += bestPixelError;
+        }
+        if (total < bestError) {
+            bestError = total;
+            std::memcpy(bestEndpoints, endpoints, sizeof(endpoints));
+            std::memcpy(bestBits, bits, sizeof(bits));
+            std::memcpy(bestIndices, indices, sizeof(indices));
+        }
+    }
+
+    // the highest bit of the first index is implied to be 0, swapping the endpoints flips all indices
+    if (bestIndices[0] & 8) {
+        for (int c = 0; c < 4; c++) {
+            std::swap(bestEndpoints[0][c], bestEndpoints[1][c]);
+        }
+        std::swap(bestBits[0], bestBits[1]);
+        for (int& index : bestIndices) {
+            index = 15 - index;
+        }
+    }
+
+    std::memset(output, 0, 16);
+    BitWriter writer{output};
+    writer.write(1 << 6, 7);
+    for (int c = 0; c < 4; c++) {
+        writer.write(uint32_t(bestEndpoints[0][c]), 7);
+        writer.write(uint32_t(bestEndpoints[1][c]), 7);
+    }
+    writer.write(uint32_t(bestBits[0]), 1);
+    writer.write(uint32_t(bestBits[1]), 1);
+    writer.write(uint32_t(bestIndices[0]), 3);
+    for (int i = 1; i < 16; i++) {
+        writer.write(uint32_t(bestIndices[i]), 4);
+    }
+}
+
+void compressBlockRows(const TextureLevel& level, TextureFormat format, size_t begin, size_t end,
+                       unsigned char* output) {
+    if (!isCompressed(format)) {
+        size_t rowBytes = size_t(level.width) * 4;
+        size_t firstRow = std::min(begin * 4, size_t(level.height));
+        size_t lastRow = std::min(end * 4, size_t(level.height));
+        std::memcpy(output + firstRow * rowBytes, level.pixels.data() + firstRow * rowBytes,
+                    (lastRow - firstRow) * rowBytes);
+        return;
+    }
+
+    int blocksX = (level.width + 3) / 4;
+    size_t size = blockSize(format);
+    for (size_t blockY = begin; blockY < end; blockY++) {
+        for (int blockX = 0; blockX < blocksX; blockX++) {
+            Block block = fetchBlock(level, blockX, int(blockY));
+            unsigned char* target = output + (blockY * blocksX + blockX) * size;
+            switch (format) {
+            case TextureFormat::Bc1:
+                encodeBc1(block, target);
+                break;
+            case TextureFormat::Bc3:
+                encodeBc3Alpha(block, target);
+                encodeBc1(block, target + 8);
+                break;
+            case TextureFormat::Bc7:
+                encodeBc7(block, target);
+                break;
+            case TextureFormat::Rgba8:
+                break;
+            }
+        }
+    }
+}
@@ -0,0 +1,41 @@
+#ifndef TEXTURE_FORMAT_H
+#define TEXTURE_FORMAT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// layout of cooked textures on the GPU. Rgba8 is the uncompressed fallback, the block compressed formats store 4x4
+// pixels in 8 (Bc1, RGB) or 16 bytes (Bc3 with a separate alpha block, Bc7 with higher quality RGBA).
+enum class TextureFormat { Rgba8, Bc1, Bc3, Bc7 };
+
+const char* textureFormatName(TextureFormat format);
+// throws for unknown names
+TextureFormat parseTextureFormat(const std::string& name);
+// OpenGL internal format, glCompressedTexImage2D for the block compressed formats
+unsigned int textureInternalFormat(TextureFormat format);
+// returns false for unknown internal formats
+bool textureFormatFromInternal(unsigned int internalFormat, TextureFormat& format);
+bool isCompressed(TextureFormat format);
+size_t textureLevelSize(TextureFormat format, int width, int height);
+
+// one mip level of an 8 bit RGBA image
+struct TextureLevel {
+    int width = 0;
+    int height = 0;
+    std::vector<unsigned char> pixels;
+};
+
+// the image itself followed by each level downsampled with a box filter down to 1x1
+std::vector<TextureLevel> generateMipmaps(const unsigned char* rgba, int width, int height);
+// Bc3 if any pixel is not opaque, Bc1 otherwise
+TextureFormat chooseTextureFormat(const unsigned char* rgba, int width, int height);
+
+// rows of 4x4 blocks of a level, the rows can be encoded independently of each other
+size_t textureBlockRows(const TextureLevel& level);
+// encodes the block rows [begin, end) of level, output holds textureLevelSize bytes for the whole level
+void compressBlockRows(const TextureLevel& level, TextureFormat format, size_t begin, size_t end,
+                       unsigned char* output);
+
+#endif // !TEXTURE_FORMAT_H
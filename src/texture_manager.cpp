@@ -0,0 +1,322 @@
+#include "texture_manager.h"
+
+#include "profiler.h"
+#include "render_state.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <utility>
+
+// levels up to this size along their larger side are uploaded with the texture and never evicted
+const int RESIDENT_TAIL_SIZE = 64;
+// upper limit of levels being read or uploaded at the same time
+const size_t MAX_STREAMING_LEVELS = 4;
+// size of the pages touched when a level of a cooked texture is paged in
+const size_t PAGE_SIZE = 4096;
+
+int ManagedTexture::Levels::count() const {
+    return this->cache ? int(this->cache->levelCount()) : int(this->decoded.size());
+}
+
+int ManagedTexture::Levels::width(int level) const {
+    return this->cache ? this->cache->levelWidth(level) : this->decoded[level].width;
+}
+
+int ManagedTexture::Levels::height(int level) const {
+    return this->cache ? this->cache->levelHeight(level) : this->decoded[level].height;
+}
+
+const unsigned char* ManagedTexture::Levels::data(int level) const {
+    return this->cache ? this->cache->levelData(level) : this->decoded[level].pixels.data();
+}
+
+size_t ManagedTexture::Levels::size(int level) const {
+    return this->cache ? this->cache->levelSize(level) : this->decoded[level].pixels.size();
+}
+
+int ManagedTexture::Levels::tail() const {
+    int level = 0;
+    while (level < this->count() - 1 && std::max(this->width(level), this->height(level)) > RESIDENT_TAIL_SIZE) {
+        level++;
+    }
+    return level;
+}
+
+int ManagedTexture::width() const {
+    return this->levels ? this->levels->width(0) : 0;
+}
+
+int ManagedTexture::height() const {
+    return this->levels ? this->levels->height(0) : 0;
+}
+
+int ManagedTexture::levelCount() const {
+    return this->levels ? this->levels->count() : 0;
+}
+
+size_t ManagedTexture::residentBytes() const {
+    size_t bytes = 0;
+    for (int level = this->firstResident; this->handle != 0 && level < this->levels->count(); level++) {
+        bytes += this->levels->size(level);
+    }
+    return bytes;
+}
+
+TextureManager::TextureManager(AssetLoader& assetLoader, ThreadPool& threadPool, size_t budget)
+    : assetLoader(assetLoader), threadPool(threadPool),
+      placeholder(Texture::fromImage(TextureImage::solidColor(128, 128, 128))), budgetBytes(budget) {
+}
+
+TextureManager::~TextureManager() {
+    for (auto& texture : this->textures) {
+        this->release(*texture.second);
+    }
+    renderState.deleteTexture(this->placeholder.id());
+}
+
+TextureHandle TextureManager::load(const std::string& path) {
+    TextureHandle& texture = this->textures[path];
+    if (texture) {
+        return texture;
+    }
+    texture = std::make_shared<ManagedTexture>();
+    texture->sourcePath = path;
+    texture->placeholder = this->placeholder.id();
+
+    // the upload is skipped if the texture was released while it was being read
+    typedef std::shared_ptr<const ManagedTexture::Levels> LevelsPointer;
+    std::weak_ptr<ManagedTexture> weakTexture = texture;
+    auto read = [path] { return TextureManager::readLevels(path); };
+    auto upload = [this, weakTexture](LevelsPointer& levels) {
+        TextureHandle loaded = weakTexture.lock();
+        if (loaded) {
+            this->upload(*loaded, levels);
+        }
+    };
+    this->assetLoader.load<LevelsPointer>(path, read, upload);
+    return texture;
+}
+
+void TextureManager::request(const TextureHandle& texture, float pixels) {
+    if (texture->lastUsed != this->frame) {
+        texture->lastUsed = this->frame;
+        texture->wantedSize = 0.0f;
+    }
+    texture->wantedSize = std::max(texture->wantedSize, pixels);
+}
+
+float TextureManager::screenSize(float radius, float distance, const glm::mat4& projection, int viewportHeight) {
+    // projection[1][1] is the cotangent of half the vertical field of view
+    return radius / std::max(distance, 1e-3f) * projection[1][1] * float(viewportHeight);
+}
+
+int TextureManager::wantedLevel(const ManagedTexture& texture) {
+    // every level halves the size, so the level whose size is closest above the size on screen is enough
+    int count = texture.levels->count();
+    int size = std::max(texture.levels->width(0), texture.levels->height(0));
+    if (texture.wantedSize < 1.0f) {
+        return count - 1;
+    }
+    int level = int(std::floor(std::log2(float(size) / texture.wantedSize)));
+    return std::min(std::max(level, 0), count - 1);
+}
+
+void TextureManager::update() {
+    PROFILE_SCOPE("Texture streaming");
+    // textures only the manager still holds are released
+    for (auto texture = this->textures.begin(); texture != this->textures.end();) {
+        if (texture->second.use_count() == 1) {
+            this->release(*texture->second);
+            texture = this->textures.erase(texture);
+        } else {
+            ++texture;
+        }
+    }
+
+    // the budget may have been lowered
+    this->makeRoom(0);
+
+    // textures drawn this frame which need finer levels, the ones missing the most levels first
+    std::vector<std::pair<int, TextureHandle>> wanted;
+    for (const auto& texture : this->textures) {
+        const ManagedTexture& managed = *texture.second;
+        if (managed.handle != 0 && managed.lastUsed == this->frame && managed.streamingLevel < 0) {
+            int missingLevels = managed.firstResident - wantedLevel(managed);
+            if (missingLevels > 0) {
+                wanted.emplace_back(-missingLevels, texture.second);
+            }
+        }
+    }
+    std::stable_sort(wanted.begin(), wanted.end(),
+                     [](const std::pair<int, TextureHandle>& a, const std::pair<int, TextureHandle>& b) {
+                         return a.first < b.first;
+                     });
+
+    this->missing = 0;
+    for (const auto& texture : wanted) {
+        // one level at a time, the coarser levels are needed before the finer ones anyway
+        if (this->streaming < MAX_STREAMING_LEVELS) {
+            this->stream(texture.second);
+        }
+        this->missing += size_t(texture.second->firstResident - wantedLevel(*texture.second));
+        if (texture.second->streamingLevel >= 0) {
+            this->missing--;
+        }
+    }
+    this->frame++;
+}
+
+void TextureManager::upload(ManagedTexture& texture, std::shared_ptr<const ManagedTexture::Levels> levels) {
+    int count = levels->count();
+    int tail = levels->tail();
+
+    glGenTextures(1, &texture.handle);
+    renderState.bindTexture(0, texture.handle);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAX_ANISOTROPY, 16.0f);
+    // the texture is complete with just the levels from the base level on, the finer ones are streamed in later
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, tail);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, count - 1);
+    for (int level = count - 1; level >= tail; level--) {
+        uploadTextureLevel(levels->format, level, levels->width(level), levels->height(level), levels->data(level),
+                           levels->size(level));
+    }
+
+    texture.levels = std::move(levels);
+    texture.firstResident = tail;
+}
+
+void TextureManager::stream(const TextureHandle& texture) {
+    int level = texture->firstResident - 1;
+    if (!this->makeRoom(texture->levels->size(level))) {
+        return;
+    }
+    texture->streamingLevel = level;
+    this->streaming++;
+
+    // cooked levels are mapped from disk, reading them on a worker keeps the page faults off the render thread
+    std::shared_ptr<const ManagedTexture::Levels> levels = texture->levels;
+    TaskHandle read = this->threadPool.submit([levels, level] {
+        if (!levels->cache) {
+            return;
+        }
+        PROFILE_SCOPE("Texture paging");
+        const volatile unsigned char* data = levels->data(level);
+        unsigned char sum = 0;
+        for (size_t offset = 0; offset < levels->size(level); offset += PAGE_SIZE) {
+            sum += data[offset];
+        }
+        (void)sum;
+    });
+
+    std::weak_ptr<ManagedTexture> weakTexture = texture;
+    this->threadPool.submitToRenderThread([this, weakTexture, level] {
+        PROFILE_SCOPE("Texture upload");
+        this->streaming--;
+        TextureHandle streamed = weakTexture.lock();
+        if (!streamed || streamed->handle == 0 || streamed->streamingLevel != level) {
+            return;
+        }
+        // textures are not evicted while a level is streamed in, so level is still the next finer one
+        const ManagedTexture::Levels& levels = *streamed->levels;
+        renderState.bindTexture(0, streamed->handle);
+        uploadTextureLevel(levels.format, level, levels.width(level), levels.height(level), levels.data(level),
+                           levels.size(level));
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level);
+        streamed->firstResident = level;
+        streamed->streamingLevel = -1;
+    }, {read});
+}
+
+void TextureManager::evict(ManagedTexture& texture) {
+    int level = texture.firstResident;
+    renderState.bindTexture(0, texture.handle);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level + 1);
+    // an empty image releases the memory of the level, it is outside of the base and max level so the texture stays
+    // complete
+    glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA8, 0, 0, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    texture.firstResident = level + 1;
+}
+
+bool TextureManager::makeRoom(size_t bytes) {
+    size_t committed = this->committedBytes();
+    while (committed + bytes > this->budgetBytes) {
+        // least recently used first, among textures drawn this frame only levels finer than needed can go
+        ManagedTexture* victim = nullptr;
+        for (const auto& texture : this->textures) {
+            ManagedTexture& candidate = *texture.second;
+            if (candidate.handle == 0 || candidate.streamingLevel >= 0 ||
+                candidate.firstResident >= candidate.levels->tail()) {
+                continue;
+            }
+            if (candidate.lastUsed == this->frame && candidate.firstResident >= wantedLevel(candidate)) {
+                continue;
+            }
+            if (!victim || candidate.lastUsed < victim->lastUsed) {
+                victim = &candidate;
+            }
+        }
+        if (!victim) {
+            return false;
+        }
+        committed -= victim->levels->size(victim->firstResident);
+        this->evict(*victim);
+    }
+    return true;
+}
+
+size_t TextureManager::committedBytes() const {
+    size_t bytes = 0;
+    for (const auto& texture : this->textures) {
+        const ManagedTexture& managed = *texture.second;
+        bytes += managed.residentBytes();
+        if (managed.streamingLevel >= 0) {
+            bytes += managed.levels->size(managed.streamingLevel);
+        }
+    }
+    return bytes;
+}
+
+size_t TextureManager::residentBytes() const {
+    size_t bytes = 0;
+    for (const auto& texture : this->textures) {
+        bytes += texture.second->residentBytes();
+    }
+    return bytes;
+}
+
+void TextureManager::release(ManagedTexture& texture) {
+    if (texture.handle != 0) {
+        renderState.deleteTexture(texture.handle);
+        texture.handle = 0;
+    }
+    texture.streamingLevel = -1;
+}
+
+std::shared_ptr<const ManagedTexture::Levels> TextureManager::readLevels(const std::string& path) {
+    TextureImage image = TextureImage::loadFromFile(path);
+    auto levels = std::make_shared<ManagedTexture::Levels>();
+    if (image.cache) {
+        levels->format = image.cache->textureFormat();
+        levels->cache = std::move(image.cache);
+        return levels;
+    }
+
+    std::vector<unsigned char> rgba(size_t(image.width) * image.height * 4);
+    for (size_t pixel = 0; pixel < size_t(image.width) * image.height; pixel++) {
+        const unsigned char* source = &image.pixels[pixel * image.channels];
+        unsigned char* target = &rgba[pixel * 4];
+        // grey and grey with alpha are spread over the color channels
+        target[0] = source[0];
+        target[1] = image.channels >= 3 ? source[1] : source[0];
+        target[2] = image.channels >= 3 ? source[2] : source[0];
+        target[3] = image.channels == 4 ? source[3] : image.channels == 2 ? source[1] : 255;
+    }
+    levels->format = TextureFormat::Rgba8;
+    levels->decoded = generateMipmaps(rgba.data(), image.width, image.height);
+    return levels;
+}
@@ -0,0 +1,142 @@
+#ifndef TEXTURE_MANAGER_H
+#define TEXTURE_MANAGER_H
+
+#include "asset_loader.h"
+#include "texture.h"
+#include "texture_format.h"
+#include "thread_pool.h"
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <GL/glew.h>
+
+#include <glm/mat4x4.hpp>
+
+// texture owned by the TextureManager. Only a range of its mip levels is resident, from residentLevel down to 1x1,
+// the finer levels are streamed in when the texture is drawn large enough to need them.
+class ManagedTexture {
+public:
+    // the texture to bind, a grey placeholder until the first levels are uploaded
+    GLuint id() const {
+        return this->handle != 0 ? this->handle : this->placeholder;
+    }
+    const std::string& path() const {
+        return this->sourcePath;
+    }
+    bool isResident() const {
+        return this->handle != 0;
+    }
+    int width() const;
+    int height() const;
+    int levelCount() const;
+    // finest resident level, levelCount if none
+    int residentLevel() const {
+        return this->firstResident;
+    }
+    size_t residentBytes() const;
+
+private:
+    friend class TextureManager;
+
+    // the cooked texture or the decoded image with its mipmaps generated on the CPU. The decoded levels stay in memory
+    // so evicted levels can be uploaded again.
+    struct Levels {
+        TextureFormat format = TextureFormat::Rgba8;
+        std::shared_ptr<const TextureCache> cache;
+        std::vector<TextureLevel> decoded;
+
+        int count() const;
+        int width(int level) const;
+        int height(int level) const;
+        const unsigned char* data(int level) const;
+        size_t size(int level) const;
+        // finest of the coarse levels which stay resident as long as the texture is loaded
+        int tail() const;
+    };
+
+    std::string sourcePath;
+    GLuint placeholder = 0;
+    GLuint handle = 0;
+    // null until the texture is read
+    std::shared_ptr<const Levels> levels;
+    int firstResident = 0;
+    // largest size on screen requested in the frame lastUsed
+    float wantedSize = 0.0f;
+    // level being read or waiting for its upload, -1 if none
+    int streamingLevel = -1;
+    unsigned long lastUsed = 0;
+};
+
+typedef std::shared_ptr<ManagedTexture> TextureHandle;
+
+// owns all textures loaded from files. Loading the same path twice returns the same texture, a texture is released
+// once nothing but the manager holds a handle to it. The coarse mip levels of a texture are uploaded first, finer
+// levels are streamed in on worker threads for the textures drawn large on screen. When the resident levels of all
+// textures exceed the budget, the finest levels of the least recently used textures are evicted.
+class TextureManager {
+public:
+    TextureManager(AssetLoader& assetLoader, ThreadPool& threadPool, size_t budget);
+    ~TextureManager();
+    TextureManager(const TextureManager&) = delete;
+    TextureManager& operator=(const TextureManager&) = delete;
+
+    // returns right away, the texture is read by the asset loader and drawn with the placeholder until then
+    TextureHandle load(const std::string& path);
+    // texture is drawn this frame covering about pixels along its larger side, the largest request of a frame wins
+    void request(const TextureHandle& texture, float pixels);
+    // once per frame after the requests, evicts levels to stay within the budget and streams in the wanted levels.
+    // Render thread only.
+    void update();
+
+    // pixels covered on screen by the diameter of a sphere at distance from the camera
+    static float screenSize(float radius, float distance, const glm::mat4& projection, int viewportHeight);
+
+    void setBudget(size_t bytes) {
+        this->budgetBytes = bytes;
+    }
+    size_t budget() const {
+        return this->budgetBytes;
+    }
+    size_t textureCount() const {
+        return this->textures.size();
+    }
+    size_t residentBytes() const;
+    // levels being read or waiting for their upload
+    size_t queueDepth() const {
+        return this->streaming;
+    }
+    // finer levels wanted by textures drawn this frame which are neither resident nor queued
+    size_t missingLevels() const {
+        return this->missing;
+    }
+
+private:
+    // cooked levels are uploaded as they are, decoded images are expanded to RGBA and get their mipmaps generated, so
+    // every level can be uploaded the same way. Safe to call from any thread.
+    static std::shared_ptr<const ManagedTexture::Levels> readLevels(const std::string& path);
+    // finest level needed for the size the texture is drawn at
+    static int wantedLevel(const ManagedTexture& texture);
+    // uploads the coarse levels of a texture which was just read
+    void upload(ManagedTexture& texture, std::shared_ptr<const ManagedTexture::Levels> levels);
+    void stream(const TextureHandle& texture);
+    void evict(ManagedTexture& texture);
+    // evicts levels of textures not drawn this frame or finer than needed until bytes more fit into the budget
+    bool makeRoom(size_t bytes);
+    // resident levels and the levels being streamed in
+    size_t committedBytes() const;
+    void release(ManagedTexture& texture);
+
+    AssetLoader& assetLoader;
+    ThreadPool& threadPool;
+    Texture placeholder;
+    std::map<std::string, TextureHandle> textures;
+    size_t budgetBytes = 0;
+    size_t streaming = 0;
+    size_t missing = 0;
+    unsigned long frame = 1;
+};
+
+#endif // !TEXTURE_MANAGER_H
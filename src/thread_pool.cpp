@@ -0,0 +1,344 @@
+#include "thread_pool.h"
+
+#include "profiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <utility>
+
+#include <fmt/format.h>
+using namespace fmt;
+
+struct Task {
+    std::function<void()> job;
+    bool renderThread = false;
+    // unfinished dependencies, plus one while the task is being created so it is not queued too early
+    std::atomic<int> remaining{1};
+    std::atomic<bool> done{false};
+
+    std::mutex mutex;
+    std::condition_variable finishedCondition;
+    bool finished = false;
+    // queued once this task and their other dependencies finished
+    std::vector<TaskHandle> dependents;
+};
+
+// ranges of a blocking parallel for, claimed one after another by the calling thread and the helper tasks
+struct ParallelFor {
+    // only called for a claimed range, the calling thread waits for all of them
+    const std::function<void(size_t begin, size_t end)>* body;
+    size_t count;
+    size_t ranges;
+    std::atomic<size_t> nextRange{0};
+
+    std::mutex mutex;
+    std::condition_variable finishedCondition;
+    size_t finishedRanges = 0;
+    std::exception_ptr error;
+};
+
+// the pool and queue of the worker running on this thread
+static thread_local ThreadPool* currentPool = nullptr;
+static thread_local size_t currentQueue = 0;
+
+// ranges per thread of a parallel for, more ranges than threads leave work to steal when ranges take different time
+const size_t RANGES_PER_THREAD = 4;
+// a waiting thread checks this often whether there is work to help with
+const std::chrono::milliseconds WAIT_INTERVAL(1);
+
+ThreadPool::ThreadPool(int threadCount) : queuedTasks(0) {
+    if (threadCount < 0) {
+        threadCount = int(std::max(2u, std::thread::hardware_concurrency()) - 1);
+    }
+    for (int i = 0; i <= threadCount; i++) {
+        this->queues.emplace_back(new Queue());
+    }
+    for (int i = 0; i < threadCount; i++) {
+        this->workers.emplace_back(&ThreadPool::work, this, size_t(i));
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(this->sleepMutex);
+        this->stopping = true;
+    }
+    this->taskAvailable.notify_all();
+    for (auto& worker : this->workers) {
+        worker.join();
+    }
+}
+
+TaskHandle ThreadPool::submit(std::function<void()> job, const std::vector<TaskHandle>& dependencies) {
+    return this->createTask(std::move(job), false, dependencies);
+}
+
+TaskHandle ThreadPool::submitToRenderThread(std::function<void()> job, const std::vector<TaskHandle>& dependencies) {
+    return this->createTask(std::move(job), true, dependencies);
+}
+
+TaskHandle ThreadPool::fence(const std::vector<TaskHandle>& dependencies) {
+    return this->createTask(nullptr, false, dependencies);
+}
+
+static size_t rangeCount(size_t count, size_t grainSize, unsigned int threadCount) {
+    grainSize = std::max<size_t>(grainSize, 1);
+    return std::min((count + grainSize - 1) / grainSize, (threadCount + 1) * RANGES_PER_THREAD);
+}
+
+// runs ranges until all are claimed
+static void runRanges(ParallelFor& parallelFor) {
+    while (true) {
+        size_t range = parallelFor.nextRange++;
+        if (range >= parallelFor.ranges) {
+            return;
+        }
+        std::exception_ptr error;
+        try {
+            (*parallelFor.body)(parallelFor.count * range / parallelFor.ranges,
+                                parallelFor.count * (range + 1) / parallelFor.ranges);
+        } catch (...) {
+            error = std::current_exception();
+        }
+
+        bool last;
+        {
+            std::lock_guard<std::mutex> lock(parallelFor.mutex);
+            if (error && !parallelFor.error) {
+                parallelFor.error = error;
+            }
+            last = ++parallelFor.finishedRanges == parallelFor.ranges;
+        }
+        if (last) {
+            parallelFor.finishedCondition.notify_all();
+        }
+    }
+}
+
+TaskHandle ThreadPool::submitParallelFor(size_t count, std::function<void(size_t begin, size_t end)> body,
+                                         size_t grainSize, const std::vector<TaskHandle>& dependencies) {
+    size_t ranges = rangeCount(count, grainSize, this->threadCount());
+    auto shared = std::make_shared<std::function<void(size_t, size_t)>>(std::move(body));
+    std::vector<TaskHandle> tasks;
+    tasks.reserve(ranges);
+    for (size_t range = 0; range < ranges; range++) {
+        size_t begin = count * range / ranges;
+        size_t end = count * (range + 1) / ranges;
+        tasks.push_back(this->submit([shared, begin, end] { (*shared)(begin, end); }, dependencies));
+    }
+    return this->fence(tasks);
+}
+
+void ThreadPool::parallelFor(size_t count, const std::function<void(size_t begin, size_t end)>& body,
+                             size_t grainSize) {
+    if (count == 0) {
+        return;
+    }
+    size_t ranges = rangeCount(count, grainSize, this->threadCount());
+    if (this->workers.empty() || ranges == 1) {
+        body(0, count);
+        return;
+    }
+
+    // the calling thread only runs ranges of this call, never an unrelated task which could take much longer
+    auto parallelFor = std::make_shared<ParallelFor>();
+    parallelFor->body = &body;
+    parallelFor->count = count;
+    parallelFor->ranges = ranges;
+    // helpers which start after all ranges were claimed return right away
+    size_t helpers = std::min<size_t>(ranges - 1, this->workers.size());
+    for (size_t i = 0; i < helpers; i++) {
+        this->submit([parallelFor] { runRanges(*parallelFor); });
+    }
+    runRanges(*parallelFor);
+
+    // ranges claimed by helpers are running, they do not wait for anything this thread could do
+    std::exception_ptr error;
+    {
+        std::unique_lock<std::mutex> lock(parallelFor->mutex);
+        parallelFor->finishedCondition.wait(lock, [&parallelFor] {
+            return parallelFor->finishedRanges == parallelFor->ranges;
+        });
+        error = std::move(parallelFor->error);
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+void ThreadPool::wait(const TaskHandle& task) {
+    if (currentPool != this && !this->workers.empty()) {
+        // other threads leave the queues to the workers, a task they picked up could stall them for long
+        std::unique_lock<std::mutex> lock(task->mutex);
+        task->finishedCondition.wait(lock, [&task] { return task->finished; });
+        return;
+    }
+    while (!isDone(task)) {
+        TaskHandle other = this->findTask();
+        if (other) {
+            this->run(other);
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(task->mutex);
+        task->finishedCondition.wait_for(lock, WAIT_INTERVAL, [&task] { return task->finished; });
+    }
+}
+
+bool ThreadPool::isDone(const TaskHandle& task) {
+    return task->done.load(std::memory_order_acquire);
+}
+
+size_t ThreadPool::runRenderTasks(double budgetMilliseconds) {
+    PROFILE_SCOPE("Render tasks");
+    auto start = std::chrono::steady_clock::now();
+    size_t count = 0;
+    while (true) {
+        TaskHandle task;
+        {
+            std::lock_guard<std::mutex> lock(this->renderQueue.mutex);
+            if (this->renderQueue.tasks.empty()) {
+                break;
+            }
+            task = std::move(this->renderQueue.tasks.front());
+            this->renderQueue.tasks.pop_front();
+        }
+        this->run(task);
+        count++;
+
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        if (elapsed.count() >= budgetMilliseconds) {
+            break;
+        }
+    }
+    return count;
+}
+
+TaskHandle ThreadPool::createTask(std::function<void()> job, bool renderThread,
+                                  const std::vector<TaskHandle>& dependencies) {
+    TaskHandle task = std::make_shared<Task>();
+    task->job = std::move(job);
+    task->renderThread = renderThread;
+    for (const auto& dependency : dependencies) {
+        std::lock_guard<std::mutex> lock(dependency->mutex);
+        if (!dependency->finished) {
+            task->remaining++;
+            dependency->dependents.push_back(task);
+        }
+    }
+    if (--task->remaining == 0) {
+        this->schedule(task);
+    }
+    return task;
+}
+
+void ThreadPool::schedule(TaskHandle task) {
+    if (!task->job && !task->renderThread) {
+        // fences finish as soon as their dependencies did, also without workers
+        this->run(task);
+        return;
+    }
+    if (task->renderThread) {
+        std::lock_guard<std::mutex> lock(this->renderQueue.mutex);
+        this->renderQueue.tasks.push_back(std::move(task));
+        return;
+    }
+
+    // counted before it is pushed so queuedTasks never drops below the number of queued tasks
+    this->queuedTasks++;
+    // workers keep the tasks they create, other threads use the shared queue
+    Queue& queue = currentPool == this ? *this->queues[currentQueue] : *this->queues.back();
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.tasks.push_back(std::move(task));
+    }
+    {
+        // a worker checking queuedTasks right before going to sleep either sees the new task or gets notified
+        std::lock_guard<std::mutex> lock(this->sleepMutex);
+    }
+    this->taskAvailable.notify_one();
+}
+
+TaskHandle ThreadPool::findTask() {
+    if (this->queuedTasks == 0) {
+        return nullptr;
+    }
+
+    TaskHandle task;
+    size_t sharedQueue = this->queues.size() - 1;
+    if (currentPool == this) {
+        // newest task of the own queue, its data is most likely still in the cache
+        Queue& own = *this->queues[currentQueue];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+        }
+    }
+    // oldest task of the shared queue, then of the other workers starting with the next one
+    size_t first = currentPool == this ? currentQueue + 1 : 0;
+    for (size_t i = 0; !task && i < this->queues.size(); i++) {
+        size_t index = i == 0 ? sharedQueue : (first + i - 1) % sharedQueue;
+        if (currentPool == this && index == currentQueue) {
+            continue;
+        }
+        Queue& queue = *this->queues[index];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (!queue.tasks.empty()) {
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+        }
+    }
+
+    if (task) {
+        this->queuedTasks--;
+    }
+    return task;
+}
+
+void ThreadPool::run(const TaskHandle& task) {
+    if (task->job) {
+        try {
+            task->job();
+        } catch (const std::exception& error) {
+            // there is nobody to rethrow to on a worker thread
+            print(stderr, "Job failed: {}\n", error.what());
+        } catch (...) {
+            print(stderr, "Job failed with an exception which is not a std::exception\n");
+        }
+        // releases what the job captured
+        task->job = nullptr;
+    }
+
+    std::vector<TaskHandle> dependents;
+    {
+        std::lock_guard<std::mutex> lock(task->mutex);
+        task->finished = true;
+        task->done.store(true, std::memory_order_release);
+        dependents.swap(task->dependents);
+    }
+    task->finishedCondition.notify_all();
+    for (auto& dependent : dependents) {
+        if (--dependent->remaining == 0) {
+            this->schedule(std::move(dependent));
+        }
+    }
+}
+
+void ThreadPool::work(size_t index) {
+    currentPool = this;
+    currentQueue = index;
+    profiler.setThreadName(format("Worker {}", index));
+    while (true) {
+        TaskHandle task = this->findTask();
+        if (task) {
+            this->run(task);
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(this->sleepMutex);
+        this->taskAvailable.wait(lock, [this] { return this->stopping || this->queuedTasks > 0; });
+        if (this->stopping) {
+            return;
+        }
+    }
+}
@@ -0,0 +1,84 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct Task;
+// keeps a submitted task alive for waiting on it or depending on it
+typedef std::shared_ptr<Task> TaskHandle;
+
+// work stealing thread pool. Every worker owns a deque of ready tasks: tasks submitted by a worker go to its own deque
+// and are run newest first, idle workers steal the oldest task of another worker. Tasks submitted from other threads
+// go to a shared queue. A task can depend on other tasks, it is queued once all of them finished, which also makes
+// continuations. Render thread tasks are run by runRenderTasks instead of a worker, e.g. to upload what a job produced.
+class ThreadPool {
+public:
+    // a negative threadCount uses one thread per core, leaving one core for the render thread. Without workers tasks
+    // only run while a thread waits for them.
+    explicit ThreadPool(int threadCount = -1);
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+    // tasks which did not start yet are dropped
+    ~ThreadPool();
+
+    // exceptions thrown by job are printed, tasks depending on it run nevertheless
+    TaskHandle submit(std::function<void()> job, const std::vector<TaskHandle>& dependencies = {});
+    TaskHandle submitToRenderThread(std::function<void()> job, const std::vector<TaskHandle>& dependencies = {});
+    // finishes once all dependencies finished, e.g. for the render thread to poll a group of tasks
+    TaskHandle fence(const std::vector<TaskHandle>& dependencies);
+    // splits [0, count) into ranges of at least grainSize which can be stolen by any worker, the returned task finishes
+    // once all ranges are done
+    TaskHandle submitParallelFor(size_t count, std::function<void(size_t begin, size_t end)> body,
+                                 size_t grainSize = 1, const std::vector<TaskHandle>& dependencies = {});
+    // like submitParallelFor but blocks until all ranges are done. The calling thread works on the ranges as well but
+    // runs no other task, helper tasks on the workers claim the remaining ranges. The first exception thrown by a
+    // range is rethrown. Can be called from a task.
+    void parallelFor(size_t count, const std::function<void(size_t begin, size_t end)>& body, size_t grainSize = 1);
+
+    // workers run other tasks while waiting, other threads block unless there are no workers. Must not be called for
+    // a render thread task on the render thread.
+    void wait(const TaskHandle& task);
+    static bool isDone(const TaskHandle& task);
+    // runs the render thread tasks whose dependencies finished until budgetMilliseconds are spent, at least one per
+    // call. Returns the number of tasks run.
+    size_t runRenderTasks(double budgetMilliseconds = std::numeric_limits<double>::infinity());
+
+    unsigned int threadCount() const {
+        return static_cast<unsigned int>(this->workers.size());
+    }
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<TaskHandle> tasks;
+    };
+
+    TaskHandle createTask(std::function<void()> job, bool renderThread, const std::vector<TaskHandle>& dependencies);
+    // queues a task whose dependencies finished
+    void schedule(TaskHandle task);
+    // pops from the own queue, then the shared one, then steals. Returns null if all queues are empty.
+    TaskHandle findTask();
+    void run(const TaskHandle& task);
+    void work(size_t index);
+
+    std::vector<std::thread> workers;
+    // one per worker followed by the shared queue
+    std::vector<std::unique_ptr<Queue>> queues;
+    Queue renderQueue;
+
+    // sleeping workers are woken when queuedTasks is raised
+    std::mutex sleepMutex;
+    std::condition_variable taskAvailable;
+    std::atomic<size_t> queuedTasks;
+    bool stopping = false;
+};
+
+#endif // !THREAD_POOL_H
@@ -0,0 +1,53 @@
+#include "uniform_buffer.h"
+
+#include "render_stats.h"
+
+#include <cstring>
+
+UniformBuffer::UniformBuffer(GLuint binding, size_t size) : binding(binding), size(size) {
+    glGenBuffers(1, &this->handle);
+    glBindBuffer(GL_UNIFORM_BUFFER, this->handle);
+    glBufferData(GL_UNIFORM_BUFFER, size, nullptr, GL_DYNAMIC_DRAW);
+    glBindBufferBase(GL_UNIFORM_BUFFER, binding, this->handle);
+}
+
+UniformBuffer::~UniformBuffer() {
+    glDeleteBuffers(1, &this->handle);
+}
+
+void UniformBuffer::update(const void* data) {
+    glBindBuffer(GL_UNIFORM_BUFFER, this->handle);
+    // orphaning gives the driver fresh storage if the previous frame is still in flight
+    glBufferData(GL_UNIFORM_BUFFER, this->size, nullptr, GL_DYNAMIC_DRAW);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, this->size, data);
+    glBindBufferBase(GL_UNIFORM_BUFFER, this->binding, this->handle);
+    renderStats.uniformBytes += unsigned(this->size);
+}
+
+UniformRingBuffer::UniformRingBuffer(GLuint binding, size_t blockSize, StreamBuffer& stream)
+    : stream(stream), binding(binding), blockSize(blockSize) {
+    GLint alignment = 256;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    this->alignment = size_t(alignment);
+}
+
+void UniformRingBuffer::beginFrame() {
+    this->blocks.clear();
+}
+
+size_t UniformRingBuffer::push(const void* data) {
+    StreamAllocation allocation = this->stream.allocate(this->blockSize, this->alignment);
+    std::memcpy(allocation.data, data, this->blockSize);
+    this->blocks.push_back(Block{allocation.buffer, allocation.offset});
+    renderStats.uniformBytes += unsigned(this->blockSize);
+    return this->blocks.size() - 1;
+}
+
+void UniformRingBuffer::flush() {
+    this->stream.flush();
+}
+
+void UniformRingBuffer::bind(size_t block) {
+    const Block& location = this->blocks[block];
+    glBindBufferRange(GL_UNIFORM_BUFFER, this->binding, location.buffer, location.offset, this->blockSize);
+}
@@ -0,0 +1,79 @@
+#ifndef UNIFORM_BUFFER_H
+#define UNIFORM_BUFFER_H
+
+#include "stream_buffer.h"
+
+#include <cstddef>
+#include <vector>
+
+#include <GL/glew.h>
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec4.hpp>
+
+// binding points of the uniform blocks shared by all programs
+const GLuint FRAME_UNIFORM_BINDING = 0;
+const GLuint OBJECT_UNIFORM_BINDING = 1;
+
+// std140 layout of the Frame block, vec3s are padded to vec4
+struct FrameUniforms {
+    glm::mat4 view;
+    glm::mat4 projection;
+    glm::mat4 viewProjection;
+    glm::vec4 cameraPosition;
+    glm::vec4 lightPosition;
+    glm::vec4 lightColor;
+};
+
+// std140 layout of the Object block
+struct ObjectUniforms {
+    glm::mat4 model;
+    // meaning depends on the program, e.g. the dequantization of a model's vertices or the grid of a terrain chunk
+    glm::vec4 parameters[3];
+};
+
+// one uniform block bound to a fixed binding point, replaced as a whole
+class UniformBuffer {
+public:
+    UniformBuffer(GLuint binding, size_t size);
+    ~UniformBuffer();
+    UniformBuffer(const UniformBuffer&) = delete;
+    UniformBuffer& operator=(const UniformBuffer&) = delete;
+
+    void update(const void* data);
+
+private:
+    GLuint handle = 0;
+    GLuint binding;
+    size_t size;
+};
+
+// many instances of a uniform block per frame, e.g. one per object. Each block is written straight into the stream
+// buffer and bound with glBindBufferRange, the stream buffer keeps the blocks of the frames in flight apart.
+class UniformRingBuffer {
+public:
+    UniformRingBuffer(GLuint binding, size_t blockSize, StreamBuffer& stream);
+
+    // forgets the blocks of the last frame, the stream buffer has to begin its frame as well
+    void beginFrame();
+    // copies one block and returns its index for bind
+    size_t push(const void* data);
+    // flushes the stream buffer, has to be called before the first bind of the frame
+    void flush();
+    void bind(size_t block);
+
+private:
+    struct Block {
+        GLuint buffer;
+        size_t offset;
+    };
+
+    StreamBuffer& stream;
+    GLuint binding;
+    size_t blockSize;
+    // GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT
+    size_t alignment;
+    std::vector<Block> blocks;
+};
+
+#endif // !UNIFORM_BUFFER_H
@@ -0,0 +1,129 @@
+#include "vertex_format.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#include <glm/gtc/packing.hpp>
+
+#include <fmt/format.h>
+using namespace fmt;
+
+const char* vertexFormatName(VertexFormat format) {
+    switch (format) {
+    case VertexFormat::Float:
+        return "float";
+    case VertexFormat::Half:
+        return "half";
+    case VertexFormat::Snorm16:
+        return "snorm16";
+    }
+    return "unknown";
+}
+
+VertexFormat parseVertexFormat(const std::string& name) {
+    for (VertexFormat format : {VertexFormat::Float, VertexFormat::Half, VertexFormat::Snorm16}) {
+        if (name == vertexFormatName(format)) {
+            return format;
+        }
+    }
+    throw std::runtime_error(format("Unknown vertex format {}, expected float, half or snorm16", name));
+}
+
+size_t vertexSize(VertexFormat format) {
+    return format == VertexFormat::Float ? sizeof(Vertex) : sizeof(PackedVertex);
+}
+
+// scale of a range, degenerate ranges keep a scale of one so the inverse stays finite
+static float rangeScale(float minimum, float maximum) {
+    return maximum > minimum ? maximum - minimum : 1.0f;
+}
+
+VertexQuantization VertexQuantization::fromVertices(const Vertex* vertices, size_t count) {
+    VertexQuantization quantization;
+    if (count == 0) {
+        return quantization;
+    }
+
+    glm::vec3 positionMin = vertices[0].position;
+    glm::vec3 positionMax = vertices[0].position;
+    glm::vec2 textureMin = vertices[0].texturePosition;
+    glm::vec2 textureMax = vertices[0].texturePosition;
+    for (size_t i = 1; i < count; i++) {
+        positionMin = glm::min(positionMin, vertices[i].position);
+        positionMax = glm::max(positionMax, vertices[i].position);
+        textureMin = glm::min(textureMin, vertices[i].texturePosition);
+        textureMax = glm::max(textureMax, vertices[i].texturePosition);
+    }
+
+    // positions are mapped to [-1, 1] around the center of the bounds, texture coordinates to [0, 1]
+    quantization.positionOffset = (positionMin + positionMax) * 0.5f;
+    quantization.positionScale = glm::vec3(rangeScale(positionMin.x, positionMax.x),
+                                           rangeScale(positionMin.y, positionMax.y),
+                                           rangeScale(positionMin.z, positionMax.z)) *
+                                 0.5f;
+    quantization.texturePositionOffset = textureMin;
+    quantization.texturePositionScale =
+        glm::vec2(rangeScale(textureMin.x, textureMax.x), rangeScale(textureMin.y, textureMax.y));
+    return quantization;
+}
+
+glm::vec4 VertexQuantization::positionScaleParameter() const {
+    return glm::vec4(this->positionScale, 0.0f);
+}
+
+glm::vec4 VertexQuantization::positionOffsetParameter() const {
+    return glm::vec4(this->positionOffset, 0.0f);
+}
+
+glm::vec4 VertexQuantization::texturePositionParameter() const {
+    return glm::vec4(this->texturePositionScale.x, this->texturePositionScale.y, this->texturePositionOffset.x,
+                     this->texturePositionOffset.y);
+}
+
+void packVertices(const Vertex* vertices, size_t count, VertexFormat format, const VertexQuantization& quantization,
+                  PackedVertex* packed) {
+    if (format == VertexFormat::Float) {
+        throw std::runtime_error("Float vertices are not packed");
+    }
+    glm::vec3 inversePositionScale = 1.0f / quantization.positionScale;
+    glm::vec2 inverseTextureScale = 1.0f / quantization.texturePositionScale;
+    for (size_t i = 0; i < count; i++) {
+        const Vertex& vertex = vertices[i];
+        PackedVertex& out = packed[i];
+
+        glm::vec3 position = (vertex.position - quantization.positionOffset) * inversePositionScale;
+        for (int axis = 0; axis < 3; axis++) {
+            out.position[axis] =
+                format == VertexFormat::Half ? glm::packHalf1x16(position[axis]) : glm::packSnorm1x16(position[axis]);
+        }
+        out.position[3] = 0;
+
+        encodeOctahedral(vertex.normal, out.normal);
+
+        glm::vec2 texturePosition = (vertex.texturePosition - quantization.texturePositionOffset) * inverseTextureScale;
+        out.texturePosition[0] = glm::packUnorm1x16(texturePosition.x);
+        out.texturePosition[1] = glm::packUnorm1x16(texturePosition.y);
+    }
+}
+
+static float signNotZero(float value) {
+    return value >= 0.0f ? 1.0f : -1.0f;
+}
+
+void encodeOctahedral(glm::vec3 normal, int16_t encoded[2]) {
+    float length = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+    if (length == 0.0f) {
+        // meshes without normals, any direction decodes to a valid unit vector
+        normal = glm::vec3(0.0f, 0.0f, 1.0f);
+        length = 1.0f;
+    }
+    glm::vec2 folded = glm::vec2(normal.x, normal.y) / length;
+    if (normal.z < 0.0f) {
+        // the lower half of the octahedron is folded over the diagonals
+        folded = glm::vec2((1.0f - std::abs(folded.y)) * signNotZero(folded.x),
+                           (1.0f - std::abs(folded.x)) * signNotZero(folded.y));
+    }
+    encoded[0] = int16_t(glm::packSnorm1x16(folded.x));
+    encoded[1] = int16_t(glm::packSnorm1x16(folded.y));
+}
@@ -0,0 +1,52 @@
+#ifndef VERTEX_FORMAT_H
+#define VERTEX_FORMAT_H
+
+#include "vertex.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+
+// layout of model vertices on the GPU. Float uploads Vertex as is, the compact formats pack a vertex into 16 bytes:
+// position as half floats or snorm16 relative to the mesh bounds, an octahedral snorm16 normal and unorm16 texture
+// coordinates relative to the mesh's texture coordinate range.
+enum class VertexFormat { Float, Half, Snorm16 };
+
+const char* vertexFormatName(VertexFormat format);
+// throws for unknown names
+VertexFormat parseVertexFormat(const std::string& name);
+size_t vertexSize(VertexFormat format);
+
+struct PackedVertex {
+    // xyz and padding, so every attribute stays 4 byte aligned
+    uint16_t position[4];
+    int16_t normal[2];
+    uint16_t texturePosition[2];
+};
+
+// restores positions and texture coordinates of packed vertices: value = packed * scale + offset
+struct VertexQuantization {
+    glm::vec3 positionScale = glm::vec3(1.0f);
+    glm::vec3 positionOffset = glm::vec3(0.0f);
+    glm::vec2 texturePositionScale = glm::vec2(1.0f);
+    glm::vec2 texturePositionOffset = glm::vec2(0.0f);
+
+    static VertexQuantization fromVertices(const Vertex* vertices, size_t count);
+    // as the Object block parameters read by the model shaders
+    glm::vec4 positionScaleParameter() const;
+    glm::vec4 positionOffsetParameter() const;
+    glm::vec4 texturePositionParameter() const;
+};
+
+// format has to be one of the compact formats
+void packVertices(const Vertex* vertices, size_t count, VertexFormat format, const VertexQuantization& quantization,
+                  PackedVertex* packed);
+
+// unit vector folded onto an octahedron and stored as two snorm16 values, decoded in the shaders
+void encodeOctahedral(glm::vec3 normal, int16_t encoded[2]);
+
+#endif // !VERTEX_FORMAT_H
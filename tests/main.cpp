@@ -0,0 +1,44 @@
+#include "test.h"
+
+#include <exception>
+#include <map>
+#include <string>
+
+#include <fmt/format.h>
+using namespace fmt;
+
+static std::map<std::string, TestFunction>& tests() {
+    static std::map<std::string, TestFunction> registered;
+    return registered;
+}
+
+TestRegistration::TestRegistration(const char* name, TestFunction function) {
+    tests()[name] = function;
+}
+
+int main(int argc, char** argv) {
+    std::string prefix = argc > 1 ? argv[1] : "";
+
+    int run = 0;
+    int failed = 0;
+    for (const auto& test : tests()) {
+        if (test.first.compare(0, prefix.size(), prefix) != 0) {
+            continue;
+        }
+        run++;
+        try {
+            test.second();
+            print("passed {}\n", test.first);
+        } catch (const std::exception& error) {
+            print(stderr, "FAILED {}: {}\n", test.first, error.what());
+            failed++;
+        }
+    }
+
+    if (run == 0) {
+        print(stderr, "No test starts with {}\n", prefix);
+        return 1;
+    }
+    print("{} of {} tests passed\n", run - failed, run);
+    return failed == 0 ? 0 : 1;
+}
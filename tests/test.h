@@ -0,0 +1,26 @@
+#ifndef TEST_H
+#define TEST_H
+
+#include <stdexcept>
+
+#include <fmt/format.h>
+
+typedef void (*TestFunction)();
+
+struct TestRegistration {
+    TestRegistration(const char* name, TestFunction function);
+};
+
+// defines a test which can be run with "tests [name prefix]"
+#define TEST(name)                                                                                                     \
+    static void name##Test();                                                                                          \
+    static TestRegistration name##Registration(#name, name##Test);                                                     \
+    static void name##Test()
+
+// fails the running test
+#define CHECK(condition)                                                                                               \
+    if (!(condition)) {                                                                                                \
+        throw std::runtime_error(fmt::format("{}:{}: {}", __FILE__, __LINE__, #condition));                            \
+    }
+
+#endif // !TEST_H
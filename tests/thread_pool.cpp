@@ -0,0 +1,274 @@
+#include "test.h"
+
+#include "thread_pool.h"
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+// blocks the tasks which wait for it until it is opened
+class Gate {
+public:
+    Gate() : opened(promise.get_future().share()) {
+    }
+
+    void open() {
+        this->promise.set_value();
+    }
+    void wait() const {
+        this->opened.wait();
+    }
+
+private:
+    std::promise<void> promise;
+    std::shared_future<void> opened;
+};
+
+// checks that body covers [0, count) exactly once
+static void checkCoverage(ThreadPool& threadPool, size_t count, size_t grainSize) {
+    std::vector<std::atomic<int>> calls(count);
+    for (auto& call : calls) {
+        call = 0;
+    }
+    threadPool.parallelFor(count, [&](size_t begin, size_t end) {
+        CHECK(begin < end && end <= count);
+        for (size_t i = begin; i < end; i++) {
+            calls[i]++;
+        }
+    }, grainSize);
+    for (const auto& call : calls) {
+        CHECK(call == 1);
+    }
+}
+
+TEST(threadPoolDependencies) {
+    ThreadPool threadPool(2);
+    std::mutex mutex;
+    std::vector<int> order;
+    auto append = [&](int value) {
+        std::lock_guard<std::mutex> lock(mutex);
+        order.push_back(value);
+    };
+
+    TaskHandle first = threadPool.submit([&] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        append(1);
+    });
+    TaskHandle second = threadPool.submit([&] { append(2); }, {first});
+    TaskHandle third = threadPool.submit([&] { append(3); }, {first, second});
+    threadPool.wait(third);
+    CHECK((order == std::vector<int>{1, 2, 3}));
+
+    // a continuation of a finished task is queued right away
+    TaskHandle continuation = threadPool.submit([&] { append(4); }, {third});
+    threadPool.wait(continuation);
+    CHECK(order.back() == 4);
+
+    // tasks depending on a failed one run nevertheless
+    TaskHandle failed = threadPool.submit([] { throw std::runtime_error("expected failure"); });
+    TaskHandle afterFailure = threadPool.submit([&] { append(5); }, {failed});
+    threadPool.wait(afterFailure);
+    CHECK(order.back() == 5);
+    TaskHandle failedWithoutException = threadPool.submit([] { throw 42; });
+    TaskHandle afterFailureWithoutException = threadPool.submit([&] { append(6); }, {failedWithoutException});
+    threadPool.wait(afterFailureWithoutException);
+    CHECK(order.back() == 6);
+}
+
+TEST(threadPoolFence) {
+    ThreadPool threadPool(2);
+    CHECK(ThreadPool::isDone(threadPool.fence({})));
+
+    Gate gate;
+    std::atomic<int> finished(0);
+    std::vector<TaskHandle> tasks;
+    for (int i = 0; i < 8; i++) {
+        tasks.push_back(threadPool.submit([&] {
+            gate.wait();
+            finished++;
+        }));
+    }
+    TaskHandle fence = threadPool.fence(tasks);
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    CHECK(!ThreadPool::isDone(fence));
+
+    gate.open();
+    threadPool.wait(fence);
+    CHECK(finished == 8);
+    for (const auto& task : tasks) {
+        CHECK(ThreadPool::isDone(task));
+    }
+}
+
+TEST(threadPoolParallelFor) {
+    for (int threads : {1, 3}) {
+        ThreadPool threadPool(threads);
+        checkCoverage(threadPool, 1, 1);
+        checkCoverage(threadPool, 10007, 1);
+        checkCoverage(threadPool, 10007, 7);
+        checkCoverage(threadPool, 10007, 100000);
+
+        std::atomic<size_t> submitted(0);
+        threadPool.wait(threadPool.submitParallelFor(10007, [&](size_t begin, size_t end) {
+            submitted += end - begin;
+        }, 16));
+        CHECK(submitted == 10007);
+    }
+}
+
+TEST(threadPoolParallelForException) {
+    ThreadPool threadPool(3);
+    std::atomic<size_t> covered(0);
+    bool thrown = false;
+    try {
+        threadPool.parallelFor(1000, [&](size_t begin, size_t end) {
+            if (begin <= 500 && 500 < end) {
+                throw std::runtime_error("range failed");
+            }
+            covered += end - begin;
+        });
+    } catch (const std::runtime_error& error) {
+        thrown = std::string(error.what()) == "range failed";
+    }
+    CHECK(thrown);
+    // all other ranges finished before it was rethrown
+    CHECK(covered < 1000 && covered > 0);
+    size_t coveredAfterReturn = covered;
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    CHECK(covered == coveredAfterReturn);
+
+    checkCoverage(threadPool, 1000, 1);
+}
+
+TEST(threadPoolNestedParallelFor) {
+    ThreadPool threadPool(2);
+    const size_t outer = 64;
+    const size_t inner = 256;
+    std::vector<std::atomic<size_t>> sums(outer);
+    for (auto& sum : sums) {
+        sum = 0;
+    }
+
+    // parallel fors inside tasks and inside the ranges of another parallel for
+    std::vector<TaskHandle> tasks;
+    for (int i = 0; i < 4; i++) {
+        tasks.push_back(threadPool.submit([&] {
+            threadPool.parallelFor(outer, [&](size_t begin, size_t end) {
+                for (size_t j = begin; j < end; j++) {
+                    threadPool.parallelFor(inner, [&, j](size_t innerBegin, size_t innerEnd) {
+                        sums[j] += innerEnd - innerBegin;
+                    });
+                }
+            });
+        }));
+    }
+    threadPool.wait(threadPool.fence(tasks));
+    for (const auto& sum : sums) {
+        CHECK(sum == 4 * inner);
+    }
+}
+
+TEST(threadPoolParallelForRunsNoOtherTask) {
+    ThreadPool threadPool(1);
+    Gate gate;
+    std::atomic<bool> blocking(false);
+    TaskHandle blocker = threadPool.submit([&] {
+        blocking = true;
+        gate.wait();
+    });
+    while (!blocking) {
+        std::this_thread::yield();
+    }
+
+    // queued before the helpers of the parallel for, the waiting thread must not pick it up
+    std::atomic<bool> unrelatedRan(false);
+    TaskHandle unrelated = threadPool.submit([&] { unrelatedRan = true; });
+    std::thread::id caller = std::this_thread::get_id();
+    std::atomic<size_t> rangesOnCaller(0);
+    std::atomic<size_t> ranges(0);
+    threadPool.parallelFor(100, [&](size_t, size_t) {
+        ranges++;
+        if (std::this_thread::get_id() == caller) {
+            rangesOnCaller++;
+        }
+    });
+    CHECK(!unrelatedRan);
+    CHECK(ranges > 1 && rangesOnCaller == ranges);
+
+    gate.open();
+    threadPool.wait(unrelated);
+    CHECK(unrelatedRan);
+    CHECK(ThreadPool::isDone(blocker));
+}
+
+TEST(threadPoolWithoutWorkers) {
+    ThreadPool threadPool(0);
+    CHECK(threadPool.threadCount() == 0);
+
+    std::vector<int> order;
+    TaskHandle first = threadPool.submit([&] { order.push_back(1); });
+    TaskHandle second = threadPool.submit([&] { order.push_back(2); }, {first});
+    // nothing runs until a thread waits
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    CHECK(order.empty());
+    CHECK(!ThreadPool::isDone(first));
+
+    threadPool.wait(second);
+    CHECK((order == std::vector<int>{1, 2}));
+    CHECK(ThreadPool::isDone(threadPool.fence({first, second})));
+
+    checkCoverage(threadPool, 1000, 1);
+    std::atomic<size_t> submitted(0);
+    threadPool.wait(threadPool.submitParallelFor(1000, [&](size_t begin, size_t end) { submitted += end - begin; }));
+    CHECK(submitted == 1000);
+}
+
+TEST(threadPoolDefaultThreadCount) {
+    ThreadPool threadPool;
+    CHECK(threadPool.threadCount() >= 1);
+    checkCoverage(threadPool, 1000, 1);
+}
+
+TEST(threadPoolRenderTasks) {
+    ThreadPool threadPool(1);
+    CHECK(threadPool.runRenderTasks() == 0);
+
+    int ran = 0;
+    for (int i = 0; i < 3; i++) {
+        threadPool.submitToRenderThread([&ran] {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            ran++;
+        });
+    }
+    // at least one task per call, even when it exceeds the budget
+    CHECK(threadPool.runRenderTasks(0.0) == 1);
+    CHECK(threadPool.runRenderTasks(1.0) == 1);
+    CHECK(ran == 2);
+    CHECK(threadPool.runRenderTasks() == 1);
+    CHECK(ran == 3);
+
+    // render thread tasks wait for their dependencies
+    Gate gate;
+    TaskHandle reading = threadPool.submit([&gate] { gate.wait(); });
+    TaskHandle upload = threadPool.submitToRenderThread([&ran] { ran++; }, {reading});
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    CHECK(threadPool.runRenderTasks() == 0);
+    gate.open();
+    // queued by the worker right after reading finished
+    while (threadPool.runRenderTasks() == 0) {
+        std::this_thread::yield();
+    }
+    CHECK(ran == 4 && ThreadPool::isDone(upload));
+
+    // the budget stops before all tasks are run
+    for (int i = 0; i < 10; i++) {
+        threadPool.submitToRenderThread([] { std::this_thread::sleep_for(std::chrono::milliseconds(2)); });
+    }
+    size_t budgeted = threadPool.runRenderTasks(5.0);
+    CHECK(budgeted >= 1 && budgeted < 10);
+    CHECK(budgeted + threadPool.runRenderTasks() == 10);
+}
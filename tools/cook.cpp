@@ -0,0 +1,145 @@
+// offline asset cooker, converts source assets into the binary formats loaded at runtime
+//
+// usage: cook [--texture-format rgba8|bc1|bc3|bc7] <model.obj|image>...
+
+#include "mesh_cache.h"
+#include "mesh_import.h"
+#include "mesh_optimizer.h"
+#include "texture_cache.h"
+#include "texture_format.h"
+#include "thread_pool.h"
+#include "vertex_format.h"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <exception>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <stb_image.h>
+
+#include <fmt/format.h>
+using namespace fmt;
+
+struct CookOptions {
+    // chosen per texture by chooseTextureFormat if not set
+    bool textureFormatSet = false;
+    TextureFormat textureFormat = TextureFormat::Bc1;
+};
+
+static bool isImage(const std::string& path) {
+    std::string extension = path.substr(path.find_last_of('.') + 1);
+    std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+    for (const char* image : {"jpg", "jpeg", "png", "tga", "bmp"}) {
+        if (extension == image) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void cookTexture(const std::string& path, const CookOptions& options, ThreadPool& threadPool) {
+    auto start = std::chrono::steady_clock::now();
+    int width;
+    int height;
+    int channels;
+    unsigned char* data = stbi_load(path.c_str(), &width, &height, &channels, 4);
+    if (!data) {
+        throw std::runtime_error(format("Failed to load texture {}", path));
+    }
+    std::vector<TextureLevel> levels = generateMipmaps(data, width, height);
+    TextureFormat textureFormat =
+        options.textureFormatSet ? options.textureFormat : chooseTextureFormat(data, width, height);
+    stbi_image_free(data);
+
+    size_t uncompressedSize = 0;
+    size_t cookedSize = 0;
+    for (auto& level : levels) {
+        std::vector<unsigned char> encoded(textureLevelSize(textureFormat, level.width, level.height));
+        threadPool.parallelFor(textureBlockRows(level), [&](size_t begin, size_t end) {
+            compressBlockRows(level, textureFormat, begin, end, encoded.data());
+        });
+        uncompressedSize += level.pixels.size();
+        cookedSize += encoded.size();
+        level.pixels.swap(encoded);
+    }
+    std::string cachePath = TextureCache::pathFor(path);
+    TextureCache::write(cachePath, path, textureFormat, levels);
+    std::chrono::duration<double, std::milli> duration = std::chrono::steady_clock::now() - start;
+    print("{} -> {} ({}x{}, {} levels, {}, {:.1f} ms)\n", path, cachePath, width, height, levels.size(),
+          textureFormatName(textureFormat), duration.count());
+    // drivers store RGB textures with 4 bytes per pixel as well
+    print("  {:.1f} MB on the GPU instead of {:.1f} MB as RGBA8 with mipmaps, {:.1f}x smaller\n",
+          cookedSize / (1024.0 * 1024.0), uncompressedSize / (1024.0 * 1024.0), double(uncompressedSize) / cookedSize);
+}
+
+static void cookMesh(const std::string& path, const CookOptions& options, ThreadPool& threadPool) {
+    auto start = std::chrono::steady_clock::now();
+    MeshData mesh = importMesh(path);
+    size_t importedVertices = mesh.vertices.size();
+    VertexCacheStatistics before = analyzeVertexCache(mesh.indices.data(), mesh.indices.size(), mesh.vertices.size());
+    optimizeMesh(mesh);
+    VertexCacheStatistics after = analyzeVertexCache(mesh.indices.data(), mesh.indices.size(), mesh.vertices.size());
+    std::string cachePath = MeshCache::pathFor(path);
+    MeshCache::write(cachePath, path, mesh);
+    std::chrono::duration<double, std::milli> duration = std::chrono::steady_clock::now() - start;
+    print("{} -> {} ({} vertices, {} indices, {} submeshes, {} materials, {:.1f} ms)\n", path, cachePath,
+          mesh.vertices.size(), mesh.indices.size(), mesh.submeshes.size(), mesh.materials.size(), duration.count());
+    print("  {} duplicate vertices removed, ACMR {:.3f} -> {:.3f}, ATVR {:.3f} -> {:.3f} ({}-entry FIFO cache)\n",
+          importedVertices - mesh.vertices.size(), before.acmr, after.acmr, before.atvr, after.atvr,
+          VERTEX_CACHE_SIZE);
+    // size of the vertex buffer the application uploads in each format
+    for (VertexFormat format : {VertexFormat::Float, VertexFormat::Half, VertexFormat::Snorm16}) {
+        print("  {:8} {:8.1f} KB of vertices\n", vertexFormatName(format),
+              mesh.vertices.size() * vertexSize(format) / 1024.0);
+    }
+
+    // textures are referenced relative to the model
+    std::string directory = path.substr(0, path.find_last_of("/\\") + 1);
+    for (const auto& material : mesh.materials) {
+        if (!material.diffuseTexture.empty()) {
+            cookTexture(directory + material.diffuseTexture, options, threadPool);
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    CookOptions options;
+    std::vector<std::string> paths;
+    try {
+        for (int i = 1; i < argc; i++) {
+            std::string argument = argv[i];
+            if (argument == "--texture-format" && i + 1 < argc) {
+                options.textureFormat = parseTextureFormat(argv[++i]);
+                options.textureFormatSet = true;
+            } else {
+                paths.push_back(argument);
+            }
+        }
+    } catch (const std::exception& error) {
+        print(stderr, "{}\n", error.what());
+        return 1;
+    }
+    if (paths.empty()) {
+        print(stderr, "usage: {} [--texture-format rgba8|bc1|bc3|bc7] <model|image>...\n", argv[0]);
+        return 1;
+    }
+
+    ThreadPool threadPool;
+    int failed = 0;
+    for (const auto& path : paths) {
+        try {
+            if (isImage(path)) {
+                cookTexture(path, options, threadPool);
+            } else {
+                cookMesh(path, options, threadPool);
+            }
+        } catch (const std::exception& error) {
+            print(stderr, "Failed to cook {}: {}\n", path, error.what());
+            failed++;
+        }
+    }
+    return failed == 0 ? 0 : 1;
+}